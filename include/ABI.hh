@@ -0,0 +1,125 @@
+/**
+ * @file ABI.hh
+ *
+ * @brief Lowering of function signatures to the target's calling convention.
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Type.hh"
+
+// Forward declarations.
+namespace llvm {
+    class CallInst;
+    class DataLayout;
+    class Function;
+    class FunctionType;
+    class Module;
+    class Type;
+}
+
+namespace Craeft {
+
+/**
+ * @brief How a single argument or return value is passed.
+ */
+struct ArgABI {
+    enum Kind {
+        /**
+         * @brief Passed as its own LLVM type.
+         */
+        DIRECT,
+        /**
+         * @brief Reinterpreted in memory as `coerce_to`.  If that is a
+         *        struct, each of its elements is a separate parameter.
+         */
+        COERCE,
+        /**
+         * @brief Passed by pointer: `byval` for arguments and `sret` for
+         *        return values.
+         */
+        INDIRECT,
+        /**
+         * @brief Has no size, and is not passed at all.
+         */
+        IGNORE
+    };
+
+    ArgABI(Kind kind, llvm::Type *coerce_to = nullptr)
+        : kind(kind), coerce_to(coerce_to) {}
+
+    Kind kind;
+    llvm::Type *coerce_to;
+};
+
+/**
+ * @brief The lowering of a Craeft function type for the module's target.
+ *
+ * On x86-64 System V targets, structs and arrays are classified as C
+ * compilers do: those of at most 16 bytes are passed in the integer and SSE
+ * registers they would occupy in C, and the rest in memory.  Other targets
+ * pass them as first-class LLVM aggregates.
+ */
+class FunctionABI {
+public:
+    FunctionABI(const Function<> &f, llvm::Module &mod);
+
+    /**
+     * @brief Get the LLVM type of the lowered function.
+     */
+    llvm::FunctionType *get_type(void) const { return type; }
+
+    const ArgABI &get_ret(void) const { return ret; }
+    const ArgABI &get_arg(unsigned i) const { return args[i]; }
+
+    /**
+     * @brief Get the index of the (first) LLVM parameter of the given
+     *        argument.  The `sret` pointer, if any, is parameter 0.
+     */
+    unsigned get_param(unsigned i) const { return params[i]; }
+
+    /**
+     * @brief Add the `sret` and `byval` attributes to a function or call.
+     */
+    void add_attributes(llvm::Function *f) const;
+    void add_attributes(llvm::CallInst *call) const;
+
+private:
+    template<typename T>
+    void add_attributes_to(T *target) const;
+
+    ArgABI ret;
+    std::vector<ArgABI> args;
+    std::vector<unsigned> params;
+
+    /**
+     * @brief The LLVM types of the arguments and return value.
+     */
+    llvm::Type *ret_type;
+    std::vector<llvm::Type *> arg_types;
+
+    llvm::FunctionType *type;
+    const llvm::DataLayout &layout;
+};
+
+}
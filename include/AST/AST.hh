@@ -22,6 +22,9 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "Error.hh"
 
 namespace Craeft {
@@ -46,5 +49,18 @@ private:
     SourcePos _pos;
 };
 
+/**
+ * @brief An attribute annotating the following statement or definition.
+ *
+ * Written `#[name]` or `#[name(arg, ...)]`; arguments are identifiers or
+ * integer literals, kept as written.  What attributes mean, and where they
+ * are allowed, is up to code generation.
+ */
+struct Attribute {
+    std::string name;
+    std::vector<std::string> args;
+    SourcePos pos;
+};
+
 }
 }
@@ -53,10 +53,12 @@ public:
         Reference,
         Dereference,
         FieldAccess,
+        Index,
         Binop,
         FunctionCall,
         TemplateFunctionCall,
-        Cast
+        Cast,
+        ArrayLiteral
     };
 
     ExpressionKind kind(void) const { return _kind; }
@@ -77,7 +79,8 @@ public:
     static bool classof(const Expression *e) {
         return e->kind() == ExpressionKind::Variable
             || e->kind() == ExpressionKind::Dereference
-            || e->kind() == ExpressionKind::FieldAccess;
+            || e->kind() == ExpressionKind::FieldAccess
+            || e->kind() == ExpressionKind::Index;
     }
 
     LValue(ExpressionKind kind, SourcePos pos): Expression(kind, pos) {}
@@ -155,6 +158,25 @@ private:
     std::string _value;
 };
 
+/**
+ * @brief An array of the given elements, e.g. `[1, 2, 3]`.
+ */
+class ArrayLiteral: public Expression {
+public:
+    ArrayLiteral(std::vector<std::unique_ptr<Expression>> elements,
+                 SourcePos pos)
+        : Expression(ExpressionKind::ArrayLiteral, pos),
+          _elements(std::move(elements)) {}
+
+    const std::vector<std::unique_ptr<Expression>> &elements(void) const {
+        return _elements;
+    }
+
+    EXPRESSION_CLASS(ArrayLiteral);
+private:
+    std::vector<std::unique_ptr<Expression>> _elements;
+};
+
 /** @} */
 
 class Variable: public LValue {
@@ -335,6 +357,27 @@ private:
     std::string _field;
 };
 
+/**
+ * @brief Indexing into arrays (`a[i]`).
+ */
+class Index: public LValue {
+public:
+    Index(std::unique_ptr<Expression> array,
+          std::unique_ptr<Expression> index,
+          SourcePos pos)
+        : LValue(ExpressionKind::Index, pos),
+          _array(std::move(array)),
+          _index(std::move(index)) {}
+
+    const Expression &array(void) const { return *_array; }
+    const Expression &index(void) const { return *_index; }
+
+    LVALUE_CLASS(Index);
+private:
+    std::unique_ptr<Expression> _array;
+    std::unique_ptr<Expression> _index;
+};
+
 #undef EXPRESSION_CLASS
 #undef LVALUE_CLASS
 
@@ -361,10 +404,12 @@ public:
             HANDLE(Reference);
             HANDLE(Dereference);
             HANDLE(FieldAccess);
+            HANDLE(Index);
             HANDLE(Binop);
             HANDLE(FunctionCall);
             HANDLE(TemplateFunctionCall);
             HANDLE(Cast);
+            HANDLE(ArrayLiteral);
 #undef HANDLE
         }
     }
@@ -377,10 +422,12 @@ private:
     virtual Result operator()(const Reference &) = 0;
     virtual Result operator()(const Dereference &) = 0;
     virtual Result operator()(const FieldAccess &) = 0;
+    virtual Result operator()(const Index &) = 0;
     virtual Result operator()(const Binop &) = 0;
     virtual Result operator()(const FunctionCall &) = 0;
     virtual Result operator()(const TemplateFunctionCall &) = 0;
     virtual Result operator()(const Cast &) = 0;
+    virtual Result operator()(const ArrayLiteral &) = 0;
 };
 
 /**
@@ -409,10 +456,12 @@ public:
             HANDLE(Reference);
             HANDLE(Dereference);
             HANDLE(FieldAccess);
+            HANDLE(Index);
             HANDLE(Binop);
             HANDLE(FunctionCall);
             HANDLE(TemplateFunctionCall);
             HANDLE(Cast);
+            HANDLE(ArrayLiteral);
 #undef HANDLE
         }
     }
@@ -426,10 +475,12 @@ private:
     virtual Result operator()(std::unique_ptr<Reference>) = 0;
     virtual Result operator()(std::unique_ptr<Dereference>) = 0;
     virtual Result operator()(std::unique_ptr<FieldAccess>) = 0;
+    virtual Result operator()(std::unique_ptr<Index>) = 0;
     virtual Result operator()(std::unique_ptr<Binop>) = 0;
     virtual Result operator()(std::unique_ptr<FunctionCall>) = 0;
     virtual Result operator()(std::unique_ptr<TemplateFunctionCall>) = 0;
     virtual Result operator()(std::unique_ptr<Cast>) = 0;
+    virtual Result operator()(std::unique_ptr<ArrayLiteral>) = 0;
 };
 
 /**
@@ -447,6 +498,7 @@ public:
             HANDLE(Variable);
             HANDLE(Dereference);
             HANDLE(FieldAccess);
+            HANDLE(Index);
 #undef HANDLE
             default:
                 assert(false);
@@ -457,6 +509,7 @@ private:
     virtual Result operator()(const Variable &) = 0;
     virtual Result operator()(const Dereference &) = 0;
     virtual Result operator()(const FieldAccess &) = 0;
+    virtual Result operator()(const Index &) = 0;
 };
 
 /**
@@ -0,0 +1,92 @@
+/**
+ * @file AST/Serialize.hh
+ *
+ * @brief A compact, versioned binary format for caching parsed ASTs.
+ *
+ * A cache file records the size and a hash of the contents of the source it
+ * was produced from, so that a stale cache is detected and silently rebuilt.  It
+ * is read back through a memory map, and nodes are rebuilt with a single
+ * linear scan over fixed-width fields; no tokenizing or parsing is done.
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AST/Toplevel.hh"
+
+namespace Craeft {
+
+namespace AST {
+
+/**
+ * @brief Version of the binary AST format.
+ *
+ * Must be bumped whenever the encoding of any node changes; caches with a
+ * different version are treated as stale.
+ */
+const uint32_t AST_FORMAT_VERSION = 10;
+
+/**
+ * @brief Write the given top-level ASTs to a cache file.
+ *
+ * @param cache_fname The cache file to (over)write.
+ * @param source_fname The source file the ASTs were parsed from.
+ * @param asts The ASTs, in source order.
+ *
+ * @return Whether the cache was successfully written.
+ */
+bool write_ast_cache(const std::string &cache_fname,
+                     const std::string &source_fname,
+                     const std::vector<std::unique_ptr<Toplevel>> &asts);
+
+/**
+ * @brief Load top-level ASTs from a cache file.
+ *
+ * @param cache_fname The cache file to read.
+ * @param source_fname The source file the cache should correspond to.
+ * @param asts Vector to which the loaded ASTs are appended.
+ *
+ * @return Whether the cache was present, up to date and well-formed.  If
+ *         not, `asts` is left unchanged and the source should be parsed.
+ */
+bool read_ast_cache(const std::string &cache_fname,
+                    const std::string &source_fname,
+                    std::vector<std::unique_ptr<Toplevel>> &asts);
+
+/**
+ * @brief Hash a template function, ignoring source positions.
+ *
+ * Copies of the same template in different files hash the same, while
+ * different templates, even of the same name, almost certainly do not.
+ *
+ * @param argnames The names of the template's type parameters.
+ * @param def The template's definition.
+ */
+uint64_t hash_template(const std::vector<std::string> &argnames,
+                       const FunctionDefinition &def);
+
+}
+
+}
@@ -51,7 +51,10 @@ public:
         Assignment,
         Declaration,
         CompoundDeclaration,
-        IfStatement
+        IfStatement,
+        WhileStatement,
+        ForStatement,
+        Become
     };
 
     StatementKind kind(void) const { return _kind; }
@@ -109,6 +112,27 @@ public:
     STATEMENT_CLASS(VoidReturn);
 };
 
+/**
+ * @brief Guaranteed tail call (`become f(args);`).
+ *
+ * Returns the result of the call, reusing the caller's stack frame for the
+ * callee.
+ */
+class Become: public Statement {
+public:
+    Become(std::unique_ptr<Expression> call, SourcePos pos)
+        : Statement(StatementKind::Become, pos), _call(std::move(call)) {}
+
+    /**
+     * @brief The call: a FunctionCall or TemplateFunctionCall.
+     */
+    const Expression &call(void) const { return *_call; }
+
+    STATEMENT_CLASS(Become);
+private:
+    std::unique_ptr<Expression> _call;
+};
+
 /**
  * @brief Variable declaration.
  */
@@ -209,6 +233,84 @@ private:
 
 };
 
+/**
+ * @brief A `while` loop.
+ */
+class WhileStatement: public Statement {
+public:
+    WhileStatement(std::unique_ptr<Expression> condition,
+                   std::vector<std::unique_ptr<Statement>> body,
+                   std::vector<Attribute> attributes,
+                   SourcePos pos)
+        : Statement(StatementKind::WhileStatement, pos),
+          _condition(std::move(condition)),
+          _body(std::move(body)),
+          _attributes(std::move(attributes)) {}
+
+    const Expression &condition(void) const { return *_condition; }
+
+    const std::vector<std::unique_ptr<Statement>> &body(void) const {
+        return _body;
+    }
+
+    /**
+     * @brief Loop hints, e.g. `#[unroll(4)]`.
+     */
+    const std::vector<Attribute> &attributes(void) const {
+        return _attributes;
+    }
+
+    STATEMENT_CLASS(WhileStatement);
+private:
+    std::unique_ptr<Expression> _condition;
+    std::vector<std::unique_ptr<Statement>> _body;
+    std::vector<Attribute> _attributes;
+};
+
+/**
+ * @brief A counted loop (`for init; condition; step { ... }`).
+ *
+ * Variables declared in `init` are scoped to the loop.
+ */
+class ForStatement: public Statement {
+public:
+    ForStatement(std::unique_ptr<Statement> init,
+                 std::unique_ptr<Expression> condition,
+                 std::unique_ptr<Statement> step,
+                 std::vector<std::unique_ptr<Statement>> body,
+                 std::vector<Attribute> attributes,
+                 SourcePos pos)
+        : Statement(StatementKind::ForStatement, pos),
+          _init(std::move(init)),
+          _condition(std::move(condition)),
+          _step(std::move(step)),
+          _body(std::move(body)),
+          _attributes(std::move(attributes)) {}
+
+    const Statement &init(void) const { return *_init; }
+    const Expression &condition(void) const { return *_condition; }
+    const Statement &step(void) const { return *_step; }
+
+    const std::vector<std::unique_ptr<Statement>> &body(void) const {
+        return _body;
+    }
+
+    /**
+     * @brief Loop hints, e.g. `#[unroll(4)]`.
+     */
+    const std::vector<Attribute> &attributes(void) const {
+        return _attributes;
+    }
+
+    STATEMENT_CLASS(ForStatement);
+private:
+    std::unique_ptr<Statement> _init;
+    std::unique_ptr<Expression> _condition;
+    std::unique_ptr<Statement> _step;
+    std::vector<std::unique_ptr<Statement>> _body;
+    std::vector<Attribute> _attributes;
+};
+
 #undef STATEMENT_CLASS
 
 /**
@@ -232,6 +334,9 @@ public:
             HANDLE(Declaration);
             HANDLE(CompoundDeclaration);
             HANDLE(IfStatement);
+            HANDLE(WhileStatement);
+            HANDLE(ForStatement);
+            HANDLE(Become);
 #undef HANDLE
         }
     }
@@ -243,6 +348,9 @@ private:
     virtual Result operator()(const Declaration &) = 0;
     virtual Result operator()(const CompoundDeclaration &) = 0;
     virtual Result operator()(const IfStatement &) = 0;
+    virtual Result operator()(const WhileStatement &) = 0;
+    virtual Result operator()(const ForStatement &) = 0;
+    virtual Result operator()(const Become &) = 0;
 };
 
 /**
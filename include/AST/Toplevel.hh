@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -49,7 +50,8 @@ public:
         TemplateStructDeclaration,
         FunctionDeclaration,
         FunctionDefinition,
-        TemplateFunctionDefinition
+        TemplateFunctionDefinition,
+        GlobalDeclaration
     };
 
     ToplevelKind kind(void) const { return _kind; }
@@ -133,14 +135,22 @@ private:
  */
 class FunctionDeclaration: public Toplevel {
 public:
+    /**
+     * @param is_public Whether the function was declared `pub`.
+     */
     FunctionDeclaration(const std::string &name,
                         std::vector<std::unique_ptr<Declaration>> args,
                         std::unique_ptr<Type> ret_type,
-                        SourcePos pos)
+                        SourcePos pos,
+                        std::vector<Attribute> attributes
+                            = std::vector<Attribute>(),
+                        bool is_public = false)
         : Toplevel(ToplevelKind::FunctionDeclaration, pos),
           _name(name),
           _args(std::move(args)),
-          _ret_type(std::move(ret_type)) {}
+          _ret_type(std::move(ret_type)),
+          _attributes(std::move(attributes)),
+          _is_public(is_public) {}
 
     const std::string &name(void) const { return _name; }
     const std::vector<std::unique_ptr<Declaration>> &args(void) const {
@@ -148,33 +158,85 @@ public:
     }
     const Type &ret_type(void) const { return *_ret_type; }
 
+    /**
+     * @brief The attributes written before the function.
+     */
+    const std::vector<Attribute> &attributes(void) const {
+        return _attributes;
+    }
+
+    /**
+     * @brief Whether the function is exported from its module.
+     */
+    bool is_public(void) const { return _is_public; }
+
     TOPLEVEL_CLASS(FunctionDeclaration);
 private:
     std::string _name;
     std::vector<std::unique_ptr<Declaration>> _args;
     std::unique_ptr<Type> _ret_type;
+    std::vector<Attribute> _attributes;
+    bool _is_public;
 };
 
+/**
+ * @brief A function body whose parsing has been deferred.
+ *
+ * Called at most once, the first time the body is needed.
+ */
+typedef std::function<std::vector<std::unique_ptr<Statement>>(void)>
+    LazyBlock;
+
 class FunctionDefinition: public Toplevel {
 public:
     FunctionDefinition(std::unique_ptr<class FunctionDeclaration> signature,
                        std::vector<std::unique_ptr<Statement>> &&block,
+                       SourcePos pos, bool is_const = false)
+        : Toplevel(ToplevelKind::FunctionDefinition, pos),
+          _signature(std::move(signature)),
+          _block(std::move(block)),
+          _is_const(is_const) {}
+
+    /**
+     * @brief Create a function definition whose body is parsed on demand.
+     */
+    FunctionDefinition(std::unique_ptr<class FunctionDeclaration> signature,
+                       LazyBlock lazy_block,
                        SourcePos pos)
         : Toplevel(ToplevelKind::FunctionDefinition, pos),
           _signature(std::move(signature)),
-          _block(std::move(block)) {}
+          _lazy_block(std::move(lazy_block)),
+          _is_const(false) {}
 
     const class FunctionDeclaration &signature(void) const {
         return *_signature;
     }
+
+    /**
+     * @brief Whether this is a `const fn`, which may be evaluated at compile
+     *        time.
+     */
+    bool is_const(void) const { return _is_const; }
+
+    /**
+     * @brief Get the body, parsing it first if that was deferred.
+     *
+     * May throw the errors of parsing the body.
+     */
     const std::vector<std::unique_ptr<Statement>> &block(void) const {
+        if (_lazy_block) {
+            _block = _lazy_block();
+            _lazy_block = nullptr;
+        }
         return _block;
     }
 
     TOPLEVEL_CLASS(FunctionDefinition);
 private:
     std::unique_ptr<class FunctionDeclaration> _signature;
-    std::vector<std::unique_ptr<Statement>> _block;
+    mutable std::vector<std::unique_ptr<Statement>> _block;
+    mutable LazyBlock _lazy_block;
+    bool _is_const;
 };
 
 /**
@@ -192,6 +254,16 @@ public:
                                             std::move(block), pos)),
           _argnames(argnames) {}
 
+    TemplateFunctionDefinition(
+            std::unique_ptr<class FunctionDeclaration> signature,
+            const std::vector<std::string> &argnames,
+            LazyBlock lazy_block,
+            SourcePos pos)
+        : Toplevel(ToplevelKind::TemplateFunctionDefinition, pos),
+          _def(new class FunctionDefinition(std::move(signature),
+                                            std::move(lazy_block), pos)),
+          _argnames(argnames) {}
+
     std::shared_ptr<class FunctionDefinition> def(void) const { return _def; }
     const std::vector<std::string> &argnames(void) const { return _argnames; }
 
@@ -201,6 +273,65 @@ private:
     std::vector<std::string> _argnames;
 };
 
+/**
+ * @brief A global variable, with an optional static initializer.
+ */
+class GlobalDeclaration: public Toplevel {
+public:
+    /**
+     * @param init The initializer, or NULL for a zero-initialized global.
+     * @param is_const Whether the global was declared `const`.
+     * @param is_thread_local Whether the global was declared `thread_local`.
+     * @param is_public Whether the global was declared `pub`.
+     */
+    GlobalDeclaration(std::unique_ptr<Type> type,
+                      const std::string &name,
+                      std::unique_ptr<Expression> init,
+                      bool is_const,
+                      bool is_thread_local,
+                      std::vector<Attribute> attributes,
+                      SourcePos pos,
+                      bool is_public = false)
+        : Toplevel(ToplevelKind::GlobalDeclaration, pos),
+          _type(std::move(type)),
+          _name(name),
+          _init(std::move(init)),
+          _is_const(is_const),
+          _is_thread_local(is_thread_local),
+          _attributes(std::move(attributes)),
+          _is_public(is_public) {}
+
+    const Type &type(void) const { return *_type; }
+    const std::string &name(void) const { return _name; }
+
+    /**
+     * @brief Get the initializer, or NULL if there is none.
+     */
+    const Expression *init(void) const { return _init.get(); }
+
+    bool is_const(void) const { return _is_const; }
+    bool is_thread_local(void) const { return _is_thread_local; }
+
+    const std::vector<Attribute> &attributes(void) const {
+        return _attributes;
+    }
+
+    /**
+     * @brief Whether the global is exported from its module.
+     */
+    bool is_public(void) const { return _is_public; }
+
+    TOPLEVEL_CLASS(GlobalDeclaration);
+private:
+    std::unique_ptr<Type> _type;
+    std::string _name;
+    std::unique_ptr<Expression> _init;
+    bool _is_const;
+    bool _is_thread_local;
+    std::vector<Attribute> _attributes;
+    bool _is_public;
+};
+
 #undef TOPLEVEL_CLASS
 
 /**
@@ -223,6 +354,7 @@ public:
             HANDLE(FunctionDeclaration);
             HANDLE(FunctionDefinition);
             HANDLE(TemplateFunctionDefinition);
+            HANDLE(GlobalDeclaration);
         }
 #undef HANDLE
     }
@@ -234,6 +366,7 @@ private:
     virtual Result operator()(const FunctionDeclaration &) = 0;
     virtual Result operator()(const FunctionDefinition &) = 0;
     virtual Result operator()(const TemplateFunctionDefinition &) = 0;
+    virtual Result operator()(const GlobalDeclaration &) = 0;
 };
 
 /**
@@ -36,6 +36,8 @@ namespace Craeft {
 
 namespace AST {
 
+class Expression;
+
 /**
  * @brief Syntactic representation of types.
  *
@@ -47,7 +49,9 @@ public:
         NamedType,
         Void,
         TemplatedType,
-        Pointer
+        Pointer,
+        Vector,
+        Array
     };
 
     TypeKind kind(void) const { return _kind; }
@@ -126,6 +130,49 @@ private:
     std::unique_ptr<Type> _pointed;
 };
 
+/**
+ * @brief A SIMD vector type (`Vec<:T, N:>`).
+ */
+class Vector: public Type {
+public:
+    const Type &element(void) const { return *_element; }
+    unsigned length(void) const { return _length; }
+
+    Vector(std::unique_ptr<Type> element, unsigned length, SourcePos pos)
+        : Type(TypeKind::Vector, pos),
+          _element(std::move(element)),
+          _length(length) {}
+
+    TYPE_CLASS(Vector);
+private:
+    std::unique_ptr<Type> _element;
+    unsigned _length;
+};
+
+/**
+ * @brief A fixed-size array type (`T[N]`).
+ *
+ * The length may be any constant expression.
+ */
+class Array: public Type {
+public:
+    const Type &element(void) const { return *_element; }
+    const Expression &length(void) const { return *_length; }
+
+    Array(std::unique_ptr<Type> element, std::unique_ptr<Expression> length,
+          SourcePos pos);
+
+    static bool classof(const Type *t) {
+        return t->kind() == TypeKind::Array;
+    }
+
+    /* Defined out of line, where `Expression` is complete. */
+    ~Array(void) override;
+private:
+    std::unique_ptr<Type> _element;
+    std::unique_ptr<Expression> _length;
+};
+
 #undef TYPE_CLASS
 
 /**
@@ -146,6 +193,8 @@ public:
             HANDLE(Void);
             HANDLE(TemplatedType);
             HANDLE(Pointer);
+            HANDLE(Vector);
+            HANDLE(Array);
 #undef HANDLE
         }
     }
@@ -155,6 +204,8 @@ private:
     virtual Result operator()(const Void &) = 0;
     virtual Result operator()(const TemplatedType &) = 0;
     virtual Result operator()(const Pointer &) = 0;
+    virtual Result operator()(const Vector &) = 0;
+    virtual Result operator()(const Array &) = 0;
 };
 
 /**
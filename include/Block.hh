@@ -35,6 +35,7 @@
 namespace llvm {
     class Function;
     class BasicBlock;
+    class MDNode;
     class LLVMContext;
 }
 
@@ -72,8 +73,11 @@ public:
      * @brief Add a conditional jump to the provided blocks.
      *
      * This is a terminating instruction.
+     *
+     * @param weights `branch_weights` metadata for the branch, or NULL.
      */
-    void cond_jump(Value cond, Block then_b, Block else_b);
+    void cond_jump(Value cond, Block then_b, Block else_b,
+                   llvm::MDNode *weights = nullptr);
 
     /**
      * @brief Return with the given value, or `void` if none.
@@ -83,6 +87,14 @@ public:
     void return_(Value ret);
     void return_(void);
 
+    /**
+     * @brief Return the given LLVM value, which has already been lowered to
+     *        the function's ABI.
+     *
+     * This is a terminating instruction.
+     */
+    void return_(llvm::Value *ret);
+
     /**
      * @brief Check if the block is already terminated.
      */
@@ -0,0 +1,128 @@
+/**
+ * @file Codegen/Constant.hh
+ *
+ * @brief Compile-time evaluation of constant expressions and `const fn`s.
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AST/Toplevel.hh"
+#include "Error.hh"
+#include "Translator.hh"
+#include "Value.hh"
+
+namespace Craeft {
+
+namespace Codegen {
+
+/**
+ * @brief Get whether the given value is a compile-time constant integer or
+ *        float, or an array of them.
+ */
+bool is_constant(const Value &val);
+
+/**
+ * @brief Raised when an expression cannot be evaluated at compile time.
+ *
+ * Where a constant is not required this is not a mistake, and the expression
+ * is left to run instead.
+ */
+class NotConstant: public Error {
+public:
+    NotConstant(std::string message, SourcePos pos)
+        : Error("error", message, pos) {}
+};
+
+/**
+ * @brief Evaluator for constant expressions.
+ *
+ * Interprets the AST directly.  Operations go through the Translator, which
+ * folds them when their operands are constants, and the local variables of a
+ * `const fn` are held by the evaluator rather than on the stack, so no code
+ * is emitted.  Anything which cannot be evaluated raises a NotConstant, and
+ * mistakes like type errors raise an Error.
+ */
+class ConstantEval {
+public:
+    ConstantEval(Translator &translator)
+        : _translator(translator), steps(0), depth(0) {}
+
+    /**
+     * @brief Evaluate the given expression to a constant.
+     */
+    Value eval(const AST::Expression &expr);
+
+    /**
+     * @brief Evaluate an array length: a positive integer constant.
+     */
+    uint64_t eval_length(const AST::Expression &expr);
+
+    /**
+     * @brief Evaluate the initializer of a global of the given type.
+     *
+     * Numeric constants, including the elements of arrays, are converted to
+     * the type of the global if they fit in it exactly.
+     */
+    Value eval_initializer(const AST::Expression &expr, const Type &t);
+
+    /**
+     * @brief Evaluate a call to a `const fn`.
+     *
+     * @param args Constant arguments to the function.
+     */
+    Value call(const AST::FunctionDefinition &fd, std::vector<Value> &args,
+               SourcePos pos);
+
+private:
+    class ExpressionEval;
+    class StatementEval;
+
+    /**
+     * @brief The local variables of a `const fn` call, one map per scope.
+     *
+     * Variables which are declared but not yet assigned have a NULL value.
+     */
+    typedef std::vector<std::map<std::string, Value>> Frame;
+
+    /**
+     * @brief Count a step of evaluation, raising a NotConstant if there have
+     *        been too many.
+     */
+    void tick(SourcePos pos);
+
+    /**
+     * @brief Convert a constant to the given type for an initializer.
+     */
+    Value convert(Value val, const Type &t, SourcePos pos);
+
+    Translator &_translator;
+
+    unsigned long steps;
+    unsigned depth;
+};
+
+}
+
+}
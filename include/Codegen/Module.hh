@@ -27,6 +27,7 @@
 #include "llvm/Support/Host.h"
 
 #include "AST/Toplevel.hh"
+#include "Translator.hh"
 
 namespace Craeft {
 
@@ -45,6 +46,22 @@ public:
     // You need explicitly declared destructors for PImpl classes...
     ~ModuleGen();
 
+    /**
+     * @brief Set the visibility of `pub` functions defined from now on
+     *        which have no `visibility` attribute.
+     *
+     * Hidden functions are still visible to the rest of the shared object
+     * they are linked into, but not exported from it.
+     */
+    void set_default_visibility(Visibility visibility);
+
+    /**
+     * @brief Set the file whose top-level ASTs are generated from now on.
+     *
+     * Call this before each file when compiling several into the module.
+     */
+    void set_source_file(std::string filename);
+
     /**
      * @brief Generate code for the given top-level AST node.
      */
@@ -71,6 +88,15 @@ public:
      */
     void emit_asm(int fd);
 
+    /**
+     * @brief Emit LLVM bitcode to the given output stream.
+     *
+     * @param fd A file descriptor to an open, writable file.  Will not be
+     *           closed upon completion.
+     * @param thin_lto Whether to include a ThinLTO module summary.
+     */
+    void emit_bc(int fd, bool thin_lto);
+
     /**
      * @brief Verify the generated module.
      *
@@ -78,6 +104,30 @@ public:
      */
     void validate(std::ostream &out);
 
+    /**
+     * @brief Treat the module as the whole program.
+     *
+     * Gives every function and global defined in the module internal
+     * linkage, except the given entry points, so that the optimizer may
+     * freely inline, specialize and delete them.
+     *
+     * @param exports The names of the symbols to keep externally visible.
+     */
+    void internalize(const std::vector<std::string> &exports);
+
+    /**
+     * @brief Instrument the module to record an execution profile.
+     *
+     * @param out_file Where the program writes its profile, or empty for
+     *                 the profile runtime's default.
+     */
+    void instrument_profile(const std::string &out_file);
+
+    /**
+     * @brief Annotate the module with the given indexed execution profile.
+     */
+    void use_profile(const std::string &profile);
+
     /**
      * @brief Optimize the module.
      *
@@ -86,6 +136,15 @@ public:
      */
     void optimize(int level);
 
+    /**
+     * @brief Write a report of the code generated for each template.
+     *
+     * Lists each template's specializations, with the calls which made
+     * them, their sizes in IR instructions and in bytes of machine code, and
+     * the time spent generating them.  Should be called after `optimize`.
+     */
+    void write_template_report(std::ostream &);
+
 private:
     std::unique_ptr<ModuleGenImpl> pimpl;
 
@@ -51,16 +51,24 @@ namespace Codegen {
 class ModuleGenImpl: public AST::ToplevelVisitor<void> {
 public:
     ModuleGenImpl(std::string name, std::string triple, std::string fname);
+    void set_default_visibility(Visibility visibility);
+    void set_source_file(std::string filename);
     void validate(std::ostream &);
+    void internalize(const std::vector<std::string> &exports);
+    void instrument_profile(const std::string &out_file);
+    void use_profile(const std::string &profile);
     void optimize(int opt_level);
+    void write_template_report(std::ostream &);
 
     void emit_ir(std::ostream &);
     void emit_obj(int fd);
     void emit_asm(int fd);
+    void emit_bc(int fd, bool thin_lto);
 
     std::vector< std::pair< std::vector<Type>, TemplateValue> >
          codegen_function_with_name(
-            const AST::FunctionDefinition &, std::string);
+            const AST::FunctionDefinition &, std::string,
+            const TemplateValue *specialization = nullptr);
 
     // Visitors for top-level AST nodes.
 
@@ -71,11 +79,31 @@ private:
     void operator()(const AST::FunctionDeclaration &) override;
     void operator()(const AST::FunctionDefinition &) override;
     void operator()(const AST::TemplateFunctionDefinition &) override;
+    void operator()(const AST::GlobalDeclaration &) override;
 
     Translator _translator;
 
+    /**
+     * @brief The visibility of `pub` functions without a `visibility`
+     *        attribute.
+     */
+    Visibility default_visibility;
+
     /* Utilities. */
     Function<> type_of_ast_decl(const AST::FunctionDeclaration &fd);
+
+    /**
+     * @brief Translate `pub` and the attributes on a function for the
+     *        translator.
+     *
+     * @param is_definition Whether the function is being defined, rather
+     *                      than only declared.
+     * @param is_specialization Whether the function is being defined as a
+     *                          specialization of a template.
+     */
+    FunctionAttributes get_function_attributes(
+            const AST::FunctionDeclaration &fd, bool is_definition,
+            bool is_specialization = false);
 };
 
 }
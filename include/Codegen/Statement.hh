@@ -24,6 +24,11 @@
 
 #pragma once
 
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "AST/Statements.hh"
 #include "Translator.hh"
 
@@ -31,6 +36,18 @@ namespace Craeft {
 
 namespace Codegen {
 
+/**
+ * @brief Find the names of the variables whose addresses may be taken in
+ *        the given function body.
+ *
+ * Other local variables of scalar type are held in registers rather than
+ * memory.  Names are not resolved to declarations, so an address taken of
+ * any variable with a given name keeps all variables with that name in
+ * memory.
+ */
+std::set<std::string> find_address_taken(
+        const std::vector<std::unique_ptr<AST::Statement>> &body);
+
 /**
  * Codegen for statements: pass them on to the Translator.
  */
@@ -47,6 +64,20 @@ private:
     void operator()(const AST::Declaration &);
     void operator()(const AST::CompoundDeclaration &);
     void operator()(const AST::IfStatement &);
+    void operator()(const AST::WhileStatement &);
+    void operator()(const AST::ForStatement &);
+    void operator()(const AST::Become &);
+
+    /**
+     * @brief Emit the condition and body of a loop.
+     *
+     * @param step Statement to run after the body on each iteration, or
+     *             NULL.
+     */
+    void loop(const std::vector<AST::Attribute> &attributes,
+              const AST::Expression &condition,
+              const std::vector<std::unique_ptr<AST::Statement>> &body,
+              const AST::Statement *step, SourcePos pos);
 
     Translator &_translator;
 };
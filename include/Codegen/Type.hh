@@ -45,6 +45,8 @@ private:
     Type operator()(const AST::Void &) override;
     Type operator()(const AST::Pointer &) override;
     Type operator()(const AST::TemplatedType &) override;
+    Type operator()(const AST::Vector &) override;
+    Type operator()(const AST::Array &) override;
 
     Translator &translator;
 };
@@ -64,6 +66,8 @@ private:
     TemplateType operator()(const AST::Void &) override;
     TemplateType operator()(const AST::Pointer &) override;
     TemplateType operator()(const AST::TemplatedType &) override;
+    TemplateType operator()(const AST::Vector &) override;
+    TemplateType operator()(const AST::Array &) override;
 
     Translator &translator;
     std::vector<std::string> args;
@@ -32,12 +32,19 @@ namespace Craeft {
 
 namespace Codegen {
 
+/**
+ * @brief Apply the binary operator with the given name.
+ */
+Value apply_binop(Translator &translator, const std::string &op,
+                  Value lhs, Value rhs, SourcePos pos);
+
 /**
  * @brief Codegen for l-values: return the address of the given AST l-value.
  *
  * For a variable, return the address of the stack space that variable
  * occupies; for a dereference, just return the address being dereferenced;
- * and for a FieldAccess, return the address of that field.
+ * for a FieldAccess, return the address of that field; and for an Index, the
+ * address of that array element.
  */
 class LValueGen: public AST::LValueVisitor<Value> {
 public:
@@ -47,6 +54,7 @@ private:
     Value operator()(const AST::Variable &) override;
     Value operator()(const AST::Dereference &) override;
     Value operator()(const AST::FieldAccess &) override;
+    Value operator()(const AST::Index &) override;
 
     Translator &_translator;
 };
@@ -68,10 +76,12 @@ private:
     Value operator()(const AST::Reference &) override;
     Value operator()(const AST::Dereference &) override;
     Value operator()(const AST::FieldAccess &) override;
+    Value operator()(const AST::Index &) override;
     Value operator()(const AST::Binop &) override;
     Value operator()(const AST::FunctionCall &) override;
     Value operator()(const AST::TemplateFunctionCall &) override;
     Value operator()(const AST::Cast &) override;
+    Value operator()(const AST::ArrayLiteral &) override;
 
     Translator &_translator;
     llvm::LLVMContext &_ctx;
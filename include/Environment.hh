@@ -55,7 +55,18 @@ public:
     /**
      * @brief Create a new `Variable` based on the given instruction.
      */
-    Variable(Value val): val(val) {}
+    Variable(Value val): val(val), ssa_id(-1) {}
+
+    /**
+     * @brief Create a new `Variable` of the given type held in registers
+     *        rather than memory.
+     *
+     * @param ssa_id The variable's identifier in the translator's
+     *               SSABuilder.
+     */
+    Variable(Type t, unsigned ssa_id)
+        : val(nullptr, Pointer<>(std::make_shared<Type>(t))),
+          ssa_id(ssa_id) {}
 
     /**
      * @brief Get the type of this binding.
@@ -66,10 +77,17 @@ public:
      * @brief Get the value of this variable.
      *
      * Note that the returned value corresponds to a *pointer* to the actual
-     * contents of the variable.
+     * contents of the variable.  It is NULL for variables held in registers.
      */
     Value get_val(void) { return val; }
 
+    /**
+     * @brief Get whether this variable is held in registers.
+     */
+    bool is_ssa(void) const { return ssa_id >= 0; }
+
+    unsigned get_ssa_id(void) const { return ssa_id; }
+
 private:
     /**
      * @brief A value corresponding to a pointer to this variable.
@@ -78,6 +96,8 @@ private:
      * one would issue a "load" on this value.
      */
     Value val;
+
+    int ssa_id;
 };
 
 struct TemplateValue {
@@ -86,8 +106,8 @@ struct TemplateValue {
      */
     TemplateValue(std::shared_ptr<AST::FunctionDefinition> ast,
                   std::vector<std::string> arg_names,
-                  TemplateFunction ty)
-          : fd(ast), ty(ty), arg_names(arg_names) {} 
+                  TemplateFunction ty, bool erased = false)
+          : fd(ast), ty(ty), arg_names(arg_names), erased(erased) {} 
 
     /**
      * @brief The AST for this template function.
@@ -99,6 +119,13 @@ struct TemplateValue {
     TemplateFunction ty;
 
     std::vector<std::string> arg_names;
+
+    /**
+     * @brief Whether the template is `#[erased]`: compiled once, with a
+     *        descriptor of each type argument passed at run time, rather
+     *        than once per list of type arguments.
+     */
+    bool erased;
 };
 
 class Environment {
@@ -123,6 +150,12 @@ public:
      */
     bool bound(const std::string &name) const;
 
+    /**
+     * @brief Get whether the given name is bound to a template function in
+     *        any scope.
+     */
+    bool template_func_bound(const std::string &name) const;
+
     /**
      * @brief Find the given name in the map.
      *
@@ -132,7 +165,21 @@ public:
      */
     Variable lookup_identifier(const std::string &name, SourcePos pos) const;
 
-    Variable add_identifier(std::string name, Value val);
+    Variable add_identifier(std::string name, Variable var);
+
+    /**
+     * @brief Record the stack slot of a local variable declared in the
+     *        innermost scope.
+     */
+    void add_local(llvm::AllocaInst *slot) { locals.back().push_back(slot); }
+
+    /**
+     * @brief Get the stack slots of the local variables declared in the
+     *        innermost scope, in order of declaration.
+     */
+    const std::vector<llvm::AllocaInst *> &get_locals(void) const {
+        return locals.back();
+    }
 
     void add_type(std::string name, Type t);
 
@@ -144,6 +191,10 @@ public:
         templatefunc_map.bind(name, v);
     }
 
+    void add_const_func(std::string name, const AST::FunctionDefinition *fd) {
+        constfunc_map.bind(name, fd);
+    }
+
     /**
      * @brief Find the given type name in the map.
      *
@@ -157,11 +208,28 @@ public:
     const TemplateValue &lookup_template_func(const std::string &func_name,
                                               SourcePos pos) const;
 
+    /**
+     * @brief Get the names of the template functions in scope.
+     */
+    std::vector<std::string> template_func_names(void) const {
+        return templatefunc_map.keys();
+    }
+
+    /**
+     * @brief Find the definition of the given `const fn`.
+     *
+     * @return The definition, or NULL if there is no such `const fn`.
+     */
+    const AST::FunctionDefinition *lookup_const_func(
+            const std::string &func_name) const;
+
 private:
     Scope<Variable> ident_map;
     Scope<Type> type_map;
     Scope<TemplateStruct> template_map;
     Scope<TemplateValue> templatefunc_map;
+    Scope<const AST::FunctionDefinition *> constfunc_map;
+    std::vector<std::vector<llvm::AllocaInst *> > locals;
 };
 
 }
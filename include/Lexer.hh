@@ -36,6 +36,16 @@ namespace Craeft {
 
 class Lexer {
 public:
+    /**
+     * @brief A saved position in the file, from which lexing can resume.
+     */
+    struct Mark {
+        /** @brief Offset in the file of the first character of the token. */
+        std::streamoff offset;
+        /** @brief Source position of the token. */
+        SourcePos pos;
+    };
+
     /**
      * @brief Create a new lexer, tokenizing the given input stream.
      *
@@ -43,6 +53,13 @@ public:
      */
     Lexer(const std::string &fname);
 
+    /**
+     * @brief Create a new lexer, resuming from a mark taken on the same file.
+     *
+     * The first token lexed is the one the mark was taken at.
+     */
+    Lexer(const std::string &fname, const Mark &mark);
+
     /**
      * @brief Get the position the lexer is currently at.
      */
@@ -53,6 +70,11 @@ public:
      */
     const Tok::Token &get_tok(void) const;
 
+    /**
+     * @brief Get a mark at the last lexed token.
+     */
+    Mark get_mark(void) const;
+
     /**
      * @brief Return whether the lexer has reached the end of the stream.
      */
@@ -73,6 +95,12 @@ private:
     std::unique_ptr<Tok::Token> tok;
     SourcePos pos;
     std::ifstream stream;
+
+    /* Number of characters read so far, and where the last token began. */
+    std::streamoff offset;
+    std::streamoff tok_offset;
+    uint16_t tok_charno;
+    uint16_t tok_lineno;
 };
 
 }
@@ -40,6 +40,11 @@ class ParserImpl {
 public:
     ParserImpl(const std::string &fname);
 
+    /**
+     * @brief Create a ParserImpl resuming from a mark in the given file.
+     */
+    ParserImpl(const std::string &fname, const Lexer::Mark &mark);
+
     /**
      * @brief Parse the next expression from the lexer.
      *
@@ -74,6 +79,12 @@ private:
      */
     std::unique_ptr<AST::Expression> parse_unary(void);
 
+    /**
+     * @brief Parse any indices (`[i]`) applied to the given expression.
+     */
+    std::unique_ptr<AST::Expression> parse_indices(
+            std::unique_ptr<AST::Expression> array);
+
     /**
      * @brief Parse a series of binops, given the first one.
      */
@@ -122,16 +133,71 @@ private:
      */
     std::unique_ptr<AST::IfStatement> parse_if_statement(void);
 
+    /**
+     * @brief Parse a `while` loop, with the given attributes.
+     */
+    std::unique_ptr<AST::WhileStatement> parse_while_statement(
+            std::vector<AST::Attribute> attributes);
+
+    /**
+     * @brief Parse a `for` loop, with the given attributes.
+     */
+    std::unique_ptr<AST::ForStatement> parse_for_statement(
+            std::vector<AST::Attribute> attributes);
+
+    /**
+     * @brief Parse a series of attributes (`#[name(args)]`).
+     */
+    std::vector<AST::Attribute> parse_attributes(void);
+
     /**
      * @brief Parse a return statement.
      */
     std::unique_ptr<AST::Statement> parse_return(void);
+
+    /**
+     * @brief Parse a tail call (`become f(args)`).
+     */
+    std::unique_ptr<AST::Statement> parse_become(void);
     
     std::unique_ptr<AST::TypeDeclaration> parse_type_declaration(void);
 
     std::unique_ptr<AST::Toplevel> parse_struct_declaration(void);
 
-    std::unique_ptr<AST::Toplevel> parse_function(void);
+    /**
+     * @brief Parse a function declaration or definition.
+     *
+     * @param is_const Whether the function was preceded by `const`.
+     * @param is_public Whether the function was preceded by `pub`.
+     * @param attributes Attributes preceding the function.
+     */
+    std::unique_ptr<AST::Toplevel> parse_function(
+            bool is_const, bool is_public = false,
+            std::vector<AST::Attribute> attributes
+                = std::vector<AST::Attribute>());
+
+    /**
+     * @brief Parse a function or global variable after `pub` and any
+     *        attributes, shifting the `pub`.
+     */
+    std::unique_ptr<AST::Toplevel> parse_public(
+            std::vector<AST::Attribute> attributes
+                = std::vector<AST::Attribute>());
+
+    /**
+     * @brief Parse a global variable, after any attributes, `const` or
+     *        `thread_local`.
+     *
+     * @param is_const Whether the global was preceded by `const`.
+     * @param is_thread_local Whether the global was preceded by
+     *                        `thread_local`.
+     * @param start The position of the start of the declaration.
+     * @param is_public Whether the global was preceded by `pub`.
+     */
+    std::unique_ptr<AST::Toplevel> parse_global(
+            bool is_const, bool is_thread_local,
+            std::vector<AST::Attribute> attributes, SourcePos start,
+            bool is_public = false);
 
     std::vector<std::unique_ptr<AST::Expression>> parse_expr_list(void);
 
@@ -141,6 +207,16 @@ private:
 
     std::vector<std::unique_ptr<AST::Statement>> parse_block(void);
 
+    /**
+     * @brief Skip over a block without parsing it.
+     *
+     * Only matches up braces, so syntax errors inside the block are not
+     * reported until it is parsed.
+     *
+     * @return A mark at the opening brace, from which to parse it later.
+     */
+    Lexer::Mark skip_block(void);
+
     std::vector<std::unique_ptr<AST::Declaration>> parse_arg_list(void);
 
     /**
@@ -159,6 +235,11 @@ private:
 
     [[noreturn]] inline void _throw(std::string message);
 
+    /**
+     * @brief The name of the file being parsed.
+     */
+    std::string fname;
+
     /**
      * @brief The held lexer.
      */
@@ -0,0 +1,122 @@
+/**
+ * @file SSA.hh
+ *
+ * @brief On-the-fly construction of SSA form for local variables.
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/IR/ValueHandle.h"
+
+// Forward declarations.
+namespace llvm {
+    class BasicBlock;
+    class PHINode;
+    class Type;
+    class Value;
+}
+
+namespace Craeft {
+
+/**
+ * @brief Builds SSA form for variables as code is emitted, so that they need
+ *        no stack slots.
+ *
+ * Follows Braun et al., "Simple and Efficient Construction of Static Single
+ * Assignment Form" (CC 2013).  Each variable's definitions are recorded per
+ * block; a read in a block with no definition looks through its
+ * predecessors, placing a phi where they may disagree.  A block is *sealed*
+ * once all of its predecessors are known: until then, reads in it get
+ * placeholder phis, which are completed when it is sealed.  Phis which turn
+ * out to merge only one value are removed.
+ */
+class SSABuilder {
+public:
+    /**
+     * @brief Add a new variable of the given LLVM type.
+     *
+     * @param name Name to give the variable's phis in the IR.
+     *
+     * @return An identifier for the variable.
+     */
+    unsigned add_variable(llvm::Type *t, const std::string &name);
+
+    /**
+     * @brief Record that the variable has the given value at the end of the
+     *        block (so far).
+     */
+    void write(unsigned var, llvm::BasicBlock *b, llvm::Value *val);
+
+    /**
+     * @brief Get the value of the variable at the end of the block (so far).
+     */
+    llvm::Value *read(unsigned var, llvm::BasicBlock *b);
+
+    /**
+     * @brief Declare that all predecessors of the block have been emitted.
+     */
+    void seal(llvm::BasicBlock *b);
+
+    /**
+     * @brief Forget all variables and blocks, at the end of a function.
+     */
+    void clear(void);
+
+private:
+    llvm::Value *read_recursive(unsigned var, llvm::BasicBlock *b);
+    llvm::PHINode *create_phi(unsigned var, llvm::BasicBlock *b);
+    llvm::Value *add_phi_operands(unsigned var, llvm::PHINode *phi);
+    llvm::Value *try_remove_trivial_phi(llvm::PHINode *phi);
+
+    /**
+     * @brief Get whether every incoming value of the phi has been added.
+     */
+    bool is_complete(llvm::PHINode *phi);
+
+    /**
+     * @brief The type and name of each variable, by identifier.
+     */
+    std::vector<std::pair<llvm::Type *, std::string> > vars;
+
+    /**
+     * @brief The current definition of each variable in each block.
+     *
+     * The handles follow phis as they are replaced.
+     */
+    std::map<std::pair<llvm::BasicBlock *, unsigned>, llvm::WeakTrackingVH>
+        defs;
+
+    /**
+     * @brief Placeholder phis in unsealed blocks, with their variables.
+     */
+    std::map<llvm::BasicBlock *,
+             std::vector<std::pair<unsigned, llvm::PHINode *> > > incomplete;
+
+    std::set<llvm::BasicBlock *> sealed;
+};
+
+}
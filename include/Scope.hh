@@ -24,6 +24,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <boost/range/adaptor/reversed.hpp>
 
 namespace Craeft {
@@ -63,6 +68,24 @@ public:
         map.back().push_back(std::pair<std::string, T>(key, binding));
     }
 
+    /**
+     * @brief Get every bound key, outermost scope first, each only once.
+     */
+    std::vector<std::string> keys(void) const {
+        std::vector<std::string> result;
+
+        for (const auto &vec: map) {
+            for (const auto &pair: vec) {
+                if (std::find(result.begin(), result.end(), pair.first)
+                        == result.end()) {
+                    result.push_back(pair.first);
+                }
+            }
+        }
+
+        return result;
+    }
+
     const T &operator[](const std::string &key) const {
         for (const auto &vec: boost::adaptors::reverse(map)) {
             for (const auto &pair: boost::adaptors::reverse(vec)) {
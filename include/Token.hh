@@ -61,6 +61,9 @@ public:
         CloseParen,
         OpenBrace,
         CloseBrace,
+        OpenBracket,
+        CloseBracket,
+        Hash,
         Comma,
         Semicolon,
         Fn,
@@ -70,6 +73,11 @@ public:
         If,
         Else,
         While,
+        For,
+        Const,
+        Become,
+        ThreadLocal,
+        Pub,
         InvalidToken
     };
 
@@ -232,6 +240,18 @@ struct CloseBrace: public Token {
     virtual std::string repr(void) const override { return "}"; }
     TOK_SIMPLE(CloseBrace);
 };
+struct OpenBracket: public Token {
+    virtual std::string repr(void) const override { return "["; }
+    TOK_SIMPLE(OpenBracket);
+};
+struct CloseBracket: public Token {
+    virtual std::string repr(void) const override { return "]"; }
+    TOK_SIMPLE(CloseBracket);
+};
+struct Hash: public Token {
+    virtual std::string repr(void) const override { return "#"; }
+    TOK_SIMPLE(Hash);
+};
 struct Comma: public Token {
     virtual std::string repr(void) const override { return ","; }
     TOK_SIMPLE(Comma);
@@ -268,6 +288,26 @@ struct While: public Token {
     virtual std::string repr(void) const override { return "while"; }
     TOK_SIMPLE(While);
 };
+struct For: public Token {
+    virtual std::string repr(void) const override { return "for"; }
+    TOK_SIMPLE(For);
+};
+struct Become: public Token {
+    virtual std::string repr(void) const override { return "become"; }
+    TOK_SIMPLE(Become);
+};
+struct ThreadLocal: public Token {
+    virtual std::string repr(void) const override { return "thread_local"; }
+    TOK_SIMPLE(ThreadLocal);
+};
+struct Pub: public Token {
+    virtual std::string repr(void) const override { return "pub"; }
+    TOK_SIMPLE(Pub);
+};
+struct Const: public Token {
+    virtual std::string repr(void) const override { return "const"; }
+    TOK_SIMPLE(Const);
+};
 struct InvalidToken: public Token {
     virtual std::string repr(void) const override { return "[INVALID]"; }
     TOK_SIMPLE(InvalidToken);
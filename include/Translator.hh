@@ -25,6 +25,7 @@
 #pragma once
 
 #include <memory>
+#include <set>
 
 #include "llvm/Support/Host.h"
 #include "llvm/IR/IRBuilder.h"
@@ -55,6 +56,181 @@ public:
     std::unique_ptr<IfThenElseImpl> pimpl;
 };
 
+/**
+ * @brief Abstract implementation of `Loop`.
+ */
+struct LoopImpl;
+
+/**
+ * @brief Abstract representation of a Craeft loop.
+ *
+ * Should only be used through `Translator`'s methods on it.
+ */
+class Loop {
+public:
+    Loop(std::unique_ptr<LoopImpl> pimpl);
+    Loop(Loop &&other);
+    ~Loop(void);
+    std::unique_ptr<LoopImpl> pimpl;
+};
+
+/**
+ * @brief Abstract implementation of `ShortCircuit`.
+ */
+struct ShortCircuitImpl;
+
+/**
+ * @brief Abstract representation of a short-circuiting `&&` or `||`.
+ *
+ * Should only be used through `Translator`'s methods on it.
+ */
+class ShortCircuit {
+public:
+    ShortCircuit(std::unique_ptr<ShortCircuitImpl> pimpl);
+    ShortCircuit(ShortCircuit &&other);
+    ~ShortCircuit(void);
+    std::unique_ptr<ShortCircuitImpl> pimpl;
+};
+
+/**
+ * @brief Optimization hints for a loop, passed on to LLVM's loop passes.
+ */
+struct LoopHints {
+    /**
+     * @brief Whether to ask for the loop to be unrolled.
+     */
+    bool unroll;
+
+    /**
+     * @brief The factor to unroll by, or 0 to leave it to the optimizer.
+     */
+    unsigned unroll_count;
+
+    /**
+     * @brief Whether to ask for the loop to be vectorized.
+     */
+    bool vectorize;
+
+    /**
+     * @brief The vector width to use, or 0 to leave it to the optimizer.
+     */
+    unsigned vectorize_width;
+
+    LoopHints(void): unroll(false), unroll_count(0),
+                     vectorize(false), vectorize_width(0) {}
+};
+
+/**
+ * @brief Which dynamic shared objects an exported symbol is visible from;
+ *        see the ELF gABI.
+ */
+enum class Visibility {
+    /**
+     * @brief Visible from other objects, and may be overridden by them.
+     */
+    DEFAULT,
+    /**
+     * @brief Visible only within the shared object defining it.
+     */
+    HIDDEN,
+    /**
+     * @brief Visible from other objects, but always bound within the one
+     *        defining it.
+     */
+    PROTECTED
+};
+
+/**
+ * @brief Properties of a function given by `pub` and its attributes.
+ */
+struct FunctionAttributes {
+    /**
+     * @brief Whether the function is rarely called, so that paths calling it
+     *        are laid out away from the rest of the code.
+     */
+    bool cold;
+
+    /**
+     * @brief Whether a definition of the function is visible outside the
+     *        module.  Other definitions get internal linkage.
+     */
+    bool is_public;
+
+    /**
+     * @brief Whether the function is a specialization of a template.  Each
+     *        module defines the ones it uses, as `linkonce_odr`.
+     */
+    bool is_specialization;
+
+    /**
+     * @brief The type parameters of an `#[erased]` template being compiled,
+     *        whose descriptors are passed before the arguments.
+     */
+    std::vector<std::string> erased_parameters;
+
+    /**
+     * @brief The visibility of the function's symbol, if it is public or
+     *        only declared.
+     */
+    Visibility visibility;
+
+    FunctionAttributes(void)
+        : cold(false), is_public(false), is_specialization(false),
+          visibility(Visibility::DEFAULT) {}
+};
+
+/**
+ * @brief How thread-local variables are accessed; see the ELF TLS ABI.
+ */
+enum class TLSModel {
+    /**
+     * @brief Not thread-local.
+     */
+    NONE,
+    /**
+     * @brief Accessible from any module, including dynamically loaded ones.
+     */
+    GENERAL_DYNAMIC,
+    /**
+     * @brief Accessed only from the module defining it.
+     */
+    LOCAL_DYNAMIC,
+    /**
+     * @brief Defined in a module loaded at startup.
+     */
+    INITIAL_EXEC,
+    /**
+     * @brief Defined and accessed only in the executable.
+     */
+    LOCAL_EXEC
+};
+
+/**
+ * @brief Properties of a global variable given by `pub`, `thread_local` and
+ *        its attributes.
+ */
+struct GlobalAttributes {
+    /**
+     * @brief Whether the global is visible outside the module.  Others get
+     *        internal linkage.
+     */
+    bool is_public;
+
+    /**
+     * @brief The visibility of the global's symbol, if it is public.
+     */
+    Visibility visibility;
+
+    /**
+     * @brief How the global is stored per thread, if it is.
+     */
+    TLSModel tls;
+
+    GlobalAttributes(void)
+        : is_public(false), visibility(Visibility::DEFAULT),
+          tls(TLSModel::NONE) {}
+};
+
 class TranslatorImpl;
 
 /**
@@ -70,6 +246,14 @@ public:
 
     ~Translator();
 
+    /**
+     * @brief Set the file that code is generated from until the next call.
+     *
+     * For several files compiled into the one module, this should be
+     * called before generating code for each of them.
+     */
+    void set_source_file(std::string filename);
+
     /**
      * @defgroup Craeft instructions.
      *
@@ -200,6 +384,30 @@ public:
      */
     Value field_address(Value ptr, std::string field, SourcePos pos);
 
+    /**
+     * @brief Get the offset in bytes of the given field of the given struct
+     *        type, as a constant.
+     */
+    Value offset_of(const Type &t, std::string field, SourcePos pos);
+
+    /**
+     * @brief Get an element of the given array.
+     *
+     * @param array An array value.
+     * @param index An integer index into the array.
+     */
+    Value index(Value array, Value index, SourcePos pos);
+
+    /**
+     * @brief Get the address of an element of the given array pointer.
+     *
+     * Produces an in-bounds GEP through the array type.
+     *
+     * @param ptr   A pointer to an array type.
+     * @param index An integer index into the pointed array.
+     */
+    Value index_address(Value ptr, Value index, SourcePos pos);
+
     /**
      * @brief Function call.
      */
@@ -211,11 +419,45 @@ public:
     Value call(std::string func, std::vector<Type> &templ_args,
                std::vector<Value> &v_args, SourcePos pos);
 
+    /**
+     * @brief Guaranteed tail call: call the function and return its result,
+     *        reusing the current function's stack frame.
+     *
+     * The callee must return the same type as the current function, and its
+     * arguments must be passed the same way.
+     */
+    void become(std::string func, std::vector<Value> &args, SourcePos pos);
+
+    /**
+     * @brief Guaranteed tail call to a template function.
+     */
+    void become(std::string func, std::vector<Type> &templ_args,
+                std::vector<Value> &v_args, SourcePos pos);
+
     /**
      * Get a string literal as a char pointer.
+     *
+     * Identical literals share a single constant in the module.
      */
     Value string_literal(const std::string &str);
 
+    /**
+     * @brief Make an array of the given elements, which must all have the
+     *        same type.
+     */
+    Value array_literal(std::vector<Value> &elements, SourcePos pos);
+
+    /**
+     * @brief Create a global variable with the given name and type.
+     *
+     * @param init A constant of type `t` to initialize the global with, or
+     *             NULL to zero-initialize it.
+     * @param is_const Whether the global is read-only.
+     */
+    void create_global(const std::string &name, const Type &t,
+                       const Value *init, bool is_const,
+                       const GlobalAttributes &attrs, SourcePos pos);
+
     /**
      * @brief Create a variable with the given name and type.
      */
@@ -254,6 +496,13 @@ public:
      */
     Value get_identifier_value(std::string ident, SourcePos pos);
 
+    /**
+     * @brief Get the value of the given `const` global.
+     *
+     * Raise an Error if the identifier is not a `const` global.
+     */
+    Value get_constant_value(std::string ident, SourcePos pos);
+
     /**
      * @brief Look up the given type by name.
      */
@@ -280,17 +529,63 @@ public:
 
     /**
      * @brief Register a template function.
+     *
+     * @param erased Whether to compile the template once, passing
+     *               descriptors of its type arguments at run time, rather
+     *               than specializing it.
      */
     void register_template(std::string name,
                            std::shared_ptr<AST::FunctionDefinition>,
                            std::vector<std::string> args,
-                           TemplateFunction func);
+                           TemplateFunction func, bool erased = false);
 
     /**
      * @brief Register a template struct.
      */
     void register_template(TemplateStruct, std::string name);
 
+    /**
+     * @brief Register the definition of a `const fn`, so that calls to it
+     *        may be evaluated at compile time.
+     */
+    void register_const_function(std::string name,
+                                 const AST::FunctionDefinition *def);
+
+    /**
+     * @brief Find the definition of a `const fn`.
+     *
+     * @return The definition, or NULL if `name` is not a `const fn`.
+     */
+    const AST::FunctionDefinition *lookup_const_function(std::string name);
+
+    /**
+     * @brief Record that a call to a `const fn` with the given constant
+     *        arguments could not be evaluated at compile time.
+     */
+    void mark_not_constant(const AST::FunctionDefinition *def,
+                           const std::vector<Value> &args);
+
+    /**
+     * @brief Get whether a call to a `const fn` with the given constant
+     *        arguments is known not to be evaluable at compile time.
+     */
+    bool known_not_constant(const AST::FunctionDefinition *def,
+                            const std::vector<Value> &args);
+
+    /**
+     * @brief Get whether a template function with the given name is in
+     *        scope.
+     */
+    bool is_template_function(std::string name);
+
+    /**
+     * @brief Get the name of the specialization of the given template with
+     *        the given type arguments, or of its single compilation if it is
+     *        `#[erased]`.
+     */
+    std::string specialization_name(const TemplateValue &tv,
+                                    const std::vector<Type> &args);
+
     Struct<TemplateType> respecialize_template(std::string template_name,
                                          const std::vector<TemplateType>
                                               &args,
@@ -325,6 +620,53 @@ public:
      */
     void end_ifthenelse(IfThenElse structure);
 
+    /**
+     * @brief Create and return a Loop structure.
+     *
+     * New instructions are added in the loop header, which should compute
+     * the loop condition.
+     *
+     * @param hints Optimization hints attached to the loop.
+     */
+    Loop create_loop(LoopHints hints, SourcePos pos);
+
+    /**
+     * @brief Branch on the loop condition and start emitting instructions in
+     *        the loop body.
+     *
+     * Opens a new namespace for the body.
+     */
+    void loop_condition(Loop &structure, Value cond, SourcePos pos);
+
+    /**
+     * @brief Jump back to the loop header and start emitting instructions
+     *        after the loop.
+     */
+    void end_loop(Loop structure);
+
+    /**
+     * @brief Check whether the current block already ends in a return or
+     *        jump, so that any code generated from here on is unreachable.
+     */
+    bool is_terminated(void);
+
+    /**
+     * @brief Start a short-circuiting `&&` or `||`.
+     *
+     * Branches on the left-hand side; new instructions, which should compute
+     * the right-hand side, are only executed if it does not already decide
+     * the result.
+     *
+     * @param is_and Whether the operator is `&&` rather than `||`.
+     */
+    ShortCircuit create_short_circuit(Value lhs, bool is_and, SourcePos pos);
+
+    /**
+     * @brief Join the two paths of a short-circuiting operator and return its
+     *        result.
+     */
+    Value end_short_circuit(ShortCircuit structure, Value rhs, SourcePos pos);
+
     /** @} */
 
     /**
@@ -333,11 +675,29 @@ public:
      * @{
      */
 
-    void create_function_prototype(Function<> f, std::string name);
+    /**
+     * @brief Declare a function defined elsewhere.
+     *
+     * Repeated declarations of the same function, for example one in each
+     * of several files compiled together, all refer to the same function.
+     */
+    void create_function_prototype(Function<> f, std::string name,
+                                   const FunctionAttributes &attrs,
+                                   SourcePos pos);
 
+    /**
+     * @brief Start defining a function.
+     *
+     * @param address_taken Names of the variables in the function which need
+     *                      addresses.  Other local variables of scalar type
+     *                      are held in registers.
+     */
     void create_and_start_function(Function<> f,
                                    std::vector<std::string> args,
-                                   std::string name);
+                                   std::string name,
+                                   const std::set<std::string> &address_taken,
+                                   const FunctionAttributes &attrs,
+                                   SourcePos pos);
 
     void create_struct(Struct<> t);
     void create_struct(TemplateStruct t);
@@ -363,11 +723,60 @@ public:
      */
 
     void validate(std::ostream &);
+
+    /**
+     * @brief Give internal linkage to every function and global defined in
+     *        the module except the given ones.
+     *
+     * Only valid when the module contains the whole program, or at least
+     * every caller of the internalized functions.
+     */
+    void internalize(const std::vector<std::string> &exports);
+
+    /**
+     * @brief Instrument the module to record an execution profile.
+     *
+     * Must be called before `optimize`.  The resulting code must be linked
+     * with the LLVM profile runtime (e.g. with `clang -fprofile-generate`).
+     *
+     * @param out_file Where the instrumented program writes its raw profile,
+     *                 or empty for the runtime's default.
+     */
+    void instrument_profile(const std::string &out_file);
+
+    /**
+     * @brief Annotate the module with an execution profile.
+     *
+     * Attaches branch weights and function entry counts, which later guide
+     * inlining and block layout.  Must be called before `optimize`.
+     *
+     * @param profile An indexed profile, as produced by `llvm-profdata`.
+     */
+    void use_profile(const std::string &profile);
+
     void optimize(int opt_level);
     void emit_ir(std::ostream &fd);
     void emit_obj(int fd);
     void emit_asm(int fd);
 
+    /**
+     * @brief Emit LLVM bitcode.
+     *
+     * @param thin_lto Whether to include a ThinLTO module summary, so that
+     *                 the bitcode can take part in a ThinLTO link.
+     */
+    void emit_bc(int fd, bool thin_lto);
+
+    /**
+     * @brief Write a report of the specializations of each template: how
+     *        many were made, which calls made them, how much code they
+     *        compiled to, and how long they took to generate.
+     *
+     * Should be called after `optimize`, as it compiles a copy of the
+     * module to measure the machine code of each specialization.
+     */
+    void write_template_report(std::ostream &out);
+
     /** @} */
 
     /**
@@ -24,14 +24,22 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <map>
+#include <set>
+#include <utility>
 
 #include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/AtomicOrdering.h"
 
+#include "ABI.hh"
 #include "Block.hh"
 #include "Environment.hh"
 #include "Error.hh"
+#include "SSA.hh"
 #include "Translator.hh"
 #include "Type.hh"
 #include "Value.hh"
@@ -48,6 +56,8 @@ public:
     TranslatorImpl(std::string module_name, std::string filename,
                    std::string triple);
 
+    void set_source_file(std::string filename);
+
     Value cast(Value val, const Type &t, SourcePos pos);
     Value add_load(Value pointer, SourcePos pos);
     void add_store(Value pointer, Value, SourcePos pos);
@@ -74,11 +84,21 @@ public:
 
     Value field_access(Value lhs, std::string field, SourcePos pos);
     Value field_address(Value ptr, std::string field, SourcePos pos);
+    Value offset_of(const Type &t, std::string field, SourcePos pos);
+    Value index(Value array, Value index, SourcePos pos);
+    Value index_address(Value ptr, Value index, SourcePos pos);
 
     Value call(std::string func, std::vector<Value> &args, SourcePos pos);
     Value call(std::string func, std::vector<Type> &templ_args,
                std::vector<Value> &v_args, SourcePos pos);
+    void become(std::string func, std::vector<Value> &args, SourcePos pos);
+    void become(std::string func, std::vector<Type> &templ_args,
+                std::vector<Value> &v_args, SourcePos pos);
     Value string_literal(const std::string &str);
+    Value array_literal(std::vector<Value> &elements, SourcePos pos);
+    void create_global(const std::string &name, const Type &t,
+                       const Value *init, bool is_const,
+                       const GlobalAttributes &attrs, SourcePos pos);
     Variable declare(const std::string &name, const Type &t);
     void assign(const std::string &varname, Value val, SourcePos pos);
     void return_(Value val, SourcePos pos);
@@ -86,6 +106,7 @@ public:
 
     Value get_identifier_addr(std::string ident, SourcePos pos);
     Value get_identifier_value(std::string ident, SourcePos pos);
+    Value get_constant_value(std::string ident, SourcePos pos);
     Type lookup_type(std::string tname, SourcePos pos);
 
     void push_scope(void);
@@ -104,16 +125,36 @@ public:
     void register_template(std::string name,
                            std::shared_ptr<AST::FunctionDefinition>,
                            std::vector<std::string> args,
-                           TemplateFunction func);
+                           TemplateFunction func, bool erased);
     void register_template(TemplateStruct, std::string name);
-
+    void register_const_function(std::string name,
+                                 const AST::FunctionDefinition *def);
+    const AST::FunctionDefinition *lookup_const_function(std::string name);
+    void mark_not_constant(const AST::FunctionDefinition *def,
+                           const std::vector<Value> &args);
+    bool known_not_constant(const AST::FunctionDefinition *def,
+                            const std::vector<Value> &args);
+    bool is_template_function(std::string name);
+    std::string specialization_name(const TemplateValue &tv,
+                                    const std::vector<Type> &args);
 
     IfThenElse create_ifthenelse(Value cond, SourcePos pos);
     void point_to_else(IfThenElse &structure);
     void end_ifthenelse(IfThenElse structure);
-    void create_function_prototype(Function<> f, std::string name);
+    Loop create_loop(LoopHints hints, SourcePos pos);
+    void loop_condition(Loop &structure, Value cond, SourcePos pos);
+    void end_loop(Loop structure);
+    bool is_terminated(void);
+    ShortCircuit create_short_circuit(Value lhs, bool is_and, SourcePos pos);
+    Value end_short_circuit(ShortCircuit structure, Value rhs, SourcePos pos);
+    void create_function_prototype(Function<> f, std::string name,
+                                   const FunctionAttributes &attrs,
+                                   SourcePos pos);
     void create_and_start_function(Function<> f, std::vector<std::string> args,
-                                   std::string name);
+                                   std::string name,
+                                   const std::set<std::string> &address_taken,
+                                   const FunctionAttributes &attrs,
+                                   SourcePos pos);
 
     void create_struct(Struct<> t);
 
@@ -121,10 +162,15 @@ public:
         end_function(void);
 
     void validate(std::ostream &);
+    void internalize(const std::vector<std::string> &exports);
+    void instrument_profile(const std::string &out_file);
+    void use_profile(const std::string &profile);
     void optimize(int opt_level);
     void emit_ir(std::ostream &);
     void emit_obj(int fd);
     void emit_asm(int fd);
+    void emit_bc(int fd, bool thin_lto);
+    void write_template_report(std::ostream &out);
 
     llvm::LLVMContext &get_ctx(void) { return context; }
 
@@ -132,11 +178,157 @@ private:
     inline std::pair<unsigned, Type *>
     get_field_idx(Type t, std::string field, SourcePos pos);
 
+    /**
+     * @brief Check an index into an array of the given type, and widen it
+     *        to 64 bits.
+     */
+    inline llvm::Value *get_array_idx(const Array<> &t, Value index,
+                                      SourcePos pos);
+
+    /**
+     * @brief Call the given function, lowering the arguments and return
+     *        value to its ABI.
+     */
+    Value lowered_call(llvm::Function *callee, const Function<> &ty,
+                       std::vector<Value> &args);
+
+    /**
+     * @brief Call an `#[erased]` template, passing descriptors of the type
+     *        arguments before the value arguments.
+     */
+    Value erased_call(std::string func, const TemplateValue &tv,
+                      std::vector<Type> &templ_args,
+                      std::vector<Value> &v_args, SourcePos pos);
+
+    /**
+     * @brief Get a pointer to the descriptor of the given type: its size
+     *        then its alignment, as U64s.
+     *
+     * Descriptors of erased types are those passed to the current function.
+     */
+    Value type_descriptor(const Type &t, SourcePos pos);
+
+    /**
+     * @brief Load the size (field 0) or alignment (field 1) of an erased
+     *        type from its descriptor.
+     */
+    llvm::Value *erased_layout(const Erased &t, unsigned field);
+
+    /**
+     * @brief Scale an integer added to or subtracted from a pointer to an
+     *        erased type by the type's size, and raise an Error for
+     *        arithmetic on pointers to other types of unknown size.
+     */
+    void scale_erased_offset(Value &lhs, Value &rhs, SourcePos pos);
+
+    /**
+     * @brief Call the given function as a guaranteed tail call, and return
+     *        its result.
+     */
+    void tail_call(llvm::Function *callee, const Function<> &ty,
+                   std::vector<Value> &args, SourcePos pos);
+
+    /**
+     * @brief Lower the given arguments to the function's ABI, appending
+     *        them to `llvm_args`.
+     */
+    void lower_args(const FunctionABI &f_abi, std::vector<Value> &args,
+                    std::vector<llvm::Value *> &llvm_args);
+
+    /**
+     * @brief Give the fast calling convention to internal functions which
+     *        are only ever called directly.
+     *
+     * Their callers are all in the module, so need not follow the C
+     * convention.  Functions joined by `become` must agree on a convention,
+     * so keep the C one if either must.
+     */
+    void use_fast_calls(void);
+
+    /**
+     * @brief Replace specializations of a template with others of the same
+     *        layout class which compiled to the same code.
+     *
+     * For example, one which only moves its `T *` arguments around compiles
+     * to the same code whatever `T` is.  Each module keeps the first such
+     * specialization it made; other modules have their own copies of the
+     * rest.
+     */
+    void share_specializations(void);
+
+    /**
+     * @brief Find a (non-builtin) function to call, and check the arguments
+     *        against its type.
+     */
+    std::pair<llvm::Function *, Function<> >
+        lookup_callee(std::string func, std::vector<Value> &args,
+                      SourcePos pos);
+
+    /**
+     * @brief Find a template function specialization to call, declaring it
+     *        if it has not been already.
+     */
+    std::pair<llvm::Function *, Function<> >
+        lookup_template_callee(std::string func,
+                               std::vector<Type> &templ_args,
+                               std::vector<Value> &v_args, SourcePos pos);
+
+    /**
+     * @brief Allocate a stack slot in the current function's entry block.
+     *
+     * Slots allocated there are allocated once per call, however often the
+     * code needing them runs, and may be promoted to registers.
+     */
+    llvm::AllocaInst *create_temporary(llvm::Type *t,
+                                       const std::string &name = "");
+
+    /**
+     * @brief End the lifetimes of the locals of the innermost scope, and
+     *        pop it.
+     */
+    void pop_locals(void);
+
+    /**
+     * @brief Allocate a temporary of type `t` aligned to hold its coerced
+     *        type as well.
+     */
+    llvm::AllocaInst *coerce_temporary(llvm::Type *t, llvm::Type *coerce_to);
+
+    /**
+     * @brief Reinterpret memory as the parts of a coerced type, one per LLVM
+     *        parameter; or store the parts to memory.
+     */
+    std::vector<llvm::Value *> load_coerced(llvm::Value *addr,
+                                            llvm::Type *coerce_to);
+    void store_coerced(llvm::Value *addr, llvm::Type *coerce_to,
+                       const std::vector<llvm::Value *> &parts);
+
     /**
      * @brief The return type of the current function, or NULL if none.
      */
     Type *rettype;
 
+    /**
+     * @brief The lowering of the current function, or NULL if none.
+     */
+    std::unique_ptr<FunctionABI> abi;
+
+    /**
+     * @brief Get whether a local variable of the given name and type may be
+     *        held in registers.
+     */
+    bool in_registers(const std::string &name, const Type &t);
+
+    /**
+     * @brief SSA form of the current function's register variables.
+     */
+    SSABuilder ssa;
+
+    /**
+     * @brief Names of the current function's variables which need addresses.
+     */
+    std::set<std::string> address_taken;
+
     /**
      * @brief The list of specializations that are used but have not yet been
      *        defined.
@@ -144,11 +336,213 @@ private:
     std::vector< std::pair< std::vector<Type>, TemplateValue > >
         specializations;
 
+    /**
+     * @brief The hashes of the templates specialized so far, by definition
+     *        (see `AST::hash_template`).
+     */
+    std::map<const AST::FunctionDefinition *, uint64_t> template_hashes;
+
+    /**
+     * @brief The calls to `const fn`s, by definition and arguments, which
+     *        could not be evaluated at compile time.
+     *
+     * Constants are uniqued, so the arguments are compared by address.
+     */
+    std::set<std::pair<const AST::FunctionDefinition *,
+                       std::vector<llvm::Value *> > > not_constant_calls;
+
+    /**
+     * @brief The names of the specializations made, by their layout class
+     *        (see `layout_class`).
+     */
+    std::map<std::string, std::vector<std::string> > layout_classes;
+
+    /**
+     * @brief What is recorded of a specialization, for the template report.
+     */
+    struct SpecializationStats {
+        std::string template_name;
+
+        /**
+         * @brief Every call to the specialization; the first made it.
+         */
+        std::vector<SourcePos> call_sites;
+
+        /**
+         * @brief The number of IR instructions generated, before
+         *        optimization.
+         */
+        unsigned instructions = 0;
+
+        /**
+         * @brief The time spent generating the specialization.
+         */
+        std::chrono::duration<double> time{0};
+
+        /**
+         * @brief The specialization this one was replaced by, if any (see
+         *        `share_specializations`).
+         */
+        std::string shared_with;
+    };
+
+    /**
+     * @brief Statistics of each specialization, by name.
+     */
+    std::map<std::string, SpecializationStats> specialization_stats;
+
+    /**
+     * @brief The name of the specialization being generated, or empty if
+     *        none, and when its generation started.
+     */
+    std::string current_specialization;
+    std::chrono::steady_clock::time_point specialization_start;
+
+    /**
+     * @brief Note a call to a specialization of the given template.
+     */
+    void record_call(const std::string &name, const std::string &func,
+                     SourcePos pos);
+
+    /**
+     * @brief Compile a copy of the module, and get the size in bytes of the
+     *        machine code of each function in it, by name.
+     */
+    std::map<std::string, uint64_t> machine_code_sizes(void);
+
+    /**
+     * @brief The descriptor passed to the current function for each erased
+     *        type parameter, by name.
+     */
+    std::map<std::string, llvm::Value *> erased_descriptors;
+
+    /**
+     * @defgroup Builtins.
+     *
+     * Functions implemented directly by the translator, which may be called
+     * like any other function unless shadowed by a user definition.  See
+     * Builtins.cpp.
+     *
+     * @{
+     */
+
+    typedef std::function<Value(TranslatorImpl &, std::vector<Value> &,
+                                SourcePos)>
+            Builtin;
+
+    /**
+     * @brief Get the table of builtins, by name.
+     */
+    static const std::map<std::string, Builtin> &get_builtins(void);
+
+    /**
+     * @brief Add the atomic builtins, one for each operation and valid
+     *        memory ordering, to a table of builtins.
+     */
+    static std::map<std::string, Builtin>
+        add_atomic_builtins(std::map<std::string, Builtin> builtins);
+
+    typedef std::function<Value(TranslatorImpl &, std::vector<Type> &,
+                                std::vector<Value> &, SourcePos)>
+            TemplateBuiltin;
+
+    /**
+     * @brief Get the table of builtins taking template arguments, by name.
+     */
+    static const std::map<std::string, TemplateBuiltin> &
+        get_template_builtins(void);
+
+    /**
+     * @brief Get the LLVM type of the given type for a layout query, or
+     *        raise an Error if it has no size.
+     */
+    llvm::Type *get_sized_type(const Type &t, SourcePos pos);
+
+    /**
+     * @brief Shuffle the lanes of two vectors of the same type.
+     *
+     * @param mask For each lane of the result, the lane of the concatenated
+     *             vectors to take it from.
+     */
+    Value vector_shuffle(Value lhs, Value rhs,
+                         const std::vector<unsigned> &mask, SourcePos pos);
+
+    /**
+     * @brief Combine all lanes of a vector with the given operation.
+     */
+    Value vector_reduce(Value vec, std::function<Value(Value, Value)> op,
+                        SourcePos pos);
+
+    /**
+     * @brief Choose between two values (or, with a mask, between the lanes
+     *        of two vectors).
+     */
+    Value select(Value cond, Value lhs, Value rhs, SourcePos pos);
+
+    /**
+     * @brief Call an intrinsic overloaded on the type of its arguments,
+     *        which must all match, and which it returns.
+     */
+    Value intrinsic(llvm::Intrinsic::ID id, std::vector<Value> &args,
+                    SourcePos pos);
+
+    /**
+     * @brief Rotate an integer, or each lane of a vector, by `nbits`.
+     */
+    Value rotate(Value val, Value nbits, bool left, SourcePos pos);
+
+    /**
+     * @brief Get the type pointed to by the pointer argument to an atomic
+     *        builtin, or raise an Error if it cannot be accessed atomically.
+     *
+     * @param allow_pointers Whether pointers as well as integers may be
+     *                       accessed.
+     */
+    Type get_atomic_type(const std::string &name, const Value &ptr,
+                         bool allow_pointers, SourcePos pos);
+
+    /**
+     * @brief Atomic operations on the value at `ptr`, with the given memory
+     *        ordering.
+     *
+     * `atomic_rmw` and `atomic_cmpxchg` return the previous value.
+     */
+    Value atomic_load(Value ptr, llvm::AtomicOrdering order, SourcePos pos);
+    Value atomic_store(Value ptr, Value val, llvm::AtomicOrdering order,
+                       SourcePos pos);
+    Value atomic_rmw(const std::string &op, Value ptr, Value val,
+                     llvm::AtomicOrdering order, SourcePos pos);
+    Value atomic_cmpxchg(Value ptr, Value expected, Value desired,
+                         llvm::AtomicOrdering order, SourcePos pos);
+
+    /** @} */
+
+    /**
+     * @brief Build the `llvm.loop` metadata for the given hints.
+     *
+     * @return The loop ID, or NULL if there are no hints.
+     */
+    llvm::MDNode *loop_metadata(const LoopHints &hints);
+
     /**
      * @brief Move to the other block.
      */
     void point(Block other);
 
+    /**
+     * @brief Branch from the current block on the given U1.
+     *
+     * A condition passed through `likely` or `unlikely` gives the branch
+     * weights directly, so that the hint is kept without optimization.
+     */
+    void cond_jump(Value cond, Block then_b, Block else_b);
+
+    /**
+     * @brief Add the LLVM attributes for the given function attributes.
+     */
+    void add_function_attributes(llvm::Function *f,
+                                 const FunctionAttributes &attrs);
+
     /**
      * @brief The name of the file this is generating code for.
      *
@@ -178,6 +572,11 @@ private:
      */
     Environment env;
 
+    /**
+     * @brief The global holding each string literal in the module.
+     */
+    std::map<std::string, llvm::GlobalVariable *> string_pool;
+
     /**
      * @brief The target machine (target triple + CPU information).
      */
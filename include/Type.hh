@@ -143,6 +143,30 @@ public:
     bool operator==(const Void &other) const { return true; }
 };
 
+/**
+ * @brief The type parameter of an `#[erased]` template, inside its body.
+ *
+ * Its size and alignment are only known at run time, from the descriptor
+ * passed for it, so it can only be used behind pointers.  Pointers to it are
+ * byte pointers.
+ */
+class Erased {
+public:
+    /**
+     * @param name The name of the type parameter.
+     */
+    Erased(std::string name);
+
+    llvm::Type *to_llvm(llvm::LLVMContext &ctx) const;
+
+    const std::string &get_name(void) const { return name; }
+
+    bool operator==(const Erased &other) const { return name == other.name; }
+
+private:
+    std::string name;
+};
+
 struct Type;
 
 /*****************************************************************************
@@ -173,6 +197,67 @@ private:
     std::shared_ptr<TypeType> pointed;
 };
 
+/**
+ * @brief SIMD vector types (`Vec<:T, N:>`).
+ *
+ * Hold a fixed number of integers or floats, which arithmetic operates on
+ * element-wise.
+ */
+template<typename TypeType=Type>
+class Vector {
+public:
+    /**
+     * @brief Build a vector type of `length` elements of the given type.
+     */
+    Vector(TypeType element, unsigned length)
+        : element(std::make_shared<TypeType>(element)), length(length) {}
+
+    Vector(std::shared_ptr<TypeType> element, unsigned length)
+        : element(element), length(length) {}
+
+    TypeType *get_element(void) const { return element.get(); }
+
+    unsigned get_length(void) const { return length; }
+
+    bool operator==(const Vector<TypeType> &other) const {
+        return length == other.length && *element == *other.element;
+    }
+
+private:
+    std::shared_ptr<TypeType> element;
+    unsigned length;
+};
+
+/**
+ * @brief Fixed-size array types (`T[N]`).
+ *
+ * Stored inline, so that arrays in structs and on the stack are contiguous.
+ */
+template<typename TypeType=Type>
+class Array {
+public:
+    /**
+     * @brief Build an array type of `length` elements of the given type.
+     */
+    Array(TypeType element, uint64_t length)
+        : element(std::make_shared<TypeType>(element)), length(length) {}
+
+    Array(std::shared_ptr<TypeType> element, uint64_t length)
+        : element(element), length(length) {}
+
+    TypeType *get_element(void) const { return element.get(); }
+
+    uint64_t get_length(void) const { return length; }
+
+    bool operator==(const Array<TypeType> &other) const {
+        return length == other.length && *element == *other.element;
+    }
+
+private:
+    std::shared_ptr<TypeType> element;
+    uint64_t length;
+};
+
 template<typename TypeType=Type>
 class Function {
 public:
@@ -253,7 +338,7 @@ public:
         // Check that field types are equal.
         for (unsigned i = 0; i < fields.size(); ++i) {
             if ((fields[i].first != other.fields[i].first)
-             || (*fields[i].second != other.fields[i].second)) {
+             || !(*fields[i].second == *other.fields[i].second)) {
                 return false;
             }
         }
@@ -289,7 +374,8 @@ private:
  */
 
 typedef boost::variant<SignedInt, UnsignedInt, Float, Void, Pointer<Type>,
-                       Function<Type>, Struct<Type> > _Type;
+                       Function<Type>, Struct<Type>, Vector<Type>,
+                       Array<Type>, Erased> _Type;
 
 /**
  * @brief Internal representation of Craeft types.
@@ -321,6 +407,19 @@ llvm::Type *to_llvm_type(const Type &t, llvm::Module &module);
 
 std::string get_name(Type t);
 
+/**
+ * @brief Get whether the type mentions an erased type parameter anywhere,
+ *        even behind a pointer.
+ */
+bool mentions_erased(const Type &t);
+
+/**
+ * @brief Get whether the layout of the type depends on an erased type
+ *        parameter, which happens unless it is only mentioned behind
+ *        pointers.
+ */
+bool has_erased_layout(const Type &t);
+
 /*****************************************************************************
  * Template types: types with template parameters potentially missing.
  */
@@ -361,7 +460,8 @@ struct TemplateFunction {
 
 typedef boost::variant<SignedInt, UnsignedInt, Float, Void,
                        Pointer<TemplateType>, Struct<TemplateType>,
-                       Function<TemplateType>, int>
+                       Function<TemplateType>, Vector<TemplateType>,
+                       Array<TemplateType>, Erased, int>
         _TemplateType;
 
 struct TemplateType: public _TemplateType {
@@ -383,9 +483,32 @@ Type specialize(const TemplateType &temp,
  *        template arguments.
  *
  * The function is pure and produces a label which cannot conflict with any
- * other value or type name.
+ * other value or type name.  The label ends in a hash of the template and
+ * of the layouts of the arguments, so that different templates or structs
+ * which share a name in different modules give different labels.
+ *
+ * @param template_hash The template's hash, from `AST::hash_template`.
  */
 std::string mangle_name(std::string fname,
-                        const std::vector<Type> &args);
+                        const std::vector<Type> &args,
+                        uint64_t template_hash);
+
+/**
+ * @brief Get a key shared by the specializations of the given template
+ *        whose type arguments have the same layouts.
+ *
+ * Pointers all share a layout, as do integers of the same width.  Whether
+ * two such specializations compile to the same code depends on what the
+ * body does with the arguments.
+ */
+std::string layout_class(std::string fname, const std::vector<Type> &args);
+
+/**
+ * @brief Get the name of the single, type-erased compilation of the given
+ *        `#[erased]` template function.
+ *
+ * @param template_hash The template's hash, from `AST::hash_template`.
+ */
+std::string erased_name(std::string fname, uint64_t template_hash);
 
 }
@@ -0,0 +1,316 @@
+/**
+ * @file ABI.cpp
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "llvm/ADT/Triple.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include "ABI.hh"
+
+namespace Craeft {
+
+/*****************************************************************************
+ * x86-64 System V classification.
+ *
+ * See section 3.2.3 of the System V AMD64 ABI.  Only the classes which
+ * Craeft types can produce are handled: there is no long double, and vectors
+ * larger than 8 bytes inside aggregates are passed in memory.
+ */
+
+namespace {
+
+enum ArgClass { NO_CLASS, INTEGER, SSE, MEMORY };
+
+const unsigned INT_REGS = 6;
+const unsigned SSE_REGS = 8;
+const unsigned INT_RET_REGS = 2;
+const unsigned SSE_RET_REGS = 2;
+
+ArgClass merge(ArgClass a, ArgClass b) {
+    if (a == b || b == NO_CLASS) return a;
+    if (a == NO_CLASS) return b;
+    if (a == MEMORY || b == MEMORY) return MEMORY;
+    if (a == INTEGER || b == INTEGER) return INTEGER;
+    return SSE;
+}
+
+/* The classes of the two eightbytes of an aggregate of at most 16 bytes. */
+struct Classification {
+    ArgClass classes[2] = { NO_CLASS, NO_CLASS };
+    /* Whether anything lies in the upper four bytes of each eightbyte. */
+    bool upper[2] = { false, false };
+    /* Whether everything in each eightbyte is a float. */
+    bool all_float[2] = { true, true };
+
+    unsigned count(ArgClass c) const {
+        return (classes[0] == c) + (classes[1] == c);
+    }
+};
+
+void classify(llvm::Type *t, uint64_t offset, const llvm::DataLayout &layout,
+              Classification &result) {
+    if (auto *st = llvm::dyn_cast<llvm::StructType>(t)) {
+        auto *sl = layout.getStructLayout(st);
+        for (unsigned i = 0; i < st->getNumElements(); ++i) {
+            classify(st->getElementType(i), offset + sl->getElementOffset(i),
+                     layout, result);
+        }
+        return;
+    }
+
+    if (auto *at = llvm::dyn_cast<llvm::ArrayType>(t)) {
+        auto *elem = at->getElementType();
+        uint64_t size = layout.getTypeAllocSize(elem);
+        for (uint64_t i = 0; i < at->getNumElements(); ++i) {
+            classify(elem, offset + i * size, layout, result);
+        }
+        return;
+    }
+
+    uint64_t size = layout.getTypeStoreSize(t);
+
+    ArgClass c = MEMORY;
+    if (t->isIntegerTy() || t->isPointerTy()) {
+        c = INTEGER;
+    } else if (t->isFloatTy() || t->isDoubleTy()
+            || (t->isVectorTy() && size == 8)) {
+        c = SSE;
+    }
+
+    // A scalar straddling two eightbytes can only be passed in memory.
+    if (offset / 8 != (offset + size - 1) / 8) {
+        c = MEMORY;
+    }
+
+    auto i = offset / 8;
+    result.classes[i] = merge(result.classes[i], c);
+    result.upper[i] = result.upper[i] || offset % 8 + size > 4;
+    result.all_float[i] = result.all_float[i] && t->isFloatTy();
+}
+
+/* Get the register type of the given eightbyte of an aggregate. */
+llvm::Type *eightbyte_type(const Classification &c, unsigned i,
+                           uint64_t size, llvm::LLVMContext &ctx) {
+    if (c.classes[i] == SSE) {
+        if (!c.upper[i]) return llvm::Type::getFloatTy(ctx);
+        if (c.all_float[i]) {
+            return llvm::VectorType::get(llvm::Type::getFloatTy(ctx), 2);
+        }
+        return llvm::Type::getDoubleTy(ctx);
+    }
+
+    auto bytes = std::min<uint64_t>(8, size - 8 * i);
+    return llvm::IntegerType::get(ctx, bytes * 8);
+}
+
+/* Get the single 16-byte vector an aggregate consists of, if any. */
+llvm::Type *lone_vector(llvm::Type *t, const llvm::DataLayout &layout) {
+    while (true) {
+        if (auto *st = llvm::dyn_cast<llvm::StructType>(t)) {
+            if (st->getNumElements() != 1) return nullptr;
+            t = st->getElementType(0);
+        } else if (auto *at = llvm::dyn_cast<llvm::ArrayType>(t)) {
+            if (at->getNumElements() != 1) return nullptr;
+            t = at->getElementType();
+        } else {
+            break;
+        }
+    }
+
+    if (t->isVectorTy() && layout.getTypeAllocSize(t) == 16) return t;
+
+    return nullptr;
+}
+
+/*
+ * Classify an argument or return value, given the number of registers still
+ * free.  Aggregates which fit in those registers take them.
+ */
+ArgABI classify_x86_64(llvm::Type *t, const llvm::DataLayout &layout,
+                       unsigned &int_regs, unsigned &sse_regs) {
+    if (!t->isStructTy() && !t->isArrayTy()) {
+        if (t->isIntegerTy() || t->isPointerTy()) {
+            if (int_regs) --int_regs;
+        } else if (t->isFloatingPointTy() || t->isVectorTy()) {
+            if (sse_regs) --sse_regs;
+        }
+        return ArgABI(ArgABI::DIRECT);
+    }
+
+    uint64_t size = layout.getTypeAllocSize(t);
+
+    if (size == 0) return ArgABI(ArgABI::IGNORE);
+
+    if (auto *vec = lone_vector(t, layout)) {
+        if (!sse_regs) return ArgABI(ArgABI::INDIRECT);
+        --sse_regs;
+        return ArgABI(ArgABI::COERCE, vec);
+    }
+
+    if (size > 16) return ArgABI(ArgABI::INDIRECT);
+
+    Classification c;
+    classify(t, 0, layout, c);
+
+    if (c.classes[0] == MEMORY || c.classes[1] == MEMORY) {
+        return ArgABI(ArgABI::INDIRECT);
+    }
+
+    // Eightbytes holding only padding are passed as integers.
+    if (c.classes[0] == NO_CLASS) c.classes[0] = INTEGER;
+    if (size > 8 && c.classes[1] == NO_CLASS) c.classes[1] = INTEGER;
+
+    auto n_int = c.count(INTEGER);
+    auto n_sse = c.count(SSE);
+
+    if (n_int > int_regs || n_sse > sse_regs) {
+        return ArgABI(ArgABI::INDIRECT);
+    }
+
+    int_regs -= n_int;
+    sse_regs -= n_sse;
+
+    auto &ctx = t->getContext();
+    auto *lo = eightbyte_type(c, 0, size, ctx);
+
+    if (size <= 8) return ArgABI(ArgABI::COERCE, lo);
+
+    auto *hi = eightbyte_type(c, 1, size, ctx);
+    return ArgABI(ArgABI::COERCE, llvm::StructType::get(ctx, { lo, hi }));
+}
+
+}
+
+/*****************************************************************************
+ * Lowered function types.
+ */
+
+FunctionABI::FunctionABI(const Function<> &f, llvm::Module &mod)
+    : ret(ArgABI::DIRECT),
+      ret_type(to_llvm_type(*f.get_rettype(), mod)),
+      layout(mod.getDataLayout()) {
+    for (const auto &t: f.get_args()) {
+        arg_types.push_back(to_llvm_type(*t, mod));
+        args.push_back(ArgABI(ArgABI::DIRECT));
+    }
+
+    llvm::Triple triple(mod.getTargetTriple());
+
+    if (triple.getArch() == llvm::Triple::x86_64 && !triple.isOSWindows()) {
+        unsigned int_regs = INT_RET_REGS, sse_regs = SSE_RET_REGS;
+
+        if (!ret_type->isVoidTy()) {
+            ret = classify_x86_64(ret_type, layout, int_regs, sse_regs);
+        }
+
+        int_regs = INT_REGS - (ret.kind == ArgABI::INDIRECT);
+        sse_regs = SSE_REGS;
+
+        for (unsigned i = 0; i < args.size(); ++i) {
+            args[i] = classify_x86_64(arg_types[i], layout,
+                                      int_regs, sse_regs);
+        }
+    }
+
+    // Build the lowered LLVM type.
+    auto &ctx = mod.getContext();
+    llvm::Type *lowered_ret = ret_type;
+    std::vector<llvm::Type *> lowered_args;
+
+    switch (ret.kind) {
+        case ArgABI::DIRECT:
+            break;
+        case ArgABI::COERCE:
+            lowered_ret = ret.coerce_to;
+            break;
+        case ArgABI::INDIRECT:
+            lowered_args.push_back(ret_type->getPointerTo());
+            // Fall through.
+        case ArgABI::IGNORE:
+            lowered_ret = llvm::Type::getVoidTy(ctx);
+            break;
+    }
+
+    for (unsigned i = 0; i < args.size(); ++i) {
+        params.push_back(lowered_args.size());
+
+        switch (args[i].kind) {
+            case ArgABI::DIRECT:
+                lowered_args.push_back(arg_types[i]);
+                break;
+            case ArgABI::COERCE:
+                if (auto *st
+                        = llvm::dyn_cast<llvm::StructType>(args[i].coerce_to)) {
+                    for (auto *elem: st->elements()) {
+                        lowered_args.push_back(elem);
+                    }
+                } else {
+                    lowered_args.push_back(args[i].coerce_to);
+                }
+                break;
+            case ArgABI::INDIRECT:
+                lowered_args.push_back(arg_types[i]->getPointerTo());
+                break;
+            case ArgABI::IGNORE:
+                break;
+        }
+    }
+
+    type = llvm::FunctionType::get(lowered_ret, lowered_args, false);
+}
+
+template<typename T>
+void FunctionABI::add_attributes_to(T *target) const {
+    auto &ctx = ret_type->getContext();
+
+    if (ret.kind == ArgABI::INDIRECT) {
+        target->addParamAttr(0, llvm::Attribute::StructRet);
+        target->addParamAttr(0, llvm::Attribute::NoAlias);
+    }
+
+    for (unsigned i = 0; i < args.size(); ++i) {
+        if (args[i].kind != ArgABI::INDIRECT) continue;
+
+        // Memory arguments are at least eightbyte-aligned on the stack.
+        auto align = std::max<unsigned>(
+                8, layout.getABITypeAlignment(arg_types[i]));
+
+        target->addParamAttr(params[i], llvm::Attribute::ByVal);
+        target->addParamAttr(params[i], llvm::Attribute::getWithAlignment(
+                                            ctx, align));
+    }
+}
+
+void FunctionABI::add_attributes(llvm::Function *f) const {
+    add_attributes_to(f);
+}
+
+void FunctionABI::add_attributes(llvm::CallInst *call) const {
+    add_attributes_to(call);
+}
+
+}
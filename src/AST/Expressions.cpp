@@ -77,6 +77,14 @@ private:
         out << ", " << access.field() << "}";
     }
 
+    void operator()(const Index &index) override {
+        out << "Index {";
+        visit(index.array());
+        out << ", ";
+        visit(index.index());
+        out << "}";
+    }
+
     void operator()(const Binop &bin) override {
         out << "Binop {" << bin.op() << ", ";
         visit(bin.lhs());
@@ -124,6 +132,15 @@ private:
         out << "}";
     }
 
+    void operator()(const ArrayLiteral &arr) override {
+        out << "ArrayLiteral {";
+        for (unsigned i = 0; i < arr.elements().size(); ++i) {
+            if (i) out << ", ";
+            visit(*arr.elements()[i]);
+        }
+        out << "}";
+    }
+
     std::ostream &out;
 };
 
@@ -0,0 +1,926 @@
+/**
+ * @file AST/Serialize.cpp
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/xxhash.h"
+
+#include "AST/Serialize.hh"
+
+namespace Craeft {
+
+namespace AST {
+
+namespace {
+
+/*
+ * Layout of a cache file.  All integers are in host byte order; the cache is
+ * a build artifact and is never shared between machines.
+ *
+ *     magic        8 bytes
+ *     version      u32
+ *     source size  u64
+ *     source hash  u64 (xxHash64 of the source's contents)
+ *     nstrings     u32, then for each string: u32 length, bytes
+ *     ntoplevels   u32, then each top-level node
+ *
+ * Every node starts with a u8 kind tag and its source position (two u16s),
+ * followed by its fields in declaration order.  Identifiers and string
+ * literals are stored as u32 indices into the string table.
+ */
+const char MAGIC[8] = { 'C', 'R', 'A', 'E', 'F', 'T', 'A', 'S' };
+
+/**
+ * @brief The properties of a source file a cache is keyed on.
+ *
+ * The contents are hashed rather than trusting the modification time, which
+ * many filesystems only keep to the second and which tools like `git
+ * checkout` and `cp -p` may leave unchanged across an edit.
+ */
+struct SourceStamp {
+    uint64_t size;
+    uint64_t hash;
+};
+
+bool stamp_source(const std::string &fname, SourceStamp &stamp) {
+    auto buf = llvm::MemoryBuffer::getFile(fname, -1, false);
+    if (!buf) return false;
+    stamp.size = (*buf)->getBufferSize();
+    stamp.hash = llvm::xxHash64((*buf)->getBuffer());
+    return true;
+}
+
+/*****************************************************************************
+ * Writing.
+ */
+
+class Writer {
+public:
+    /**
+     * @param positions Whether to record source positions.  Hashes leave
+     *                  them out, so that moving code does not change them.
+     */
+    explicit Writer(bool positions = true): positions(positions) {}
+
+    void put_u8(uint8_t x) { put_raw(&x, sizeof(x)); }
+    void put_u16(uint16_t x) { put_raw(&x, sizeof(x)); }
+    void put_u32(uint32_t x) { put_raw(&x, sizeof(x)); }
+    void put_u64(uint64_t x) { put_raw(&x, sizeof(x)); }
+
+    void put_f64(double x) { put_raw(&x, sizeof(x)); }
+
+    void put_string(const std::string &s) {
+        auto it = string_ids.find(s);
+        if (it == string_ids.end()) {
+            it = string_ids.emplace(s, strings.size()).first;
+            strings.push_back(&it->first);
+        }
+        put_u32(it->second);
+    }
+
+    void put_pos(SourcePos pos) {
+        if (!positions) return;
+        put_u16(pos.charno);
+        put_u16(pos.lineno);
+    }
+
+    void put_header(uint8_t kind, SourcePos pos) {
+        put_u8(kind);
+        put_pos(pos);
+    }
+
+    /**
+     * @brief Write the string table followed by the buffered nodes.
+     */
+    void finish(std::ostream &out) const {
+        uint32_t nstrings = strings.size();
+        out.write((const char *)&nstrings, sizeof(nstrings));
+        for (const auto *s: strings) {
+            uint32_t len = s->size();
+            out.write((const char *)&len, sizeof(len));
+            out.write(s->data(), len);
+        }
+        out.write(data.data(), data.size());
+    }
+
+private:
+    void put_raw(const void *p, size_t len) {
+        data.append((const char *)p, len);
+    }
+
+    bool positions;
+    std::string data;
+    std::map<std::string, uint32_t> string_ids;
+    std::vector<const std::string *> strings;
+};
+
+class TypeWriter: public TypeVisitor<void> {
+public:
+    explicit TypeWriter(Writer &w): w(w) {}
+
+private:
+    void operator()(const NamedType &t) override {
+        w.put_header(t.kind(), t.pos());
+        w.put_string(t.name());
+    }
+
+    void operator()(const Void &t) override {
+        w.put_header(t.kind(), t.pos());
+    }
+
+    void operator()(const TemplatedType &t) override {
+        w.put_header(t.kind(), t.pos());
+        w.put_string(t.name());
+        w.put_u32(t.args().size());
+        for (const auto &arg: t.args()) visit(*arg);
+    }
+
+    void operator()(const Pointer &t) override {
+        w.put_header(t.kind(), t.pos());
+        visit(t.pointed());
+    }
+
+    void operator()(const Vector &t) override {
+        w.put_header(t.kind(), t.pos());
+        visit(t.element());
+        w.put_u32(t.length());
+    }
+
+    /* Array lengths are expressions; see below. */
+    void operator()(const Array &t) override;
+
+    Writer &w;
+};
+
+class ExpressionWriter: public ExpressionVisitor<void> {
+public:
+    explicit ExpressionWriter(Writer &w): w(w) {}
+
+private:
+    void operator()(const IntLiteral &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_u64(e.value());
+    }
+
+    void operator()(const UIntLiteral &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_u64(e.value());
+    }
+
+    void operator()(const FloatLiteral &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_f64(e.value());
+    }
+
+    void operator()(const StringLiteral &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_string(e.value());
+    }
+
+    void operator()(const Variable &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_string(e.name());
+    }
+
+    void operator()(const Reference &e) override {
+        w.put_header(e.kind(), e.pos());
+        visit(e.referand());
+    }
+
+    void operator()(const Dereference &e) override {
+        w.put_header(e.kind(), e.pos());
+        visit(e.referand());
+    }
+
+    void operator()(const FieldAccess &e) override {
+        w.put_header(e.kind(), e.pos());
+        visit(e.structure());
+        w.put_string(e.field());
+    }
+
+    void operator()(const Index &e) override {
+        w.put_header(e.kind(), e.pos());
+        visit(e.array());
+        visit(e.index());
+    }
+
+    void operator()(const Binop &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_string(e.op());
+        visit(e.lhs());
+        visit(e.rhs());
+    }
+
+    void operator()(const FunctionCall &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_string(e.fname());
+        w.put_u32(e.args().size());
+        for (const auto &arg: e.args()) visit(*arg);
+    }
+
+    void operator()(const TemplateFunctionCall &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_string(e.fname());
+        TypeWriter types(w);
+        w.put_u32(e.type_args().size());
+        for (const auto &arg: e.type_args()) types.visit(*arg);
+        w.put_u32(e.value_args().size());
+        for (const auto &arg: e.value_args()) visit(*arg);
+    }
+
+    void operator()(const Cast &e) override {
+        w.put_header(e.kind(), e.pos());
+        TypeWriter(w).visit(e.type());
+        visit(e.arg());
+    }
+
+    void operator()(const ArrayLiteral &e) override {
+        w.put_header(e.kind(), e.pos());
+        w.put_u32(e.elements().size());
+        for (const auto &elem: e.elements()) visit(*elem);
+    }
+
+    Writer &w;
+};
+
+void TypeWriter::operator()(const Array &t) {
+    w.put_header(t.kind(), t.pos());
+    visit(t.element());
+    ExpressionWriter(w).visit(t.length());
+}
+
+class StatementWriter: public StatementVisitor<void> {
+public:
+    explicit StatementWriter(Writer &w): w(w), exprs(w), types(w) {}
+
+    void write_block(const std::vector<std::unique_ptr<Statement>> &block) {
+        w.put_u32(block.size());
+        for (const auto &stmt: block) visit(*stmt);
+    }
+
+    void write_attributes(const std::vector<Attribute> &attrs) {
+        w.put_u32(attrs.size());
+        for (const auto &attr: attrs) {
+            w.put_string(attr.name);
+            w.put_pos(attr.pos);
+            w.put_u32(attr.args.size());
+            for (const auto &arg: attr.args) w.put_string(arg);
+        }
+    }
+
+private:
+    void write_variable(const Variable &var) {
+        w.put_string(var.name());
+        w.put_pos(var.pos());
+    }
+
+    void operator()(const ExpressionStatement &s) override {
+        w.put_header(s.kind(), s.pos());
+        exprs.visit(s.expr());
+    }
+
+    void operator()(const Return &s) override {
+        w.put_header(s.kind(), s.pos());
+        exprs.visit(s.retval());
+    }
+
+    void operator()(const VoidReturn &s) override {
+        w.put_header(s.kind(), s.pos());
+    }
+
+    void operator()(const Become &s) override {
+        w.put_header(s.kind(), s.pos());
+        exprs.visit(s.call());
+    }
+
+    void operator()(const Assignment &s) override {
+        w.put_header(s.kind(), s.pos());
+        exprs.visit(s.lhs());
+        exprs.visit(s.rhs());
+    }
+
+    void operator()(const Declaration &s) override {
+        w.put_header(s.kind(), s.pos());
+        types.visit(s.type());
+        write_variable(s.name());
+    }
+
+    void operator()(const CompoundDeclaration &s) override {
+        w.put_header(s.kind(), s.pos());
+        types.visit(s.type());
+        write_variable(s.name());
+        exprs.visit(s.rhs());
+    }
+
+    void operator()(const IfStatement &s) override {
+        w.put_header(s.kind(), s.pos());
+        exprs.visit(s.condition());
+        write_block(s.if_block());
+        write_block(s.else_block());
+    }
+
+    void operator()(const WhileStatement &s) override {
+        w.put_header(s.kind(), s.pos());
+        write_attributes(s.attributes());
+        exprs.visit(s.condition());
+        write_block(s.body());
+    }
+
+    void operator()(const ForStatement &s) override {
+        w.put_header(s.kind(), s.pos());
+        write_attributes(s.attributes());
+        visit(s.init());
+        exprs.visit(s.condition());
+        visit(s.step());
+        write_block(s.body());
+    }
+
+    Writer &w;
+    ExpressionWriter exprs;
+    TypeWriter types;
+};
+
+class ToplevelWriter: public ToplevelVisitor<void> {
+public:
+    explicit ToplevelWriter(Writer &w): w(w), stmts(w), types(w) {}
+
+private:
+    void write_members(const std::vector<std::unique_ptr<Declaration>> &ms) {
+        w.put_u32(ms.size());
+        for (const auto &m: ms) stmts.visit(*m);
+    }
+
+    void write_argnames(const std::vector<std::string> &argnames) {
+        w.put_u32(argnames.size());
+        for (const auto &name: argnames) w.put_string(name);
+    }
+
+    void operator()(const TypeDeclaration &t) override {
+        w.put_header(t.kind(), t.pos());
+        w.put_string(t.name());
+    }
+
+    void operator()(const StructDeclaration &t) override {
+        w.put_header(t.kind(), t.pos());
+        w.put_string(t.name());
+        write_members(t.members());
+    }
+
+    void operator()(const TemplateStructDeclaration &t) override {
+        w.put_header(t.kind(), t.pos());
+        write_argnames(t.argnames());
+        w.put_string(t.decl().name());
+        write_members(t.decl().members());
+    }
+
+    void operator()(const FunctionDeclaration &t) override {
+        w.put_header(t.kind(), t.pos());
+        w.put_string(t.name());
+        write_members(t.args());
+        types.visit(t.ret_type());
+        stmts.write_attributes(t.attributes());
+        w.put_u8(t.is_public());
+    }
+
+    void operator()(const FunctionDefinition &t) override {
+        w.put_header(t.kind(), t.pos());
+        w.put_u8(t.is_const());
+        operator()(t.signature());
+        stmts.write_block(t.block());
+    }
+
+    void operator()(const TemplateFunctionDefinition &t) override {
+        w.put_header(t.kind(), t.pos());
+        write_argnames(t.argnames());
+        operator()(t.def()->signature());
+        stmts.write_block(t.def()->block());
+    }
+
+    void operator()(const GlobalDeclaration &t) override {
+        w.put_header(t.kind(), t.pos());
+        types.visit(t.type());
+        w.put_string(t.name());
+        w.put_u8(t.is_const());
+        w.put_u8(t.is_thread_local());
+        stmts.write_attributes(t.attributes());
+        w.put_u8(t.is_public());
+        w.put_u8(t.init() != nullptr);
+        if (t.init()) ExpressionWriter(w).visit(*t.init());
+    }
+
+    Writer &w;
+    StatementWriter stmts;
+    TypeWriter types;
+};
+
+/*****************************************************************************
+ * Reading.
+ */
+
+/**
+ * @brief Thrown internally when a cache turns out to be malformed.
+ */
+struct BadCache {};
+
+class Reader {
+public:
+    Reader(const char *begin, const char *end, const std::string &fname)
+        : cur(begin), end(end),
+          fname(std::make_shared<std::string>(fname)) {}
+
+    uint8_t get_u8(void) { return get_raw<uint8_t>(); }
+    uint16_t get_u16(void) { return get_raw<uint16_t>(); }
+    uint32_t get_u32(void) { return get_raw<uint32_t>(); }
+    uint64_t get_u64(void) { return get_raw<uint64_t>(); }
+    double get_f64(void) { return get_raw<double>(); }
+
+    /**
+     * @brief Read a length or count, checking that it is plausible.
+     *
+     * Every element takes at least one byte, so a count larger than the
+     * remaining input can only come from a corrupt file.
+     */
+    uint32_t get_count(void) {
+        uint32_t n = get_u32();
+        if (n > (size_t)(end - cur)) throw BadCache();
+        return n;
+    }
+
+    const std::string &get_string(void) {
+        uint32_t id = get_u32();
+        if (id >= strings.size()) throw BadCache();
+        return strings[id];
+    }
+
+    SourcePos get_pos(void) {
+        uint16_t charno = get_u16();
+        uint16_t lineno = get_u16();
+        return SourcePos(charno, lineno, fname);
+    }
+
+    void read_header(void) {
+        if ((size_t)(end - cur) < sizeof(MAGIC)
+         || memcmp(cur, MAGIC, sizeof(MAGIC))) {
+            throw BadCache();
+        }
+        cur += sizeof(MAGIC);
+        if (get_u32() != AST_FORMAT_VERSION) throw BadCache();
+    }
+
+    void read_strings(void) {
+        uint32_t n = get_count();
+        strings.reserve(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            uint32_t len = get_count();
+            strings.emplace_back(cur, len);
+            cur += len;
+        }
+    }
+
+    bool at_end(void) const { return cur == end; }
+
+    std::unique_ptr<Type> read_type(void);
+    std::unique_ptr<Expression> read_expr(void);
+    std::unique_ptr<LValue> read_lvalue(void);
+    std::unique_ptr<Statement> read_statement(void);
+    std::vector<std::unique_ptr<Statement>> read_block(void);
+    std::vector<Attribute> read_attributes(void);
+    std::unique_ptr<Declaration> read_declaration(void);
+    std::vector<std::unique_ptr<Declaration>> read_declarations(void);
+    std::vector<std::string> read_argnames(void);
+    std::unique_ptr<FunctionDeclaration> read_function_declaration(void);
+    std::unique_ptr<FunctionDeclaration> read_function_signature(SourcePos);
+    std::unique_ptr<Toplevel> read_toplevel(void);
+
+private:
+    template<typename T>
+    T get_raw(void) {
+        T result;
+        if ((size_t)(end - cur) < sizeof(T)) throw BadCache();
+        memcpy(&result, cur, sizeof(T));
+        cur += sizeof(T);
+        return result;
+    }
+
+    const char *cur;
+    const char *end;
+    std::shared_ptr<std::string> fname;
+    std::vector<std::string> strings;
+};
+
+std::unique_ptr<Type> Reader::read_type(void) {
+    auto kind = get_u8();
+    auto pos = get_pos();
+
+    switch (kind) {
+        case Type::NamedType:
+            return std::make_unique<NamedType>(get_string(), pos);
+        case Type::Void:
+            return std::make_unique<Void>(pos);
+        case Type::TemplatedType: {
+            const auto &name = get_string();
+            std::vector<std::unique_ptr<Type>> args;
+            uint32_t nargs = get_count();
+            for (uint32_t i = 0; i < nargs; ++i) {
+                args.push_back(read_type());
+            }
+            return std::make_unique<TemplatedType>(name, std::move(args), pos);
+        }
+        case Type::Pointer:
+            return std::make_unique<Pointer>(read_type(), pos);
+        case Type::Vector: {
+            auto element = read_type();
+            return std::make_unique<Vector>(std::move(element), get_u32(),
+                                            pos);
+        }
+        case Type::Array: {
+            auto element = read_type();
+            auto length = read_expr();
+            return std::make_unique<Array>(std::move(element),
+                                           std::move(length), pos);
+        }
+    }
+
+    throw BadCache();
+}
+
+std::unique_ptr<Expression> Reader::read_expr(void) {
+    auto kind = get_u8();
+    auto pos = get_pos();
+
+    switch (kind) {
+        case Expression::IntLiteral:
+            return std::make_unique<IntLiteral>((int64_t)get_u64(), pos);
+        case Expression::UIntLiteral:
+            return std::make_unique<UIntLiteral>(get_u64(), pos);
+        case Expression::FloatLiteral:
+            return std::make_unique<FloatLiteral>(get_f64(), pos);
+        case Expression::StringLiteral:
+            return std::make_unique<StringLiteral>(get_string(), pos);
+        case Expression::Variable:
+            return std::make_unique<Variable>(get_string(), pos);
+        case Expression::Reference:
+            return std::make_unique<Reference>(read_lvalue(), pos);
+        case Expression::Dereference:
+            return std::make_unique<Dereference>(read_expr(), pos);
+        case Expression::FieldAccess: {
+            auto structure = read_expr();
+            const auto &field = get_string();
+            return std::make_unique<FieldAccess>(std::move(structure),
+                                                 field, pos);
+        }
+        case Expression::Index: {
+            auto array = read_expr();
+            auto index = read_expr();
+            return std::make_unique<Index>(std::move(array),
+                                           std::move(index), pos);
+        }
+        case Expression::Binop: {
+            const auto &op = get_string();
+            auto lhs = read_expr();
+            auto rhs = read_expr();
+            return std::make_unique<Binop>(op, std::move(lhs),
+                                           std::move(rhs), pos);
+        }
+        case Expression::FunctionCall: {
+            const auto &fname = get_string();
+            std::vector<std::unique_ptr<Expression>> args;
+            uint32_t nargs = get_count();
+            for (uint32_t i = 0; i < nargs; ++i) {
+                args.push_back(read_expr());
+            }
+            return std::make_unique<FunctionCall>(fname, std::move(args), pos);
+        }
+        case Expression::TemplateFunctionCall: {
+            const auto &fname = get_string();
+            std::vector<std::unique_ptr<Type>> type_args;
+            uint32_t ntypes = get_count();
+            for (uint32_t i = 0; i < ntypes; ++i) {
+                type_args.push_back(read_type());
+            }
+            std::vector<std::unique_ptr<Expression>> value_args;
+            uint32_t nvalues = get_count();
+            for (uint32_t i = 0; i < nvalues; ++i) {
+                value_args.push_back(read_expr());
+            }
+            return std::make_unique<TemplateFunctionCall>(
+                    fname, std::move(type_args), std::move(value_args), pos);
+        }
+        case Expression::Cast: {
+            auto type = read_type();
+            auto arg = read_expr();
+            return std::make_unique<Cast>(std::move(type), std::move(arg), pos);
+        }
+        case Expression::ArrayLiteral: {
+            std::vector<std::unique_ptr<Expression>> elements;
+            uint32_t n = get_count();
+            for (uint32_t i = 0; i < n; ++i) {
+                elements.push_back(read_expr());
+            }
+            return std::make_unique<ArrayLiteral>(std::move(elements), pos);
+        }
+    }
+
+    throw BadCache();
+}
+
+std::unique_ptr<LValue> Reader::read_lvalue(void) {
+    auto expr = read_expr();
+    if (!llvm::isa<LValue>(expr.get())) throw BadCache();
+    return std::unique_ptr<LValue>(llvm::cast<LValue>(expr.release()));
+}
+
+std::unique_ptr<Statement> Reader::read_statement(void) {
+    auto kind = get_u8();
+    auto pos = get_pos();
+
+    switch (kind) {
+        case Statement::ExpressionStatement:
+            return std::make_unique<ExpressionStatement>(read_expr());
+        case Statement::Return:
+            return std::make_unique<Return>(read_expr(), pos);
+        case Statement::VoidReturn:
+            return std::make_unique<VoidReturn>(pos);
+        case Statement::Become: {
+            auto call = read_expr();
+            if (!llvm::isa<FunctionCall>(call.get())
+             && !llvm::isa<TemplateFunctionCall>(call.get())) {
+                throw BadCache();
+            }
+            return std::make_unique<Become>(std::move(call), pos);
+        }
+        case Statement::Assignment: {
+            auto lhs = read_lvalue();
+            auto rhs = read_expr();
+            return std::make_unique<Assignment>(std::move(lhs),
+                                                std::move(rhs), pos);
+        }
+        case Statement::Declaration: {
+            auto type = read_type();
+            const auto &name = get_string();
+            Variable var(name, get_pos());
+            return std::make_unique<Declaration>(std::move(type), var, pos);
+        }
+        case Statement::CompoundDeclaration: {
+            auto type = read_type();
+            const auto &name = get_string();
+            Variable var(name, get_pos());
+            auto rhs = read_expr();
+            return std::make_unique<CompoundDeclaration>(
+                    std::move(type), var, std::move(rhs), pos);
+        }
+        case Statement::IfStatement: {
+            auto cond = read_expr();
+            auto if_block = read_block();
+            auto else_block = read_block();
+            return std::make_unique<IfStatement>(std::move(cond),
+                                                 std::move(if_block),
+                                                 std::move(else_block),
+                                                 pos);
+        }
+        case Statement::WhileStatement: {
+            auto attrs = read_attributes();
+            auto cond = read_expr();
+            auto body = read_block();
+            return std::make_unique<WhileStatement>(std::move(cond),
+                                                    std::move(body),
+                                                    std::move(attrs), pos);
+        }
+        case Statement::ForStatement: {
+            auto attrs = read_attributes();
+            auto init = read_statement();
+            auto cond = read_expr();
+            auto step = read_statement();
+            auto body = read_block();
+            return std::make_unique<ForStatement>(std::move(init),
+                                                  std::move(cond),
+                                                  std::move(step),
+                                                  std::move(body),
+                                                  std::move(attrs), pos);
+        }
+    }
+
+    throw BadCache();
+}
+
+std::vector<std::unique_ptr<Statement>> Reader::read_block(void) {
+    std::vector<std::unique_ptr<Statement>> result;
+    uint32_t n = get_count();
+    result.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        result.push_back(read_statement());
+    }
+    return result;
+}
+
+std::vector<Attribute> Reader::read_attributes(void) {
+    std::vector<Attribute> result;
+    uint32_t n = get_count();
+    for (uint32_t i = 0; i < n; ++i) {
+        const auto &name = get_string();
+        auto pos = get_pos();
+        std::vector<std::string> args;
+        uint32_t nargs = get_count();
+        for (uint32_t j = 0; j < nargs; ++j) {
+            args.push_back(get_string());
+        }
+        result.push_back(Attribute { name, std::move(args), pos });
+    }
+    return result;
+}
+
+std::unique_ptr<Declaration> Reader::read_declaration(void) {
+    auto stmt = read_statement();
+    if (!llvm::isa<Declaration>(stmt.get())) throw BadCache();
+    return std::unique_ptr<Declaration>(llvm::cast<Declaration>(stmt.release()));
+}
+
+std::vector<std::unique_ptr<Declaration>> Reader::read_declarations(void) {
+    std::vector<std::unique_ptr<Declaration>> result;
+    uint32_t n = get_count();
+    for (uint32_t i = 0; i < n; ++i) {
+        result.push_back(read_declaration());
+    }
+    return result;
+}
+
+std::vector<std::string> Reader::read_argnames(void) {
+    std::vector<std::string> result;
+    uint32_t n = get_count();
+    for (uint32_t i = 0; i < n; ++i) {
+        result.push_back(get_string());
+    }
+    return result;
+}
+
+std::unique_ptr<FunctionDeclaration> Reader::read_function_declaration(void) {
+    if (get_u8() != Toplevel::FunctionDeclaration) throw BadCache();
+    return read_function_signature(get_pos());
+}
+
+std::unique_ptr<FunctionDeclaration>
+Reader::read_function_signature(SourcePos pos) {
+    const auto &name = get_string();
+    auto args = read_declarations();
+    auto ret = read_type();
+    auto attrs = read_attributes();
+    bool is_public = get_u8();
+    return std::make_unique<FunctionDeclaration>(name, std::move(args),
+                                                 std::move(ret), pos,
+                                                 std::move(attrs),
+                                                 is_public);
+}
+
+std::unique_ptr<Toplevel> Reader::read_toplevel(void) {
+    auto kind = get_u8();
+    auto pos = get_pos();
+
+    switch (kind) {
+        case Toplevel::TypeDeclaration:
+            return std::make_unique<TypeDeclaration>(get_string(), pos);
+        case Toplevel::StructDeclaration: {
+            const auto &name = get_string();
+            auto members = read_declarations();
+            return std::make_unique<StructDeclaration>(name,
+                                                       std::move(members),
+                                                       pos);
+        }
+        case Toplevel::TemplateStructDeclaration: {
+            auto argnames = read_argnames();
+            const auto &name = get_string();
+            auto members = read_declarations();
+            return std::make_unique<TemplateStructDeclaration>(
+                    name, argnames, std::move(members), pos);
+        }
+        case Toplevel::FunctionDeclaration:
+            return read_function_signature(pos);
+        case Toplevel::FunctionDefinition: {
+            bool is_const = get_u8();
+            auto sig = read_function_declaration();
+            auto block = read_block();
+            return std::make_unique<FunctionDefinition>(std::move(sig),
+                                                        std::move(block),
+                                                        pos, is_const);
+        }
+        case Toplevel::TemplateFunctionDefinition: {
+            auto argnames = read_argnames();
+            auto sig = read_function_declaration();
+            auto block = read_block();
+            return std::make_unique<TemplateFunctionDefinition>(
+                    std::move(sig), argnames, std::move(block), pos);
+        }
+        case Toplevel::GlobalDeclaration: {
+            auto type = read_type();
+            const auto &name = get_string();
+            bool is_const = get_u8();
+            bool is_thread_local = get_u8();
+            auto attrs = read_attributes();
+            bool is_public = get_u8();
+            std::unique_ptr<Expression> init;
+            if (get_u8()) init = read_expr();
+            return std::make_unique<GlobalDeclaration>(
+                    std::move(type), name, std::move(init), is_const,
+                    is_thread_local, std::move(attrs), pos, is_public);
+        }
+    }
+
+    throw BadCache();
+}
+
+}
+
+bool write_ast_cache(const std::string &cache_fname,
+                     const std::string &source_fname,
+                     const std::vector<std::unique_ptr<Toplevel>> &asts) {
+    SourceStamp stamp;
+    if (!stamp_source(source_fname, stamp)) return false;
+
+    Writer w;
+    ToplevelWriter toplevels(w);
+    w.put_u32(asts.size());
+    for (const auto &ast: asts) toplevels.visit(*ast);
+
+    std::ofstream out(cache_fname, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    uint32_t version = AST_FORMAT_VERSION;
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write((const char *)&version, sizeof(version));
+    out.write((const char *)&stamp.size, sizeof(stamp.size));
+    out.write((const char *)&stamp.hash, sizeof(stamp.hash));
+    w.finish(out);
+
+    return (bool)out;
+}
+
+uint64_t hash_template(const std::vector<std::string> &argnames,
+                       const FunctionDefinition &def) {
+    Writer w(false);
+    w.put_u32(argnames.size());
+    for (const auto &name: argnames) w.put_string(name);
+    ToplevelWriter(w).visit(def);
+
+    std::ostringstream out;
+    w.finish(out);
+
+    return llvm::xxHash64(out.str());
+}
+
+bool read_ast_cache(const std::string &cache_fname,
+                    const std::string &source_fname,
+                    std::vector<std::unique_ptr<Toplevel>> &asts) {
+    SourceStamp stamp;
+    if (!stamp_source(source_fname, stamp)) return false;
+
+    /* MemoryBuffer maps the file rather than reading it where possible. */
+    auto buf = llvm::MemoryBuffer::getFile(cache_fname, -1, false);
+    if (!buf) return false;
+
+    Reader r((*buf)->getBufferStart(), (*buf)->getBufferEnd(), source_fname);
+    std::vector<std::unique_ptr<Toplevel>> result;
+    try {
+        r.read_header();
+        if (r.get_u64() != stamp.size || r.get_u64() != stamp.hash) {
+            return false;
+        }
+        r.read_strings();
+        uint32_t n = r.get_count();
+        result.reserve(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            result.push_back(r.read_toplevel());
+        }
+        if (!r.at_end()) return false;
+    } catch (BadCache) {
+        return false;
+    }
+
+    for (auto &ast: result) asts.push_back(std::move(ast));
+    return true;
+}
+
+}
+
+}
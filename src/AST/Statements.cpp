@@ -86,6 +86,14 @@ private:
         out << "VoidReturn {}";
     }
 
+    void operator()(const Become &become) {
+        out << "Become {";
+
+        print_expr(become.call(), out);
+
+        out << "}";
+    }
+
     void operator()(const IfStatement &ifstmt) {
         out << "IfStatement {";
 
@@ -118,6 +126,54 @@ private:
         out << "}}";
     }
 
+    void print_attributes(const std::vector<Attribute> &attrs) {
+        out << "Attributes {";
+        for (auto iter = attrs.begin(); iter != attrs.end(); ++iter) {
+            if (iter != attrs.begin()) out << ", ";
+            out << iter->name << "(";
+            for (auto arg = iter->args.begin(); arg != iter->args.end();
+                 ++arg) {
+                if (arg != iter->args.begin()) out << ", ";
+                out << *arg;
+            }
+            out << ")";
+        }
+        out << "}";
+    }
+
+    void print_body(const std::vector<std::unique_ptr<Statement>> &body) {
+        out << "Body {";
+        for (auto iter = body.begin(); iter != body.end(); ++iter) {
+            if (iter != body.begin()) out << ", ";
+            visit(**iter);
+        }
+        out << "}";
+    }
+
+    void operator()(const WhileStatement &loop) {
+        out << "WhileStatement {";
+        print_attributes(loop.attributes());
+        out << ", ";
+        print_expr(loop.condition(), out);
+        out << ", ";
+        print_body(loop.body());
+        out << "}";
+    }
+
+    void operator()(const ForStatement &loop) {
+        out << "ForStatement {";
+        print_attributes(loop.attributes());
+        out << ", ";
+        visit(loop.init());
+        out << ", ";
+        print_expr(loop.condition(), out);
+        out << ", ";
+        visit(loop.step());
+        out << ", ";
+        print_body(loop.body());
+        out << "}";
+    }
+
     std::ostream &out;
 };
 
@@ -51,6 +51,7 @@ private:
     }
 
     void operator()(const FunctionDeclaration &fdecl) override {
+        if (fdecl.is_public()) out << "Pub";
         out << "FunctionDeclaration {" << fdecl.name() << ", ";
 
         for (const auto &arg: fdecl.args()) {
@@ -64,7 +65,8 @@ private:
     }
 
     void operator()(const FunctionDefinition &func) override {
-        out << "FunctionDefinition {";
+        out << (func.is_const() ? "ConstFunctionDefinition {"
+                                : "FunctionDefinition {");
         operator()(func.signature());
 
         for (const auto &arg: func.block()) {
@@ -99,6 +101,22 @@ private:
         out << "}";
     }
 
+    void operator()(const GlobalDeclaration &g) override {
+        if (g.is_public()) out << "Pub";
+        if (g.is_thread_local()) out << "ThreadLocal";
+        out << (g.is_const() ? "ConstGlobalDeclaration {"
+                             : "GlobalDeclaration {");
+        print_type(g.type(), out);
+        out << ", " << g.name();
+
+        if (g.init()) {
+            out << ", ";
+            print_expr(*g.init(), out);
+        }
+
+        out << "}";
+    }
+
     std::ostream &out;
 };
 
@@ -23,11 +23,20 @@
 #include <ostream>
 
 #include "AST/Types.hh"
+#include "AST/Expressions.hh"
 
 namespace Craeft {
 
 namespace AST {
 
+Array::Array(std::unique_ptr<Type> element, std::unique_ptr<Expression> length,
+             SourcePos pos)
+    : Type(TypeKind::Array, pos),
+      _element(std::move(element)),
+      _length(std::move(length)) {}
+
+Array::~Array(void) {}
+
 namespace {
 
 /** 
@@ -63,6 +72,20 @@ private:
         out << "}";
     }
 
+    void operator()(const Vector &vt) override {
+        out << "Vector {";
+        visit(vt.element());
+        out << ", " << vt.length() << "}";
+    }
+
+    void operator()(const Array &at) override {
+        out << "Array {";
+        visit(at.element());
+        out << ", ";
+        print_expr(at.length(), out);
+        out << "}";
+    }
+
     std::ostream &out;
 };
 
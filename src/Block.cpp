@@ -41,20 +41,26 @@ void Block::jump_to(Block other) {
     terminated = true;
 }
 
-void Block::cond_jump(Value cond, Block then_b, Block else_b) {
+void Block::cond_jump(Value cond, Block then_b, Block else_b,
+                      llvm::MDNode *weights) {
     assert(!terminated);
 
     llvm::IRBuilder<> builder(underlying);
 
-    builder.CreateCondBr(cond.to_llvm(), then_b.to_llvm(), else_b.to_llvm());
+    builder.CreateCondBr(cond.to_llvm(), then_b.to_llvm(), else_b.to_llvm(),
+                         weights);
 
     terminated = true;
 }
 
 void Block::return_(Value ret) {
+    return_(ret.to_llvm());
+}
+
+void Block::return_(llvm::Value *ret) {
     llvm::IRBuilder<> builder(underlying);
 
-    builder.CreateRet(ret.to_llvm());
+    builder.CreateRet(ret);
 
     terminated = true;
 }
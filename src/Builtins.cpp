@@ -0,0 +1,814 @@
+/**
+ * @file Builtins.cpp
+ *
+ * @brief Functions implemented directly by the translator.
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+
+#include "TranslatorImpl.hh"
+#include "VariantUtils.hh"
+
+namespace Craeft {
+
+/*****************************************************************************
+ * Argument checking.
+ */
+
+static void check_nargs(const std::string &name,
+                        const std::vector<Value> &args,
+                        unsigned n, SourcePos pos) {
+    if (args.size() != n) {
+        throw Error("error", "builtin \"" + name + "\" takes "
+                           + std::to_string(n) + " argument(s)", pos);
+    }
+}
+
+/**
+ * @brief Get the type of a vector argument, or raise an Error.
+ */
+static const Vector<> &get_vector(const std::string &name, const Value &arg,
+                                  SourcePos pos) {
+    auto *result = boost::get<Vector<> >(&arg.get_type());
+
+    if (!result) {
+        throw Error("type error", "builtin \"" + name + "\" expects a vector",
+                    pos);
+    }
+
+    return *result;
+}
+
+/**
+ * @brief Get the value of a constant integer argument, or raise an Error.
+ */
+static uint64_t get_constant(const std::string &name, const Value &arg,
+                             SourcePos pos) {
+    auto *c = llvm::dyn_cast<llvm::ConstantInt>(arg.to_llvm());
+
+    if (!arg.is_integral() || !c) {
+        throw Error("type error", "builtin \"" + name + "\" expects an "
+                                  "integer constant", pos);
+    }
+
+    return c->getZExtValue();
+}
+
+/**
+ * @brief Get the element type of a vector type, or the type itself if it is
+ *        a scalar.
+ */
+static const Type &scalar_type(const Type &t) {
+    if (auto *vec = boost::get<Vector<> >(&t)) {
+        return *vec->get_element();
+    }
+
+    return t;
+}
+
+/**
+ * @brief Raise an Error unless the argument is an integer, or a vector of
+ *        integers.
+ */
+static void check_integer(const std::string &name, const Value &arg,
+                          SourcePos pos) {
+    const auto &t = scalar_type(arg.get_type());
+
+    if (!is_type<SignedInt>(t) && !is_type<UnsignedInt>(t)) {
+        throw Error("type error", "builtin \"" + name + "\" expects an "
+                                  "integer", pos);
+    }
+}
+
+/**
+ * @brief Raise an Error unless the argument is a float, or a vector of
+ *        floats.
+ */
+static void check_float(const std::string &name, const Value &arg,
+                        SourcePos pos) {
+    if (!is_type<Float>(scalar_type(arg.get_type()))) {
+        throw Error("type error", "builtin \"" + name + "\" expects a "
+                                  "floating-point value", pos);
+    }
+}
+
+/**
+ * @brief Get a pointer argument as an `i8*`, or raise an Error.
+ */
+static llvm::Value *get_byte_pointer(const std::string &name,
+                                     llvm::IRBuilder<> &builder,
+                                     const Value &arg, SourcePos pos) {
+    if (!is_type<Pointer<> >(arg.get_type())) {
+        throw Error("type error", "builtin \"" + name + "\" expects a "
+                                  "pointer", pos);
+    }
+
+    return builder.CreateBitCast(arg.to_llvm(), builder.getInt8PtrTy());
+}
+
+/**
+ * @brief Get an integer argument as a U64 byte count, or raise an Error.
+ */
+static llvm::Value *get_size(const std::string &name,
+                             llvm::IRBuilder<> &builder, const Value &arg,
+                             SourcePos pos) {
+    if (!arg.is_integral()) {
+        throw Error("type error", "builtin \"" + name + "\" expects an "
+                                  "integer size", pos);
+    }
+
+    return builder.CreateZExtOrTrunc(arg.to_llvm(), builder.getInt64Ty());
+}
+
+/*****************************************************************************
+ * Vector operations.
+ */
+
+Value TranslatorImpl::vector_shuffle(Value lhs, Value rhs,
+                                     const std::vector<unsigned> &mask,
+                                     SourcePos pos) {
+    const auto &vec = get_vector("vec_shuffle", lhs, pos);
+
+    if (!(lhs.get_type() == rhs.get_type())) {
+        throw Error("type error", "cannot shuffle vectors of different types",
+                    pos);
+    }
+
+    std::vector<llvm::Constant *> lanes;
+    for (auto lane: mask) {
+        if (lane >= 2 * vec.get_length()) {
+            throw Error("error", "shuffle index out of range", pos);
+        }
+        lanes.push_back(builder.getInt32(lane));
+    }
+
+    auto *inst = builder.CreateShuffleVector(lhs.to_llvm(), rhs.to_llvm(),
+                                             llvm::ConstantVector::get(lanes));
+
+    return Value(inst, Vector<>(*vec.get_element(), mask.size()));
+}
+
+Value TranslatorImpl::vector_reduce(Value vec,
+                                    std::function<Value(Value, Value)> op,
+                                    SourcePos pos) {
+    Type element = *get_vector("vec_reduce", vec, pos).get_element();
+    unsigned n = boost::get<Vector<> >(vec.get_type()).get_length();
+
+    auto lane = [&](Value v, unsigned i) {
+        auto *inst = builder.CreateExtractElement(v.to_llvm(),
+                                                  builder.getInt32(i));
+        return Value(inst, element);
+    };
+
+    // Repeatedly combine the low and high halves of the vector, which the
+    // backend can do with a shuffle and a single vector instruction.  Lanes
+    // left over by odd lengths are combined at the end.
+    std::vector<Value> leftovers;
+    while (n > 1) {
+        if (n % 2) {
+            leftovers.push_back(lane(vec, --n));
+        }
+
+        std::vector<unsigned> low, high;
+        for (unsigned i = 0; i < n / 2; ++i) {
+            low.push_back(i);
+            high.push_back(i + n / 2);
+        }
+
+        Value undef(llvm::UndefValue::get(vec.to_llvm()->getType()),
+                    vec.get_type());
+        vec = op(vector_shuffle(vec, undef, low, pos),
+                 vector_shuffle(vec, undef, high, pos));
+        n /= 2;
+    }
+
+    auto result = lane(vec, 0);
+
+    for (auto &leftover: leftovers) {
+        result = op(result, leftover);
+    }
+
+    return result;
+}
+
+Value TranslatorImpl::select(Value cond, Value lhs, Value rhs,
+                             SourcePos pos) {
+    if (!(lhs.get_type() == rhs.get_type())) {
+        throw Error("type error", "cannot select between values of different "
+                                  "types", pos);
+    }
+
+    // The condition must be a U1, or a mask with a U1 for each lane.
+    Type cond_ty = UnsignedInt(1);
+    if (auto *vec = boost::get<Vector<> >(&lhs.get_type())) {
+        cond_ty = Vector<>(UnsignedInt(1), vec->get_length());
+    }
+
+    if (!(cond.get_type() == cond_ty)) {
+        throw Error("type error", "select condition must be a U1, or a mask "
+                                  "of the same length as the vectors", pos);
+    }
+
+    auto *inst = builder.CreateSelect(cond.to_llvm(), lhs.to_llvm(),
+                                      rhs.to_llvm());
+    return Value(inst, lhs.get_type());
+}
+
+/*****************************************************************************
+ * Intrinsics.
+ */
+
+Value TranslatorImpl::intrinsic(llvm::Intrinsic::ID id,
+                                std::vector<Value> &args, SourcePos pos) {
+    std::vector<llvm::Value *> llvm_args;
+
+    for (const auto &arg: args) {
+        if (!(arg.get_type() == args[0].get_type())) {
+            throw Error("type error", "arguments to builtin must all have the "
+                                      "same type", pos);
+        }
+        llvm_args.push_back(arg.to_llvm());
+    }
+
+    auto *ty = args[0].to_llvm()->getType();
+    auto *decl = llvm::Intrinsic::getDeclaration(module.get(), id, { ty });
+    auto *inst = builder.CreateCall(decl, llvm_args);
+
+    return Value(inst, args[0].get_type());
+}
+
+Value TranslatorImpl::rotate(Value val, Value nbits, bool left,
+                             SourcePos pos) {
+    auto name = left ? "rotl" : "rotr";
+    check_integer(name, val, pos);
+
+    auto *amount = nbits.to_llvm();
+    if (!(nbits.get_type() == val.get_type())) {
+        if (!val.is_integral() || !nbits.is_integral()) {
+            throw Error("type error", "vector rotations must be by a vector "
+                                      "of the same type", pos);
+        }
+        amount = builder.CreateZExtOrTrunc(amount,
+                                           val.to_llvm()->getType());
+    }
+
+    // Shift by the amount modulo the bit width one way, and by its
+    // complement the other way, which the backend matches to a rotation.
+    auto *ty = val.to_llvm()->getType();
+    auto *mask = llvm::ConstantInt::get(ty, ty->getScalarSizeInBits() - 1);
+    auto *fwd = builder.CreateAnd(amount, mask);
+    auto *back = builder.CreateAnd(builder.CreateNeg(amount), mask);
+
+    auto *v = val.to_llvm();
+    auto *hi = left ? builder.CreateShl(v, fwd) : builder.CreateLShr(v, fwd);
+    auto *lo = left ? builder.CreateLShr(v, back) : builder.CreateShl(v, back);
+
+    return Value(builder.CreateOr(hi, lo), val.get_type());
+}
+
+/*****************************************************************************
+ * Atomic operations.
+ */
+
+Type TranslatorImpl::get_atomic_type(const std::string &name,
+                                     const Value &ptr, bool allow_pointers,
+                                     SourcePos pos) {
+    auto *ptr_ty = boost::get<Pointer<> >(&ptr.get_type());
+
+    if (!ptr_ty) {
+        throw Error("type error", "builtin \"" + name + "\" expects a "
+                                  "pointer", pos);
+    }
+
+    const auto &t = *ptr_ty->get_pointed();
+    bool ok = allow_pointers && is_type<Pointer<> >(t);
+
+    // Only integers of whole, power-of-two numbers of bytes are atomic.
+    if (is_type<SignedInt>(t) || is_type<UnsignedInt>(t)) {
+        auto bits = to_llvm_type(t, *module)->getIntegerBitWidth();
+        ok = bits >= 8 && bits <= 64 && (bits & (bits - 1)) == 0;
+    }
+
+    if (!ok) {
+        throw Error("type error", "builtin \"" + name + "\" cannot access "
+                                  "the pointed type atomically", pos);
+    }
+
+    return t;
+}
+
+/* Atomic accesses must be naturally aligned. */
+static unsigned atomic_align(const llvm::Module &mod, llvm::Type *t) {
+    return mod.getDataLayout().getTypeStoreSize(t);
+}
+
+Value TranslatorImpl::atomic_load(Value ptr, llvm::AtomicOrdering order,
+                                  SourcePos pos) {
+    auto t = get_atomic_type("atomic_load", ptr, true, pos);
+    auto *llvm_ty = to_llvm_type(t, *module);
+
+    auto *inst = builder.CreateLoad(llvm_ty, ptr.to_llvm());
+    inst->setAlignment(atomic_align(*module, llvm_ty));
+    inst->setAtomic(order);
+
+    return Value(inst, t);
+}
+
+Value TranslatorImpl::atomic_store(Value ptr, Value val,
+                                   llvm::AtomicOrdering order,
+                                   SourcePos pos) {
+    auto t = get_atomic_type("atomic_store", ptr, true, pos);
+
+    if (!(val.get_type() == t)) {
+        throw Error("type error", "stored value does not match pointed type",
+                    pos);
+    }
+
+    auto *inst = builder.CreateStore(val.to_llvm(), ptr.to_llvm());
+    inst->setAlignment(atomic_align(*module, val.to_llvm()->getType()));
+    inst->setAtomic(order);
+
+    return Value(inst, Void());
+}
+
+Value TranslatorImpl::atomic_rmw(const std::string &op, Value ptr,
+                                 Value val, llvm::AtomicOrdering order,
+                                 SourcePos pos) {
+    auto t = get_atomic_type("atomic_" + op, ptr, false, pos);
+
+    if (!(val.get_type() == t)) {
+        throw Error("type error", "operand does not match pointed type",
+                    pos);
+    }
+
+    bool is_signed = is_type<SignedInt>(t);
+
+    static const std::map<std::string, llvm::AtomicRMWInst::BinOp> ops {
+        {"xchg", llvm::AtomicRMWInst::Xchg},
+        {"add", llvm::AtomicRMWInst::Add},
+        {"sub", llvm::AtomicRMWInst::Sub},
+        {"and", llvm::AtomicRMWInst::And},
+        {"or", llvm::AtomicRMWInst::Or},
+        {"xor", llvm::AtomicRMWInst::Xor},
+        {"min", llvm::AtomicRMWInst::UMin},
+        {"max", llvm::AtomicRMWInst::UMax},
+    };
+
+    auto bin_op = ops.at(op);
+    if (is_signed && bin_op == llvm::AtomicRMWInst::UMin) {
+        bin_op = llvm::AtomicRMWInst::Min;
+    } else if (is_signed && bin_op == llvm::AtomicRMWInst::UMax) {
+        bin_op = llvm::AtomicRMWInst::Max;
+    }
+
+    auto *inst = builder.CreateAtomicRMW(bin_op, ptr.to_llvm(), val.to_llvm(),
+                                         order);
+
+    return Value(inst, t);
+}
+
+Value TranslatorImpl::atomic_cmpxchg(Value ptr, Value expected,
+                                     Value desired,
+                                     llvm::AtomicOrdering order,
+                                     SourcePos pos) {
+    auto t = get_atomic_type("atomic_cmpxchg", ptr, true, pos);
+
+    if (!(expected.get_type() == t) || !(desired.get_type() == t)) {
+        throw Error("type error", "operands do not match pointed type", pos);
+    }
+
+    // A failed exchange only loads, so cannot have release semantics.
+    auto failure = llvm::AtomicCmpXchgInst::getStrongestFailureOrdering(order);
+
+    auto *inst = builder.CreateAtomicCmpXchg(ptr.to_llvm(),
+                                             expected.to_llvm(),
+                                             desired.to_llvm(),
+                                             order, failure);
+
+    return Value(builder.CreateExtractValue(inst, 0), t);
+}
+
+/*****************************************************************************
+ * Type layout queries.
+ */
+
+llvm::Type *TranslatorImpl::get_sized_type(const Type &t, SourcePos pos) {
+    if (is_type<Void>(t) || is_type<Function<> >(t)) {
+        throw Error("type error", "type has no size", pos);
+    }
+
+    if (has_erased_layout(t)) {
+        throw Error("type error", "layout of type is only known at run time",
+                    pos);
+    }
+
+    return to_llvm_type(t, *module);
+}
+
+/*****************************************************************************
+ * The table of builtins.
+ */
+
+const std::map<std::string, TranslatorImpl::Builtin> &
+TranslatorImpl::get_builtins(void) {
+    typedef std::vector<Value> Args;
+
+    /* Builtins reducing a vector with the given translator operation. */
+    auto reduction = [](std::string name,
+                        Value (TranslatorImpl::*op)(Value, Value, SourcePos)) {
+        return [name, op](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs(name, args, 1, pos);
+            return t.vector_reduce(args[0], [&](Value l, Value r) {
+                return (t.*op)(l, r, pos);
+            }, pos);
+        };
+    };
+
+    /* Builtins applying an intrinsic to a single integer, or each lane of a
+     * vector of integers.  Counting zeros of zero gives the bit width. */
+    auto int_op = [](std::string name, llvm::Intrinsic::ID id) {
+        return [name, id](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs(name, args, 1, pos);
+            check_integer(name, args[0], pos);
+            if (id == llvm::Intrinsic::ctpop) {
+                return t.intrinsic(id, args, pos);
+            }
+            auto *decl = llvm::Intrinsic::getDeclaration(
+                    t.module.get(), id, { args[0].to_llvm()->getType() });
+            auto *inst = t.builder.CreateCall(
+                    decl, { args[0].to_llvm(), t.builder.getFalse() });
+            return Value(inst, args[0].get_type());
+        };
+    };
+
+    auto branch_hint = [](std::string name, bool expected) {
+        return [name, expected](TranslatorImpl &t, Args &args,
+                                SourcePos pos) {
+            check_nargs(name, args, 1, pos);
+            if (!(args[0].get_type() == Type(UnsignedInt(1)))) {
+                throw Error("type error", "builtin \"" + name + "\" expects "
+                                          "a U1", pos);
+            }
+            Args converted { args[0], Value(t.builder.getInt1(expected),
+                                            UnsignedInt(1)) };
+            return t.intrinsic(llvm::Intrinsic::expect, converted, pos);
+        };
+    };
+
+    static const std::map<std::string, Builtin> builtins {
+        /* vec_extract(v, i): the `i`th lane of `v`. */
+        {"vec_extract", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("vec_extract", args, 2, pos);
+            const auto &vec = get_vector("vec_extract", args[0], pos);
+            if (!args[1].is_integral()) {
+                throw Error("type error", "lane index must be an integer",
+                            pos);
+            }
+            auto *inst = t.builder.CreateExtractElement(args[0].to_llvm(),
+                                                        args[1].to_llvm());
+            return Value(inst, *vec.get_element());
+        }},
+
+        /* vec_insert(v, i, x): `v` with its `i`th lane replaced by `x`. */
+        {"vec_insert", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("vec_insert", args, 3, pos);
+            const auto &vec = get_vector("vec_insert", args[0], pos);
+            if (!args[1].is_integral()) {
+                throw Error("type error", "lane index must be an integer",
+                            pos);
+            }
+            if (!(args[2].get_type() == *vec.get_element())) {
+                throw Error("type error", "inserted value does not match "
+                                          "vector element type", pos);
+            }
+            auto *inst = t.builder.CreateInsertElement(args[0].to_llvm(),
+                                                       args[2].to_llvm(),
+                                                       args[1].to_llvm());
+            return Value(inst, args[0].get_type());
+        }},
+
+        /* vec_shuffle(a, b, i...): a vector of the given lanes of `a` and
+         * `b` (numbered consecutively). */
+        {"vec_shuffle", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            if (args.size() < 3) {
+                throw Error("error", "builtin \"vec_shuffle\" takes two "
+                                     "vectors and at least one index", pos);
+            }
+            std::vector<unsigned> mask;
+            for (unsigned i = 2; i < args.size(); ++i) {
+                mask.push_back(get_constant("vec_shuffle", args[i], pos));
+            }
+            return t.vector_shuffle(args[0], args[1], mask, pos);
+        }},
+
+        /* vec_select(mask, a, b): each lane from `a` where `mask` is set,
+         * and otherwise from `b`. */
+        {"vec_select", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("vec_select", args, 3, pos);
+            get_vector("vec_select", args[1], pos);
+            return t.select(args[0], args[1], args[2], pos);
+        }},
+
+        /* Horizontal reductions. */
+        {"vec_reduce_add", reduction("vec_reduce_add", &TranslatorImpl::add)},
+        {"vec_reduce_mul", reduction("vec_reduce_mul", &TranslatorImpl::mul)},
+        {"vec_reduce_and",
+            reduction("vec_reduce_and", &TranslatorImpl::bit_and)},
+        {"vec_reduce_or", reduction("vec_reduce_or", &TranslatorImpl::bit_or)},
+        {"vec_reduce_xor",
+            reduction("vec_reduce_xor", &TranslatorImpl::bit_xor)},
+        {"vec_reduce_min", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("vec_reduce_min", args, 1, pos);
+            return t.vector_reduce(args[0], [&](Value l, Value r) {
+                return t.select(t.less(l, r, pos), l, r, pos);
+            }, pos);
+        }},
+        {"vec_reduce_max", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("vec_reduce_max", args, 1, pos);
+            return t.vector_reduce(args[0], [&](Value l, Value r) {
+                return t.select(t.greater(l, r, pos), l, r, pos);
+            }, pos);
+        }},
+
+        /* Bit operations on integers, or lane by lane on vectors. */
+        {"popcount", int_op("popcount", llvm::Intrinsic::ctpop)},
+        {"clz", int_op("clz", llvm::Intrinsic::ctlz)},
+        {"ctz", int_op("ctz", llvm::Intrinsic::cttz)},
+        {"bswap", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("bswap", args, 1, pos);
+            check_integer("bswap", args[0], pos);
+            auto *ty = args[0].to_llvm()->getType()->getScalarType();
+            if (ty->getIntegerBitWidth() % 16) {
+                throw Error("type error", "builtin \"bswap\" expects an "
+                                          "even number of bytes", pos);
+            }
+            return t.intrinsic(llvm::Intrinsic::bswap, args, pos);
+        }},
+
+        /* rotl(x, n), rotr(x, n): `x` rotated left or right by `n` bits. */
+        {"rotl", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("rotl", args, 2, pos);
+            return t.rotate(args[0], args[1], true, pos);
+        }},
+        {"rotr", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("rotr", args, 2, pos);
+            return t.rotate(args[0], args[1], false, pos);
+        }},
+
+        /* Floating-point operations, also lane by lane on vectors. */
+        {"sqrt", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("sqrt", args, 1, pos);
+            check_float("sqrt", args[0], pos);
+            return t.intrinsic(llvm::Intrinsic::sqrt, args, pos);
+        }},
+        /* fma(a, b, c): a * b + c, rounded once. */
+        {"fma", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("fma", args, 3, pos);
+            check_float("fma", args[0], pos);
+            return t.intrinsic(llvm::Intrinsic::fma, args, pos);
+        }},
+
+        /* memcpy(dst, src, n), memmove(dst, src, n): copy `n` bytes, which
+         * for memcpy must not overlap. */
+        {"memcpy", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("memcpy", args, 3, pos);
+            auto *dst = get_byte_pointer("memcpy", t.builder, args[0], pos);
+            auto *src = get_byte_pointer("memcpy", t.builder, args[1], pos);
+            auto *n = get_size("memcpy", t.builder, args[2], pos);
+            auto *inst = t.builder.CreateMemCpy(dst, src, n, 1);
+            return Value(inst, Void());
+        }},
+        {"memmove", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("memmove", args, 3, pos);
+            auto *dst = get_byte_pointer("memmove", t.builder, args[0], pos);
+            auto *src = get_byte_pointer("memmove", t.builder, args[1], pos);
+            auto *n = get_size("memmove", t.builder, args[2], pos);
+            auto *inst = t.builder.CreateMemMove(dst, src, n, 1);
+            return Value(inst, Void());
+        }},
+        /* memset(dst, byte, n): set `n` bytes to the low byte of `byte`. */
+        {"memset", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("memset", args, 3, pos);
+            auto *dst = get_byte_pointer("memset", t.builder, args[0], pos);
+            if (!args[1].is_integral()) {
+                throw Error("type error", "builtin \"memset\" expects an "
+                                          "integer byte", pos);
+            }
+            auto *byte = t.builder.CreateZExtOrTrunc(args[1].to_llvm(),
+                                                     t.builder.getInt8Ty());
+            auto *n = get_size("memset", t.builder, args[2], pos);
+            auto *inst = t.builder.CreateMemSet(dst, byte, n, 1);
+            return Value(inst, Void());
+        }},
+
+        /* prefetch(p) or prefetch(p, write, locality): hint that `p` will
+         * soon be read (or, if `write` is 1, written), with temporal
+         * locality from 0 (none) to 3 (high, the default). */
+        {"prefetch", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            if (args.size() != 1 && args.size() != 3) {
+                throw Error("error", "builtin \"prefetch\" takes 1 or 3 "
+                                     "arguments", pos);
+            }
+            auto *ptr = get_byte_pointer("prefetch", t.builder, args[0], pos);
+            uint64_t write = 0, locality = 3;
+            if (args.size() == 3) {
+                write = get_constant("prefetch", args[1], pos);
+                locality = get_constant("prefetch", args[2], pos);
+            }
+            if (write > 1 || locality > 3) {
+                throw Error("error", "prefetch write flag or locality out of "
+                                     "range", pos);
+            }
+            auto *decl = llvm::Intrinsic::getDeclaration(
+                    t.module.get(), llvm::Intrinsic::prefetch);
+            auto *inst = t.builder.CreateCall(
+                    decl, { ptr, t.builder.getInt32(write),
+                      t.builder.getInt32(locality),
+                      // Prefetch into the data cache.
+                      t.builder.getInt32(1) });
+            return Value(inst, Void());
+        }},
+
+        /* assume(c): let the optimizer assume that `c` holds. */
+        {"assume", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("assume", args, 1, pos);
+            if (!(args[0].get_type() == Type(UnsignedInt(1)))) {
+                throw Error("type error", "builtin \"assume\" expects a U1",
+                            pos);
+            }
+            auto *inst = t.builder.CreateAssumption(args[0].to_llvm());
+            return Value(inst, Void());
+        }},
+
+        /* likely(c), unlikely(c): `c`, which is expected to be 1 (or 0).
+         * Branches on them are weighted accordingly. */
+        {"likely", branch_hint("likely", true)},
+        {"unlikely", branch_hint("unlikely", false)},
+
+        /* expect(x, v): `x`, which is expected to equal the constant `v`. */
+        {"expect", [](TranslatorImpl &t, Args &args, SourcePos pos) {
+            check_nargs("expect", args, 2, pos);
+            if (!args[0].is_integral()) {
+                throw Error("type error", "builtin \"expect\" expects an "
+                                          "integer", pos);
+            }
+            get_constant("expect", args[1], pos);
+            auto *v = t.builder.CreateZExtOrTrunc(
+                    args[1].to_llvm(), args[0].to_llvm()->getType());
+            Args converted { args[0], Value(v, args[0].get_type()) };
+            return t.intrinsic(llvm::Intrinsic::expect, converted, pos);
+        }},
+    };
+
+    static const auto with_atomics = add_atomic_builtins(builtins);
+
+    return with_atomics;
+}
+
+std::map<std::string, TranslatorImpl::Builtin>
+TranslatorImpl::add_atomic_builtins(std::map<std::string, Builtin> builtins) {
+    typedef std::vector<Value> Args;
+    typedef llvm::AtomicOrdering Ordering;
+
+    const std::vector<std::pair<std::string, Ordering> > orderings {
+        {"relaxed", Ordering::Monotonic},
+        {"acquire", Ordering::Acquire},
+        {"release", Ordering::Release},
+        {"acq_rel", Ordering::AcquireRelease},
+        {"seq_cst", Ordering::SequentiallyConsistent},
+    };
+
+    const std::vector<std::string> rmw_ops {
+        "xchg", "add", "sub", "and", "or", "xor", "min", "max"
+    };
+
+    for (const auto &pair: orderings) {
+        auto suffix = "_" + pair.first;
+        auto order = pair.second;
+
+        bool acquires = order != Ordering::Release
+                     && order != Ordering::AcquireRelease;
+        bool releases = order != Ordering::Acquire
+                     && order != Ordering::AcquireRelease;
+
+        /* atomic_load_<order>(p): the value at `p`. */
+        if (acquires) {
+            auto name = "atomic_load" + suffix;
+            builtins[name] = [name, order](TranslatorImpl &t, Args &args,
+                                           SourcePos pos) {
+                check_nargs(name, args, 1, pos);
+                return t.atomic_load(args[0], order, pos);
+            };
+        }
+
+        /* atomic_store_<order>(p, x): store `x` at `p`. */
+        if (releases) {
+            auto name = "atomic_store" + suffix;
+            builtins[name] = [name, order](TranslatorImpl &t, Args &args,
+                                           SourcePos pos) {
+                check_nargs(name, args, 2, pos);
+                return t.atomic_store(args[0], args[1], order, pos);
+            };
+        }
+
+        /* atomic_<op>_<order>(p, x): combine `x` into the value at `p`, and
+         * return the previous value. */
+        for (const auto &op: rmw_ops) {
+            auto name = "atomic_" + op + suffix;
+            builtins[name] = [name, op, order](TranslatorImpl &t, Args &args,
+                                               SourcePos pos) {
+                check_nargs(name, args, 2, pos);
+                return t.atomic_rmw(op, args[0], args[1], order, pos);
+            };
+        }
+
+        /* atomic_cmpxchg_<order>(p, expected, desired): replace the value at
+         * `p` with `desired` if it is `expected`, and return the previous
+         * value. */
+        auto cmpxchg = "atomic_cmpxchg" + suffix;
+        builtins[cmpxchg] = [cmpxchg, order](TranslatorImpl &t, Args &args,
+                                             SourcePos pos) {
+            check_nargs(cmpxchg, args, 3, pos);
+            return t.atomic_cmpxchg(args[0], args[1], args[2], order, pos);
+        };
+
+        /* fence_<order>(): order memory accesses around the fence. */
+        if (order != Ordering::Monotonic) {
+            auto fence = "fence" + suffix;
+            builtins[fence] = [fence, order](TranslatorImpl &t, Args &args,
+                                             SourcePos pos) {
+                check_nargs(fence, args, 0, pos);
+                return Value(t.builder.CreateFence(order), Void());
+            };
+        }
+    }
+
+    return builtins;
+}
+
+const std::map<std::string, TranslatorImpl::TemplateBuiltin> &
+TranslatorImpl::get_template_builtins(void) {
+    typedef std::vector<Type> Types;
+    typedef std::vector<Value> Args;
+
+    /* Builtins folding a property of a single type argument to a U64
+     * constant.  For an erased type, it is loaded from the given field of
+     * the type's descriptor instead. */
+    auto query = [](std::string name, unsigned field,
+                    uint64_t (*get)(const llvm::DataLayout &, llvm::Type *)) {
+        return [name, field, get](TranslatorImpl &t, Types &types, Args &args,
+                                  SourcePos pos) {
+            if (types.size() != 1 || !args.empty()) {
+                throw Error("error", "builtin \"" + name + "\" takes one "
+                                     "type argument and no arguments", pos);
+            }
+            if (auto *erased = boost::get<Erased>(&types[0])) {
+                return Value(t.erased_layout(*erased, field),
+                             UnsignedInt(64));
+            }
+            auto *ty = t.get_sized_type(types[0], pos);
+            auto n = get(t.module->getDataLayout(), ty);
+            return Value(t.builder.getInt64(n), UnsignedInt(64));
+        };
+    };
+
+    static const std::map<std::string, TemplateBuiltin> builtins {
+        /* sizeof<:T:>(): the distance in bytes between consecutive `T`s in
+         * memory. */
+        {"sizeof", query("sizeof", 0,
+            [](const llvm::DataLayout &dl, llvm::Type *ty) -> uint64_t {
+                return dl.getTypeAllocSize(ty);
+            })},
+
+        /* alignof<:T:>(): the alignment in bytes of `T`. */
+        {"alignof", query("alignof", 1,
+            [](const llvm::DataLayout &dl, llvm::Type *ty) -> uint64_t {
+                return dl.getABITypeAlignment(ty);
+            })},
+    };
+
+    return builtins;
+}
+
+}
@@ -0,0 +1,554 @@
+/**
+ * @file Codegen/Constant.cpp
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+
+#include "llvm/IR/Constants.h"
+
+#include "AST/Statements.hh"
+#include "Codegen/Constant.hh"
+#include "Codegen/Type.hh"
+#include "Codegen/Value.hh"
+#include "VariantUtils.hh"
+
+namespace Craeft {
+
+namespace Codegen {
+
+/**
+ * @brief Maximum number of statements and calls in a single evaluation.
+ */
+static const unsigned long MAX_STEPS = 1 << 20;
+
+/**
+ * @brief Maximum depth of nested `const fn` calls.
+ */
+static const unsigned MAX_DEPTH = 512;
+
+/**
+ * @brief Get whether the given LLVM value is constant numeric data.
+ */
+static bool is_constant_data(const llvm::Value *val) {
+    if (auto *agg = llvm::dyn_cast<llvm::ConstantAggregate>(val)) {
+        for (const auto &op: agg->operands()) {
+            if (!is_constant_data(op)) return false;
+        }
+        return true;
+    }
+
+    return llvm::isa<llvm::ConstantInt>(val)
+        || llvm::isa<llvm::ConstantFP>(val)
+        || llvm::isa<llvm::ConstantDataSequential>(val)
+        || llvm::isa<llvm::ConstantAggregateZero>(val);
+}
+
+bool is_constant(const Value &val) {
+    return val.to_llvm() && is_constant_data(val.to_llvm());
+}
+
+/*****************************************************************************
+ * Expressions.
+ */
+
+class ConstantEval::ExpressionEval: public AST::ExpressionVisitor<Value> {
+public:
+    /**
+     * @param frame The local variables in scope, or NULL outside of a
+     *              `const fn`.
+     */
+    ExpressionEval(ConstantEval &eval, Frame *frame)
+        : eval(eval), frame(frame) {}
+
+private:
+    /* Literals are already constants. */
+    Value operator()(const AST::IntLiteral &lit) override {
+        return ValueGen(eval._translator).visit(lit);
+    }
+    Value operator()(const AST::UIntLiteral &lit) override {
+        return ValueGen(eval._translator).visit(lit);
+    }
+    Value operator()(const AST::FloatLiteral &lit) override {
+        return ValueGen(eval._translator).visit(lit);
+    }
+
+    Value operator()(const AST::Variable &var) override {
+        if (frame) {
+            for (auto scope = frame->rbegin(); scope != frame->rend();
+                 ++scope) {
+                auto found = scope->find(var.name());
+                if (found == scope->end()) {
+                    continue;
+                }
+
+                if (!found->second.to_llvm()) {
+                    throw Error("error", "variable \"" + var.name()
+                                       + "\" used before assignment",
+                                var.pos());
+                }
+                return found->second;
+            }
+        }
+
+        return check(eval._translator.get_constant_value(var.name(),
+                                                         var.pos()),
+                     var.pos());
+    }
+
+    Value operator()(const AST::Binop &binop) override {
+        auto lhs = visit(binop.lhs());
+
+        // As at run time, `&&` and `||` skip the right-hand side if the left
+        // decides the result.
+        auto *c = llvm::dyn_cast<llvm::ConstantInt>(lhs.to_llvm());
+        if (c && lhs.get_type() == Type(UnsignedInt(1))
+              && ((binop.op() == "&&" && c->isZero())
+               || (binop.op() == "||" && !c->isZero()))) {
+            return lhs;
+        }
+
+        auto rhs = visit(binop.rhs());
+
+        if (binop.op() == "/") {
+            auto *divisor = llvm::dyn_cast<llvm::ConstantInt>(rhs.to_llvm());
+            if (divisor && divisor->isZero()) {
+                throw Error("error", "division by zero in constant "
+                                     "expression", binop.pos());
+            }
+        }
+
+        return check(apply_binop(eval._translator, binop.op(), lhs, rhs,
+                                 binop.pos()),
+                     binop.pos());
+    }
+
+    Value operator()(const AST::FunctionCall &call) override {
+        auto *def = eval._translator.lookup_const_function(call.fname());
+
+        if (!def) {
+            throw NotConstant("call to non-const function \""
+                              + call.fname() + "\" in constant expression",
+                              call.pos());
+        }
+
+        std::vector<Value> args;
+        for (const auto &arg: call.args()) {
+            args.push_back(visit(*arg));
+        }
+
+        return eval.call(*def, args, call.pos());
+    }
+
+    /* The layout builtins are computed from the data layout. */
+    Value operator()(const AST::TemplateFunctionCall &call) override {
+        const auto &name = call.fname();
+        if (name != "sizeof" && name != "alignof" && name != "offsetof") {
+            not_constant(call.pos());
+        }
+
+        return check(ValueGen(eval._translator).visit(call), call.pos());
+    }
+
+    Value operator()(const AST::Cast &cast) override {
+        auto dest_ty = TypeGen(eval._translator).visit(cast.type());
+
+        auto val = visit(cast.arg());
+
+        return check(eval._translator.cast(val, dest_ty, cast.pos()),
+                     cast.pos());
+    }
+
+    Value operator()(const AST::ArrayLiteral &arr) override {
+        std::vector<Value> elements;
+        for (const auto &elem: arr.elements()) {
+            elements.push_back(visit(*elem));
+        }
+
+        return check(eval._translator.array_literal(elements, arr.pos()),
+                     arr.pos());
+    }
+
+    Value operator()(const AST::Index &index) override {
+        auto array = visit(index.array());
+        auto idx = visit(index.index());
+
+        return check(eval._translator.index(array, idx, index.pos()),
+                     index.pos());
+    }
+
+    /* String literals are constant addresses, so they may initialize
+     * globals, but nothing can be done with them at compile time. */
+    Value operator()(const AST::StringLiteral &lit) override {
+        return eval._translator.string_literal(lit.value());
+    }
+
+    /* Anything else involving memory is evaluated at run time. */
+    Value operator()(const AST::Reference &ref) override {
+        not_constant(ref.pos());
+    }
+    Value operator()(const AST::Dereference &deref) override {
+        not_constant(deref.pos());
+    }
+    Value operator()(const AST::FieldAccess &fa) override {
+        not_constant(fa.pos());
+    }
+
+    [[noreturn]] void not_constant(SourcePos pos) {
+        throw NotConstant("expression is not constant", pos);
+    }
+
+    /**
+     * @brief Check that the translator folded the result of an operation.
+     */
+    Value check(Value val, SourcePos pos) {
+        if (!is_constant(val)) {
+            not_constant(pos);
+        }
+
+        return val;
+    }
+
+    ConstantEval &eval;
+    Frame *frame;
+};
+
+/*****************************************************************************
+ * Statements.
+ */
+
+/**
+ * @brief Executes the statements of a `const fn`.
+ *
+ * `visit` returns whether the statement returned from the function, in which
+ * case the returned value is in `result`.
+ */
+class ConstantEval::StatementEval: public AST::StatementVisitor<bool> {
+public:
+    StatementEval(ConstantEval &eval, Frame &frame)
+        : eval(eval), frame(frame) {}
+
+    std::unique_ptr<Value> result;
+
+private:
+    bool operator()(const AST::ExpressionStatement &stmt) override {
+        eval.tick(stmt.pos());
+        value(stmt.expr());
+        return false;
+    }
+
+    bool operator()(const AST::Return &ret) override {
+        eval.tick(ret.pos());
+        result.reset(new Value(value(ret.retval())));
+        return true;
+    }
+
+    bool operator()(const AST::Become &become) override {
+        eval.tick(become.pos());
+        result.reset(new Value(value(become.call())));
+        return true;
+    }
+
+    bool operator()(const AST::VoidReturn &ret) override {
+        throw Error("error", "const functions must return a value",
+                    ret.pos());
+    }
+
+    bool operator()(const AST::Assignment &assignment) override {
+        eval.tick(assignment.pos());
+
+        auto *var = llvm::dyn_cast<AST::Variable>(&assignment.lhs());
+        if (!var) {
+            throw Error("error", "only local variables may be assigned in a "
+                                 "const function", assignment.pos());
+        }
+
+        auto val = value(assignment.rhs());
+
+        for (auto scope = frame.rbegin(); scope != frame.rend(); ++scope) {
+            auto found = scope->find(var->name());
+            if (found == scope->end()) {
+                continue;
+            }
+
+            if (!(found->second.get_type() == val.get_type())) {
+                throw Error("type error",
+                            "cannot assign to variable of different type",
+                            assignment.pos());
+            }
+            found->second = val;
+            return false;
+        }
+
+        throw Error("error", "variable \"" + var->name()
+                           + "\" is not a local variable", var->pos());
+    }
+
+    bool operator()(const AST::Declaration &decl) override {
+        eval.tick(decl.pos());
+        declare(decl.name().name(),
+                Value(nullptr, TypeGen(eval._translator).visit(decl.type())));
+        return false;
+    }
+
+    bool operator()(const AST::CompoundDeclaration &decl) override {
+        eval.tick(decl.pos());
+
+        auto ty = TypeGen(eval._translator).visit(decl.type());
+        auto val = value(decl.rhs());
+
+        if (!(ty == val.get_type())) {
+            throw Error("type error",
+                        "cannot assign to variable of different type",
+                        decl.pos());
+        }
+
+        declare(decl.name().name(), val);
+        return false;
+    }
+
+    bool operator()(const AST::IfStatement &if_stmt) override {
+        eval.tick(if_stmt.pos());
+
+        if (condition(if_stmt.condition())) {
+            return block(if_stmt.if_block());
+        }
+
+        return block(if_stmt.else_block());
+    }
+
+    bool operator()(const AST::WhileStatement &while_stmt) override {
+        while (true) {
+            eval.tick(while_stmt.pos());
+
+            if (!condition(while_stmt.condition())) {
+                return false;
+            }
+
+            if (block(while_stmt.body())) {
+                return true;
+            }
+        }
+    }
+
+    bool operator()(const AST::ForStatement &for_stmt) override {
+        // The loop variable is only visible inside the loop.
+        frame.emplace_back();
+
+        visit(for_stmt.init());
+
+        while (true) {
+            eval.tick(for_stmt.pos());
+
+            if (!condition(for_stmt.condition())) {
+                break;
+            }
+
+            if (block(for_stmt.body())) {
+                frame.pop_back();
+                return true;
+            }
+
+            visit(for_stmt.step());
+        }
+
+        frame.pop_back();
+        return false;
+    }
+
+    /**
+     * @brief Evaluate a block, whose declarations are only visible in it and
+     *        may shadow those outside.
+     */
+    bool block(const std::vector<std::unique_ptr<AST::Statement>> &stmts) {
+        frame.emplace_back();
+
+        for (const auto &stmt: stmts) {
+            if (visit(*stmt)) {
+                frame.pop_back();
+                return true;
+            }
+        }
+
+        frame.pop_back();
+        return false;
+    }
+
+    bool condition(const AST::Expression &cond) {
+        auto val = value(cond);
+
+        if (!(val.get_type() == Type(UnsignedInt(1)))) {
+            throw Error("type error", "condition must be a U1", cond.pos());
+        }
+
+        return !llvm::cast<llvm::ConstantInt>(val.to_llvm())->isZero();
+    }
+
+    void declare(const std::string &name, Value val) {
+        auto &scope = frame.back();
+        scope.erase(name);
+        scope.insert(std::make_pair(name, val));
+    }
+
+    Value value(const AST::Expression &expr) {
+        return ExpressionEval(eval, &frame).visit(expr);
+    }
+
+    ConstantEval &eval;
+    Frame &frame;
+};
+
+/*****************************************************************************
+ * Entry points.
+ */
+
+void ConstantEval::tick(SourcePos pos) {
+    if (++steps > MAX_STEPS) {
+        throw NotConstant("constant evaluation took too long", pos);
+    }
+}
+
+Value ConstantEval::eval(const AST::Expression &expr) {
+    return ExpressionEval(*this, nullptr).visit(expr);
+}
+
+uint64_t ConstantEval::eval_length(const AST::Expression &expr) {
+    auto val = eval(expr);
+    auto *c = llvm::dyn_cast<llvm::ConstantInt>(val.to_llvm());
+
+    if (!val.is_integral() || !c) {
+        throw Error("type error", "array length must be an integer constant",
+                    expr.pos());
+    }
+
+    if (c->isZero() || (is_type<SignedInt>(val.get_type())
+                        && c->isNegative())) {
+        throw Error("error", "array length must be positive", expr.pos());
+    }
+
+    return c->getZExtValue();
+}
+
+Value ConstantEval::eval_initializer(const AST::Expression &expr,
+                                     const Type &t) {
+    return convert(eval(expr), t, expr.pos());
+}
+
+/**
+ * @brief Get whether the given type is an integer or float type.
+ */
+static bool is_numeric(const Type &t) {
+    return is_type<SignedInt>(t) || is_type<UnsignedInt>(t)
+        || is_type<Float>(t);
+}
+
+Value ConstantEval::convert(Value val, const Type &t, SourcePos pos) {
+    if (val.get_type() == t) {
+        return val;
+    }
+
+    auto *arr_t = boost::get<Array<> >(&t);
+    auto *val_arr_t = boost::get<Array<> >(&val.get_type());
+
+    if (arr_t && val_arr_t && arr_t->get_length() == val_arr_t->get_length()) {
+        auto *i64 = llvm::Type::getInt64Ty(_translator.get_ctx());
+
+        std::vector<Value> elements;
+        for (uint64_t i = 0; i < arr_t->get_length(); ++i) {
+            Value idx(llvm::ConstantInt::get(i64, i), UnsignedInt(64));
+            elements.push_back(convert(_translator.index(val, idx, pos),
+                                       *arr_t->get_element(), pos));
+        }
+
+        return _translator.array_literal(elements, pos);
+    }
+
+    if (!is_numeric(t) || !is_numeric(val.get_type())) {
+        throw Error("type error", "initializer does not match type of global",
+                    pos);
+    }
+
+    auto result = _translator.cast(val, t, pos);
+
+    // Constants are uniqued, so a conversion is exact exactly when
+    // converting back gives the same constant.  This rejects integers out
+    // of range and floats which lose precision in a narrower type alike.
+    bool exact = _translator.cast(result, val.get_type(), pos).to_llvm()
+              == val.to_llvm();
+    if (!exact) {
+        throw Error("type error", "constant does not fit in type of global",
+                    pos);
+    }
+
+    return result;
+}
+
+Value ConstantEval::call(const AST::FunctionDefinition &fd,
+                         std::vector<Value> &args,
+                         SourcePos pos) {
+    const auto &sig = fd.signature();
+    TypeGen tg(_translator);
+
+    tick(pos);
+
+    if (args.size() != sig.args().size()) {
+        throw Error("error", "wrong number of arguments to function \""
+                           + sig.name() + "\"", pos);
+    }
+
+    Frame frame(1);
+    for (unsigned i = 0; i < args.size(); ++i) {
+        const auto &decl = *sig.args()[i];
+        if (!(args[i].get_type() == tg.visit(decl.type()))) {
+            throw Error("type error", "argument does not match function type",
+                        pos);
+        }
+        frame[0].insert(std::make_pair(decl.name().name(), args[i]));
+    }
+
+    if (++depth > MAX_DEPTH) {
+        throw NotConstant("constant evaluation recursed too deeply", pos);
+    }
+
+    StatementEval body(*this, frame);
+    for (const auto &stmt: fd.block()) {
+        if (body.visit(*stmt)) {
+            break;
+        }
+    }
+
+    --depth;
+
+    if (!body.result) {
+        throw Error("error", "const function \"" + sig.name()
+                           + "\" did not return a value", pos);
+    }
+
+    if (!(body.result->get_type() == tg.visit(sig.ret_type()))) {
+        throw Error("type error", "returned value does not match function "
+                                  "type", pos);
+    }
+
+    return *body.result;
+}
+
+}
+
+}
@@ -33,6 +33,14 @@ ModuleGen::ModuleGen(std::string name, std::string filename,
 
 ModuleGen::~ModuleGen() {}
 
+void ModuleGen::set_default_visibility(Visibility visibility) {
+    pimpl->set_default_visibility(visibility);
+}
+
+void ModuleGen::set_source_file(std::string filename) {
+    pimpl->set_source_file(filename);
+}
+
 void ModuleGen::codegen(const AST::Toplevel &t) { pimpl->visit(t); }
 
 void ModuleGen::emit_ir(std::ostream &out) {
@@ -47,13 +55,33 @@ void ModuleGen::emit_asm(int fd) {
     pimpl->emit_asm(fd);
 }
 
+void ModuleGen::emit_bc(int fd, bool thin_lto) {
+    pimpl->emit_bc(fd, thin_lto);
+}
+
 void ModuleGen::validate(std::ostream &out) {
     pimpl->validate(out);
 }
 
+void ModuleGen::internalize(const std::vector<std::string> &exports) {
+    pimpl->internalize(exports);
+}
+
+void ModuleGen::instrument_profile(const std::string &out_file) {
+    pimpl->instrument_profile(out_file);
+}
+
+void ModuleGen::use_profile(const std::string &profile) {
+    pimpl->use_profile(profile);
+}
+
 void ModuleGen::optimize(int level) {
     pimpl->optimize(level);
 }
 
+void ModuleGen::write_template_report(std::ostream &out) {
+    pimpl->write_template_report(out);
+}
+
 }
 }
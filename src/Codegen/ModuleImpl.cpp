@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <map>
 
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -32,9 +33,11 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Target/TargetOptions.h"
 
+#include "Codegen/Constant.hh"
 #include "Codegen/ModuleImpl.hh"
 #include "Codegen/Type.hh"
 #include "Codegen/Statement.hh"
+#include "VariantUtils.hh"
 
 namespace Craeft {
 
@@ -42,7 +45,16 @@ namespace Codegen {
 
 ModuleGenImpl::ModuleGenImpl(std::string name, std::string triple,
                                      std::string fname)
-    : _translator(name, fname, triple) {
+    : _translator(name, fname, triple),
+      default_visibility(Visibility::DEFAULT) {
+}
+
+void ModuleGenImpl::set_default_visibility(Visibility visibility) {
+    default_visibility = visibility;
+}
+
+void ModuleGenImpl::set_source_file(std::string filename) {
+    _translator.set_source_file(filename);
 }
 
 void ModuleGenImpl::emit_ir(std::ostream &out) {
@@ -57,6 +69,10 @@ void ModuleGenImpl::emit_obj(int fd) {
     _translator.emit_obj(fd);
 }
 
+void ModuleGenImpl::emit_bc(int fd, bool thin_lto) {
+    _translator.emit_bc(fd, thin_lto);
+}
+
 void ModuleGenImpl::operator()(const AST::TypeDeclaration &td) {
     throw Error("error", "type declarations not implemented", td.pos());
 }
@@ -108,15 +124,71 @@ Function<> ModuleGenImpl::type_of_ast_decl(
     return Function<>(ret_type, arg_types);
 }
 
+FunctionAttributes ModuleGenImpl::get_function_attributes(
+        const AST::FunctionDeclaration &fd, bool is_definition,
+        bool is_specialization) {
+    FunctionAttributes result;
+
+    // `main` is always called from outside.
+    result.is_public = fd.is_public() || fd.name() == "main";
+    result.is_specialization = is_specialization;
+
+    // Declarations refer to functions defined elsewhere, which keep their
+    // own visibility unless told otherwise.
+    if (is_definition && (result.is_public || is_specialization)) {
+        result.visibility = default_visibility;
+    }
+
+    static const std::map<std::string, Visibility> visibilities {
+        {"default", Visibility::DEFAULT},
+        {"hidden", Visibility::HIDDEN},
+        {"protected", Visibility::PROTECTED},
+    };
+
+    for (const auto &attr: fd.attributes()) {
+        if (attr.name == "cold" && attr.args.empty()) {
+            result.cold = true;
+        } else if (attr.name == "erased" && attr.args.empty()) {
+            // Used when the template is registered.
+            if (!is_specialization) {
+                throw Error("error", "\"erased\" given for a function "
+                                     "which is not a template", attr.pos);
+            }
+        } else if (attr.name == "visibility") {
+            if (is_definition && !result.is_public && !is_specialization) {
+                throw Error("error", "\"visibility\" given for a function "
+                                     "which is not pub", attr.pos);
+            }
+
+            auto v = attr.args.size() == 1 ? visibilities.find(attr.args[0])
+                                           : visibilities.end();
+            if (v == visibilities.end()) {
+                throw Error("error", "expected one of default, hidden or "
+                                     "protected in \"visibility\"",
+                            attr.pos);
+            }
+
+            result.visibility = v->second;
+        } else {
+            throw Error("error", "unknown function attribute \"" + attr.name
+                               + "\"", attr.pos);
+        }
+    }
+
+    return result;
+}
+
 void ModuleGenImpl::operator()(const AST::FunctionDeclaration &fd) {
     auto ty = type_of_ast_decl(fd);
-    _translator.create_function_prototype(ty, fd.name());
+    _translator.create_function_prototype(ty, fd.name(),
+                                          get_function_attributes(fd, false),
+                                          fd.pos());
 }
 
 std::vector< std::pair< std::vector<Type>, TemplateValue> >
 ModuleGenImpl::codegen_function_with_name(
         const AST::FunctionDefinition &fd,
-        std::string name) {
+        std::string name, const TemplateValue *specialization) {
     auto ty = type_of_ast_decl(fd.signature());
 
     std::vector<std::string> arg_names;
@@ -125,7 +197,16 @@ ModuleGenImpl::codegen_function_with_name(
         arg_names.push_back(decl->name().name());
     }
 
-    _translator.create_and_start_function(ty, arg_names, name);
+    auto attrs = get_function_attributes(fd.signature(), true,
+                                         specialization != nullptr);
+
+    if (specialization && specialization->erased) {
+        attrs.erased_parameters = specialization->arg_names;
+    }
+
+    _translator.create_and_start_function(ty, arg_names, name,
+                                          find_address_taken(fd.block()),
+                                          attrs, fd.pos());
 
     for (const auto &arg: fd.block()) {
         StatementGen(_translator).visit(*arg);
@@ -135,6 +216,18 @@ ModuleGenImpl::codegen_function_with_name(
 }
 
 void ModuleGenImpl::operator()(const AST::FunctionDefinition &fd) {
+    if (fd.is_const()) {
+        // Only scalars can be produced at compile time.
+        auto ret = *type_of_ast_decl(fd.signature()).get_rettype();
+        if (!is_type<SignedInt>(ret) && !is_type<UnsignedInt>(ret)
+         && !is_type<Float>(ret)) {
+            throw Error("type error", "const functions must return an "
+                                      "integer or float", fd.pos());
+        }
+
+        _translator.register_const_function(fd.signature().name(), &fd);
+    }
+
     auto specializations = codegen_function_with_name(fd,
                                                       fd.signature().name());
 
@@ -151,10 +244,13 @@ void ModuleGenImpl::operator()(const AST::FunctionDefinition &fd) {
             _translator.bind_type(val.arg_names[j], args[j]);
         }
 
-        auto name = mangle_name(val.fd->signature().name(), args);
+        // An erased template is compiled once, with its parameters bound to
+        // erased types.
+        auto name = _translator.specialization_name(val, args);
 
         // Add any specializations added in codegen for *this* specialization.
-        auto new_specializations = codegen_function_with_name(*val.fd, name);
+        auto new_specializations = codegen_function_with_name(*val.fd, name,
+                                                              &val);
 
         for (const auto &specialization: new_specializations) {
             specializations.push_back(specialization);
@@ -164,6 +260,66 @@ void ModuleGenImpl::operator()(const AST::FunctionDefinition &fd) {
     }
 }
 
+/**
+ * @brief Get the TLS model of a global from its attributes.
+ */
+static TLSModel get_tls_model(const AST::GlobalDeclaration &g) {
+    auto result = g.is_thread_local() ? TLSModel::GENERAL_DYNAMIC
+                                      : TLSModel::NONE;
+
+    static const std::map<std::string, TLSModel> models {
+        {"general_dynamic", TLSModel::GENERAL_DYNAMIC},
+        {"local_dynamic", TLSModel::LOCAL_DYNAMIC},
+        {"initial_exec", TLSModel::INITIAL_EXEC},
+        {"local_exec", TLSModel::LOCAL_EXEC},
+    };
+
+    for (const auto &attr: g.attributes()) {
+        if (attr.name != "tls_model") {
+            throw Error("error", "unknown global attribute \"" + attr.name
+                               + "\"", attr.pos);
+        }
+
+        if (!g.is_thread_local()) {
+            throw Error("error", "\"tls_model\" given for a global which is "
+                                 "not thread_local", attr.pos);
+        }
+
+        auto model = attr.args.size() == 1 ? models.find(attr.args[0])
+                                           : models.end();
+        if (model == models.end()) {
+            throw Error("error", "expected one of general_dynamic, "
+                                 "local_dynamic, initial_exec or local_exec "
+                                 "in \"tls_model\"", attr.pos);
+        }
+
+        result = model->second;
+    }
+
+    return result;
+}
+
+void ModuleGenImpl::operator()(const AST::GlobalDeclaration &g) {
+    auto t = TypeGen(_translator).visit(g.type());
+
+    GlobalAttributes attrs;
+    attrs.is_public = g.is_public();
+    attrs.visibility = default_visibility;
+    attrs.tls = get_tls_model(g);
+
+    if (!g.init()) {
+        _translator.create_global(g.name(), t, nullptr, g.is_const(), attrs,
+                                  g.pos());
+        return;
+    }
+
+    // Initializers are computed at compile time, so that globals are
+    // emitted as static data.
+    auto init = ConstantEval(_translator).eval_initializer(*g.init(), t);
+    _translator.create_global(g.name(), t, &init, g.is_const(), attrs,
+                              g.pos());
+}
+
 void ModuleGenImpl::operator()(const AST::TemplateFunctionDefinition &f) {
     auto name = f.def()->signature().name();
 
@@ -180,14 +336,41 @@ void ModuleGenImpl::operator()(const AST::TemplateFunctionDefinition &f) {
 
     auto t = Function<TemplateType>(ret_type, arg_types);
 
+    bool erased = false;
+    for (const auto &attr: f.def()->signature().attributes()) {
+        if (attr.name == "erased") {
+            if (!attr.args.empty()) {
+                throw Error("error", "\"erased\" takes no arguments",
+                            attr.pos);
+            }
+            erased = true;
+        }
+    }
+
     _translator.register_template(name, f.def(), f.argnames(),
-                                 TemplateFunction(t, f.argnames()));
+                                 TemplateFunction(t, f.argnames()), erased);
+}
+
+void ModuleGenImpl::internalize(const std::vector<std::string> &exports) {
+    _translator.internalize(exports);
+}
+
+void ModuleGenImpl::instrument_profile(const std::string &out_file) {
+    _translator.instrument_profile(out_file);
+}
+
+void ModuleGenImpl::use_profile(const std::string &profile) {
+    _translator.use_profile(profile);
 }
 
 void ModuleGenImpl::optimize(int opt_level) {
     _translator.optimize(opt_level);
 }
 
+void ModuleGenImpl::write_template_report(std::ostream &out) {
+    _translator.write_template_report(out);
+}
+
 void ModuleGenImpl::validate(std::ostream &out) {
     _translator.validate(out);
 }
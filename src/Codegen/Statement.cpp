@@ -20,6 +20,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cctype>
+
 #include "Codegen/Statement.hh"
 #include "Codegen/Value.hh"
 #include "Codegen/Type.hh"
@@ -28,13 +30,199 @@ namespace Craeft {
 
 namespace Codegen {
 
+namespace {
+
+/**
+ * @brief Get the variable whose storage the given l-value refers to, if any.
+ */
+const AST::Variable *storage_of(const AST::Expression &expr) {
+    if (auto *var = llvm::dyn_cast<AST::Variable>(&expr)) {
+        return var;
+    } else if (auto *fa = llvm::dyn_cast<AST::FieldAccess>(&expr)) {
+        return storage_of(fa->structure());
+    } else if (auto *index = llvm::dyn_cast<AST::Index>(&expr)) {
+        return storage_of(index->array());
+    }
+
+    // Dereferences refer to storage through a value.
+    return nullptr;
+}
+
+/**
+ * @brief Collect the variables which are used as memory: those referenced
+ *        and those whose fields or elements are addressed in place.
+ */
+class AddressTakenFinder: public AST::StatementVisitor<void>,
+                          public AST::ExpressionVisitor<void> {
+public:
+    AddressTakenFinder(std::set<std::string> &names): names(names) {}
+
+    void visit_body(const std::vector<std::unique_ptr<AST::Statement>> &b) {
+        for (const auto &stmt: b) {
+            AST::StatementVisitor<void>::visit(*stmt);
+        }
+    }
+
+private:
+    void expr(const AST::Expression &e) {
+        AST::ExpressionVisitor<void>::visit(e);
+    }
+
+    void add_storage(const AST::Expression &e) {
+        if (auto *var = storage_of(e)) {
+            names.insert(var->name());
+        }
+    }
+
+    void operator()(const AST::ExpressionStatement &stmt) {
+        expr(stmt.expr());
+    }
+
+    void operator()(const AST::Return &ret) { expr(ret.retval()); }
+    void operator()(const AST::VoidReturn &) {}
+    void operator()(const AST::Become &become) { expr(become.call()); }
+
+    void operator()(const AST::Assignment &assignment) {
+        // Plain assignments to variables are writes to registers.
+        if (!llvm::isa<AST::Variable>(assignment.lhs())) {
+            add_storage(assignment.lhs());
+        }
+
+        expr(assignment.lhs());
+        expr(assignment.rhs());
+    }
+
+    void operator()(const AST::Declaration &) {}
+
+    void operator()(const AST::CompoundDeclaration &decl) {
+        expr(decl.rhs());
+    }
+
+    void operator()(const AST::IfStatement &if_stmt) {
+        expr(if_stmt.condition());
+        visit_body(if_stmt.if_block());
+        visit_body(if_stmt.else_block());
+    }
+
+    void operator()(const AST::WhileStatement &while_stmt) {
+        expr(while_stmt.condition());
+        visit_body(while_stmt.body());
+    }
+
+    void operator()(const AST::ForStatement &for_stmt) {
+        AST::StatementVisitor<void>::visit(for_stmt.init());
+        expr(for_stmt.condition());
+        AST::StatementVisitor<void>::visit(for_stmt.step());
+        visit_body(for_stmt.body());
+    }
+
+    void operator()(const AST::IntLiteral &) {}
+    void operator()(const AST::UIntLiteral &) {}
+    void operator()(const AST::FloatLiteral &) {}
+    void operator()(const AST::StringLiteral &) {}
+    void operator()(const AST::Variable &) {}
+
+    void operator()(const AST::Reference &ref) {
+        add_storage(ref.referand());
+        expr(ref.referand());
+    }
+
+    void operator()(const AST::Dereference &deref) { expr(deref.referand()); }
+
+    void operator()(const AST::FieldAccess &fa) { expr(fa.structure()); }
+
+    void operator()(const AST::Index &index) {
+        // Arrays in variables are indexed in place.
+        add_storage(index.array());
+        expr(index.array());
+        expr(index.index());
+    }
+
+    void operator()(const AST::Binop &binop) {
+        expr(binop.lhs());
+        expr(binop.rhs());
+    }
+
+    void operator()(const AST::FunctionCall &call) {
+        for (const auto &arg: call.args()) expr(*arg);
+    }
+
+    void operator()(const AST::TemplateFunctionCall &call) {
+        for (const auto &arg: call.value_args()) expr(*arg);
+    }
+
+    void operator()(const AST::Cast &cast) { expr(cast.arg()); }
+
+    void operator()(const AST::ArrayLiteral &lit) {
+        for (const auto &elem: lit.elements()) expr(*elem);
+    }
+
+    std::set<std::string> &names;
+};
+
+}
+
+std::set<std::string> find_address_taken(
+        const std::vector<std::unique_ptr<AST::Statement>> &body) {
+    std::set<std::string> result;
+    AddressTakenFinder(result).visit_body(body);
+    return result;
+}
+
+/**
+ * @brief Get the single positive integer argument of an attribute, if any.
+ *
+ * @return The argument, or 0 if the attribute has none.
+ */
+static unsigned get_count_arg(const AST::Attribute &attr) {
+    if (attr.args.empty()) return 0;
+
+    const auto &arg = attr.args[0];
+    bool numeric = !arg.empty() && arg.size() < 10;
+    for (char c: arg) numeric = numeric && isdigit(c);
+
+    if (attr.args.size() > 1 || !numeric || std::stoul(arg) == 0) {
+        throw Error("error", "attribute \"" + attr.name + "\" takes a "
+                             "single positive integer", attr.pos);
+    }
+
+    return std::stoul(arg);
+}
+
+/**
+ * @brief Translate the attributes on a loop to hints for the translator.
+ */
+static LoopHints get_loop_hints(const std::vector<AST::Attribute> &attrs) {
+    LoopHints result;
+
+    for (const auto &attr: attrs) {
+        if (attr.name == "unroll") {
+            result.unroll = true;
+            result.unroll_count = get_count_arg(attr);
+        } else if (attr.name == "vectorize") {
+            result.vectorize = true;
+            result.vectorize_width = get_count_arg(attr);
+        } else {
+            throw Error("error", "unknown loop attribute \"" + attr.name
+                               + "\"", attr.pos);
+        }
+    }
+
+    return result;
+}
+
 void StatementGen::operator()(const AST::ExpressionStatement &expr) {
     ValueGen vg(_translator);
     vg.visit(expr.expr());
 }
 
 void StatementGen::operator()(const AST::Assignment &assignment) {
-    LValueGen lc(_translator);
+    // Variables may be held in registers, and have no address.
+    if (auto *var = llvm::dyn_cast<AST::Variable>(&assignment.lhs())) {
+        auto rhs = ValueGen(_translator).visit(assignment.rhs());
+        _translator.assign(var->name(), rhs, assignment.pos());
+        return;
+    }
 
     auto addr = LValueGen(_translator).visit(assignment.lhs());
     auto rhs  = ValueGen(_translator).visit(assignment.rhs());
@@ -51,18 +239,55 @@ void StatementGen::operator()(const AST::VoidReturn &ret) {
     _translator.return_(ret.pos());
 }
 
+void StatementGen::operator()(const AST::Become &become) {
+    ValueGen vg(_translator);
+
+    if (auto *call = llvm::dyn_cast<AST::FunctionCall>(&become.call())) {
+        std::vector<Value> args;
+        for (const auto &arg: call->args()) {
+            args.push_back(vg.visit(*arg));
+        }
+
+        _translator.become(call->fname(), args, become.pos());
+        return;
+    }
+
+    const auto &call = llvm::cast<AST::TemplateFunctionCall>(become.call());
+
+    std::vector<Type> tmpl_args;
+    for (const auto &arg: call.type_args()) {
+        tmpl_args.push_back(TypeGen(_translator).visit(*arg));
+    }
+
+    std::vector<Value> args;
+    for (const auto &arg: call.value_args()) {
+        args.push_back(vg.visit(*arg));
+    }
+
+    _translator.become(call.fname(), tmpl_args, args, become.pos());
+}
+
+/* Raise an error if a local variable cannot have the given type. */
+static void check_local_type(const Type &t, SourcePos pos) {
+    if (has_erased_layout(t)) {
+        throw Error("type error", "cannot declare variable whose size is "
+                                  "only known at run time", pos);
+    }
+}
+
 void StatementGen::operator()(const AST::Declaration &decl) {
     auto t = TypeGen(_translator).visit(decl.type());
+    check_local_type(t, decl.pos());
     _translator.declare(decl.name().name(), t);
 }
 
 void StatementGen::operator()(const AST::CompoundDeclaration &cdecl) {
     std::string name = cdecl.name().name();
     auto t = TypeGen(_translator).visit(cdecl.type());
-    Variable result = _translator.declare(name, t);
-    _translator.add_store(result.get_val(),
-                          ValueGen(_translator).visit(cdecl.rhs()),
-                          cdecl.pos());
+    check_local_type(t, cdecl.pos());
+    _translator.declare(name, t);
+    _translator.assign(name, ValueGen(_translator).visit(cdecl.rhs()),
+                       cdecl.pos());
 }
 
 void StatementGen::operator()(const AST::IfStatement &if_stmt) {
@@ -85,5 +310,45 @@ void StatementGen::operator()(const AST::IfStatement &if_stmt) {
     _translator.end_ifthenelse(std::move(structure));
 }
 
+void StatementGen::operator()(const AST::WhileStatement &while_stmt) {
+    loop(while_stmt.attributes(), while_stmt.condition(), while_stmt.body(),
+         nullptr, while_stmt.pos());
+}
+
+void StatementGen::operator()(const AST::ForStatement &for_stmt) {
+    // The loop variable is only visible inside the loop.
+    _translator.push_scope();
+
+    visit(for_stmt.init());
+
+    loop(for_stmt.attributes(), for_stmt.condition(), for_stmt.body(),
+         &for_stmt.step(), for_stmt.pos());
+
+    _translator.pop_scope();
+}
+
+void StatementGen::loop(
+        const std::vector<AST::Attribute> &attributes,
+        const AST::Expression &condition,
+        const std::vector<std::unique_ptr<AST::Statement>> &body,
+        const AST::Statement *step, SourcePos pos) {
+    auto structure = _translator.create_loop(get_loop_hints(attributes), pos);
+
+    // The condition is re-evaluated at the top of every iteration.
+    auto cond = ValueGen(_translator).visit(condition);
+    _translator.loop_condition(structure, cond, pos);
+
+    for (const auto &stmt: body) {
+        visit(*stmt);
+    }
+
+    // A body which always returns or becomes never reaches the step.
+    if (step && !_translator.is_terminated()) {
+        visit(*step);
+    }
+
+    _translator.end_loop(std::move(structure));
+}
+
 }
 }
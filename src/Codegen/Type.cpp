@@ -20,7 +20,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "Codegen/Constant.hh"
 #include "Codegen/Type.hh"
+#include "VariantUtils.hh"
 
 namespace Craeft {
 
@@ -49,6 +51,28 @@ Type TypeGen::operator()(const AST::TemplatedType &t) {
     return translator.specialize_template(t.name(), args, t.pos());
 }
 
+Type TypeGen::operator()(const AST::Vector &vt) {
+    auto element = visit(vt.element());
+
+    if (!is_type<SignedInt>(element) && !is_type<UnsignedInt>(element)
+     && !is_type<Float>(element)) {
+        throw Error("type error", "vector elements must be integers or "
+                                  "floats", vt.pos());
+    }
+
+    return Vector<>(element, vt.length());
+}
+
+Type TypeGen::operator()(const AST::Array &at) {
+    auto element = visit(at.element());
+
+    if (is_type<Void>(element) || is_type<Function<> >(element)) {
+        throw Error("type error", "invalid array element type", at.pos());
+    }
+
+    return Array<>(element, ConstantEval(translator).eval_length(at.length()));
+}
+
 /*****************************************************************************
  * Code generation for template types.
  */
@@ -81,5 +105,14 @@ TemplateType TemplateTypeGen::operator()(const AST::TemplatedType &t) {
     return translator.respecialize_template(t.name(), args, t.pos());
 }
 
+TemplateType TemplateTypeGen::operator()(const AST::Vector &vt) {
+    return Vector<TemplateType>(visit(vt.element()), vt.length());
+}
+
+TemplateType TemplateTypeGen::operator()(const AST::Array &at) {
+    auto length = ConstantEval(translator).eval_length(at.length());
+    return Array<TemplateType>(visit(at.element()), length);
+}
+
 }
 }
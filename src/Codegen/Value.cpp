@@ -20,6 +20,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
+#include "Codegen/Constant.hh"
 #include "Codegen/Type.hh"
 #include "Codegen/Value.hh"
 
@@ -47,6 +50,17 @@ Value LValueGen::operator()(const AST::FieldAccess &fa) {
                 fa.pos());
 }
 
+Value LValueGen::operator()(const AST::Index &index) {
+    if (auto *array = llvm::dyn_cast<AST::LValue>(&index.array())) {
+        auto idx = ValueGen(_translator).visit(index.index());
+        return _translator.index_address(visit(*array), idx, index.pos());
+    }
+
+    throw Error("parser error",
+                "expected lvalue array in lvalue index",
+                index.pos());
+}
+
 Value ValueGen::operator()(const AST::IntLiteral &lit) {
     SignedInt type(64);
     auto *llvm_type = type.to_llvm(_ctx);
@@ -81,6 +95,19 @@ Value ValueGen::operator()(const AST::FieldAccess &access) {
     return _translator.field_access(lhs, access.field(), access.pos());
 }
 
+Value ValueGen::operator()(const AST::Index &index) {
+    /* Index arrays in memory in place, rather than loading the whole array. */
+    if (llvm::isa<AST::LValue>(index.array())) {
+        return _translator.add_load(LValueGen(_translator).visit(index),
+                                    index.pos());
+    }
+
+    auto array = visit(index.array());
+    auto idx = visit(index.index());
+
+    return _translator.index(array, idx, index.pos());
+}
+
 Value ValueGen::operator()(const AST::Reference &ref) {
     /* LValue codegenerators return addresses to the l-value, so just use one
      * of those to codegen the referand. */
@@ -91,53 +118,66 @@ Value ValueGen::operator()(const AST::Variable &var) {
     return _translator.get_identifier_value(var.name(), var.pos());
 }
 
-Value ValueGen::operator()(const AST::Binop &binop) {
-    auto lhs = visit(binop.lhs());
-    auto rhs = visit(binop.rhs());
-
-    auto pos = binop.pos();
-
-    if (binop.op() == "<<") {
-        return _translator.left_shift(lhs, rhs, pos);
-    } else if (binop.op() == ">>") {
-        return _translator.right_shift(lhs, rhs, pos);
-    } else if (binop.op() == "&") {
-        return _translator.bit_and(lhs, rhs, pos);
-    } else if (binop.op() == "|") {
-        return _translator.bit_or(lhs, rhs, pos);
-    } else if (binop.op() == "^") {
-        return _translator.bit_xor(lhs, rhs, pos);
-    } else if (binop.op() == "+") {
-        return _translator.add(lhs, rhs, pos);
-    } else if (binop.op() == "-") {
-        return _translator.sub(lhs, rhs, pos);
-    } else if (binop.op() == "*") {
-        return _translator.mul(lhs, rhs, pos);
-    } else if (binop.op() == "/") {
-        return _translator.div(lhs, rhs, pos);
-    } else if (binop.op() == "==") {
-        return _translator.equal(lhs, rhs, pos);
-    } else if (binop.op() == "!=") {
-        return _translator.nequal(lhs, rhs, pos);
-    } else if (binop.op() == "<") {
-        return _translator.less(lhs, rhs, pos);
-    } else if (binop.op() == "<=") {
-        return _translator.lesseq(lhs, rhs, pos);
-    } else if (binop.op() == ">") {
-        return _translator.greater(lhs, rhs, pos);
-    } else if (binop.op() == ">=") {
-        return _translator.greatereq(lhs, rhs, pos);
-    } else if (binop.op() == "&&") {
-        return _translator.bool_and(lhs, rhs, pos);
-    } else if (binop.op() == "||") {
-        return _translator.bool_or(lhs, rhs, pos);
+Value apply_binop(Translator &translator, const std::string &op,
+                  Value lhs, Value rhs, SourcePos pos) {
+    if (op == "<<") {
+        return translator.left_shift(lhs, rhs, pos);
+    } else if (op == ">>") {
+        return translator.right_shift(lhs, rhs, pos);
+    } else if (op == "&") {
+        return translator.bit_and(lhs, rhs, pos);
+    } else if (op == "|") {
+        return translator.bit_or(lhs, rhs, pos);
+    } else if (op == "^") {
+        return translator.bit_xor(lhs, rhs, pos);
+    } else if (op == "+") {
+        return translator.add(lhs, rhs, pos);
+    } else if (op == "-") {
+        return translator.sub(lhs, rhs, pos);
+    } else if (op == "*") {
+        return translator.mul(lhs, rhs, pos);
+    } else if (op == "/") {
+        return translator.div(lhs, rhs, pos);
+    } else if (op == "==") {
+        return translator.equal(lhs, rhs, pos);
+    } else if (op == "!=") {
+        return translator.nequal(lhs, rhs, pos);
+    } else if (op == "<") {
+        return translator.less(lhs, rhs, pos);
+    } else if (op == "<=") {
+        return translator.lesseq(lhs, rhs, pos);
+    } else if (op == ">") {
+        return translator.greater(lhs, rhs, pos);
+    } else if (op == ">=") {
+        return translator.greatereq(lhs, rhs, pos);
+    } else if (op == "&&") {
+        return translator.bool_and(lhs, rhs, pos);
+    } else if (op == "||") {
+        return translator.bool_or(lhs, rhs, pos);
     } else {
-        throw Error("internal error", "unrecognized operator \"" + binop.op()
+        throw Error("internal error", "unrecognized operator \"" + op
                                                                  + "\"", pos);
                     
     }
 }
 
+Value ValueGen::operator()(const AST::Binop &binop) {
+    auto lhs = visit(binop.lhs());
+
+    /* The right-hand side of `&&` and `||` is only evaluated if needed. */
+    if (binop.op() == "&&" || binop.op() == "||") {
+        auto structure = _translator.create_short_circuit(
+                lhs, binop.op() == "&&", binop.pos());
+        auto rhs = visit(binop.rhs());
+        return _translator.end_short_circuit(std::move(structure), rhs,
+                                             binop.pos());
+    }
+
+    auto rhs = visit(binop.rhs());
+
+    return apply_binop(_translator, binop.op(), lhs, rhs, binop.pos());
+}
+
 Value ValueGen::operator()(const AST::FunctionCall &call) {
     std::vector<Value> args;
 
@@ -145,6 +185,22 @@ Value ValueGen::operator()(const AST::FunctionCall &call) {
         args.push_back(visit(*arg));
     }
 
+    /* Calls to `const fn`s with constant arguments are evaluated now if
+     * they can be.  A constant is not needed here, so a call which cannot be
+     * evaluated is left to run, and remembered so that later calls with the
+     * same arguments are not tried again; constant contexts like array
+     * lengths go through the ConstantEval, which reports the failure
+     * instead. */
+    auto *def = _translator.lookup_const_function(call.fname());
+    if (def && std::all_of(args.begin(), args.end(), is_constant)
+            && !_translator.known_not_constant(def, args)) {
+        try {
+            return ConstantEval(_translator).call(*def, args, call.pos());
+        } catch (NotConstant &) {
+            _translator.mark_not_constant(def, args);
+        }
+    }
+
     return _translator.call(call.fname(), args, call.pos());
 }
 
@@ -157,6 +213,24 @@ Value ValueGen::operator()(const AST::TemplateFunctionCall &call) {
         tmpl_args.push_back(tg.visit(*arg));
     }
 
+    /* The builtin `offsetof<:T:>(field)` takes a field name, not a value.
+     * Like other builtins, it is hidden by a template of the same name. */
+    if (call.fname() == "offsetof"
+     && !_translator.is_template_function(call.fname())) {
+        const auto &args = call.value_args();
+        const AST::Variable *field = nullptr;
+        if (args.size() == 1) {
+            field = llvm::dyn_cast<AST::Variable>(args[0].get());
+        }
+
+        if (tmpl_args.size() != 1 || !field) {
+            throw Error("error", "expected a type and a field name in "
+                                 "\"offsetof\"", call.pos());
+        }
+
+        return _translator.offset_of(tmpl_args[0], field->name(), call.pos());
+    }
+
     std::vector<Value> args;
 
     for (const auto &arg: call.value_args()) {
@@ -174,5 +248,15 @@ Value ValueGen::operator()(const AST::Cast &cast) {
     return _translator.cast(cast_val, dest_ty, cast.pos());
 }
 
+Value ValueGen::operator()(const AST::ArrayLiteral &arr) {
+    std::vector<Value> elements;
+
+    for (const auto &elem: arr.elements()) {
+        elements.push_back(visit(*elem));
+    }
+
+    return _translator.array_literal(elements, arr.pos());
+}
+
 }
 }
@@ -53,6 +53,8 @@ void Environment::pop(void) {
     type_map.pop();
     template_map.pop();
     templatefunc_map.pop();
+    constfunc_map.pop();
+    locals.pop_back();
 }
 
 void Environment::push(void) {
@@ -60,6 +62,8 @@ void Environment::push(void) {
     type_map.push();
     template_map.push();
     templatefunc_map.push();
+    constfunc_map.push();
+    locals.push_back(std::vector<llvm::AllocaInst *>());
 }
 
 bool Environment::bound(const std::string &name) const {
@@ -72,6 +76,10 @@ bool Environment::bound(const std::string &name) const {
     return false;
 }
 
+bool Environment::template_func_bound(const std::string &name) const {
+    return templatefunc_map.present(name);
+}
+
 Variable Environment::lookup_identifier(const std::string &name,
                                         SourcePos pos) const {
     assert(!isupper(name[0]));
@@ -83,10 +91,9 @@ Variable Environment::lookup_identifier(const std::string &name,
     }
 }
 
-Variable Environment::add_identifier(std::string name, Value val) {
-    Variable result(val);
-    ident_map.bind(name, result);
-    return result;
+Variable Environment::add_identifier(std::string name, Variable var) {
+    ident_map.bind(name, var);
+    return var;
 }
 
 void Environment::add_type(std::string name, Type t) {
@@ -128,4 +135,13 @@ const TemplateValue &Environment::lookup_template_func(
                                 + "\" not found", pos);
     }
 }
+
+const AST::FunctionDefinition *Environment::lookup_const_func(
+        const std::string &func_name) const {
+    if (!constfunc_map.present(func_name)) {
+        return nullptr;
+    }
+
+    return constfunc_map[func_name];
+}
 }
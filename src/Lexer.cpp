@@ -49,10 +49,29 @@ Lexer::Lexer(const std::string &fname)
       eof(false),
       tok(std::make_unique<Tok::OpenParen>()),
       pos(0, 0, std::make_shared<std::string>(fname)),
-      stream(fname) {
+      stream(fname),
+      offset(0) {
     shift();
 }
 
+Lexer::Lexer(const std::string &fname, const Mark &mark)
+    : c(' '),
+      eof(false),
+      tok(std::make_unique<Tok::OpenParen>()),
+      pos(mark.pos),
+      stream(fname),
+      offset(mark.offset) {
+    stream.seekg(mark.offset);
+    /* The mark's position already accounts for this first character. */
+    c = stream.get();
+    offset++;
+    shift();
+}
+
+Lexer::Mark Lexer::get_mark(void) const {
+    return Mark { tok_offset, SourcePos(tok_charno, tok_lineno, pos.fname) };
+}
+
 SourcePos Lexer::get_pos(void) const {
     return pos;
 }
@@ -63,7 +82,7 @@ static inline uint8_t digit(char n) {
 }
 
 static inline bool is_opchar(char c) {
-    return std::string("!:.*=+-><&%^@~/").find(c) != std::string::npos;
+    return std::string("!:.*=+-><&|%^@~/").find(c) != std::string::npos;
 }
 
 boost::variant<double, uint64_t> Lexer::lex_number(void) {
@@ -196,6 +215,10 @@ void Lexer::shift(void) {
         return;
     }
 
+    tok_offset = offset - 1;
+    tok_charno = pos.charno;
+    tok_lineno = pos.lineno;
+
     /* Type name. */
     if (isupper(c)) {
         std::string tname;
@@ -230,6 +253,16 @@ void Lexer::shift(void) {
                 tok = std::make_unique<Tok::Else>();
         } else if (ident == "while") {
             tok = std::make_unique<Tok::While>();
+        } else if (ident == "for") {
+            tok = std::make_unique<Tok::For>();
+        } else if (ident == "const") {
+            tok = std::make_unique<Tok::Const>();
+        } else if (ident == "become") {
+            tok = std::make_unique<Tok::Become>();
+        } else if (ident == "thread_local") {
+            tok = std::make_unique<Tok::ThreadLocal>();
+        } else if (ident == "pub") {
+            tok = std::make_unique<Tok::Pub>();
         /* If none of those, an identifier. */
         } else {
             tok = std::make_unique<Tok::Identifier>(ident);
@@ -267,6 +300,15 @@ void Lexer::shift(void) {
     } else if (c == '}') {
         tok = std::make_unique<Tok::CloseBrace>();
         get();
+    } else if (c == '[') {
+        tok = std::make_unique<Tok::OpenBracket>();
+        get();
+    } else if (c == ']') {
+        tok = std::make_unique<Tok::CloseBracket>();
+        get();
+    } else if (c == '#') {
+        tok = std::make_unique<Tok::Hash>();
+        get();
     } else if (c == ';') {
         tok = std::make_unique<Tok::Semicolon>();
         get();
@@ -287,6 +329,7 @@ const Tok::Token &Lexer::get_tok(void) const {
 
 void Lexer::get(void) {
     c = stream.get();
+    offset++;
 
     if (c == '\n' || c == '\r') {
         pos.lineno++;
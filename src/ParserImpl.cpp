@@ -88,6 +88,11 @@ private:
     }
 
     /* For other nodes, just visit their children. */
+    void operator()(const AST::Index &index) override {
+        visit(index.array());
+        visit(index.index());
+    }
+
     void operator()(const AST::FunctionCall &fc) override {
         std::for_each(fc.args().begin(), fc.args().end(),
                       [this](const auto &arg) { visit(*arg); });
@@ -102,6 +107,11 @@ private:
     void operator()(const AST::Cast &cast) override {
         visit(cast.arg());
     }
+
+    void operator()(const AST::ArrayLiteral &arr) override {
+        std::for_each(arr.elements().begin(), arr.elements().end(),
+                      [this](const auto &elem) { visit(*elem); });
+    }
 };
 
 inline void ParserImpl::verify_expression(const AST::Expression &expr) const {
@@ -169,9 +179,11 @@ private:
     IGNORE(Reference);
     IGNORE(Dereference);
     IGNORE(FieldAccess);
+    IGNORE(Index);
     IGNORE(FunctionCall);
     IGNORE(TemplateFunctionCall);
     IGNORE(Cast);
+    IGNORE(ArrayLiteral);
 #undef IGNORE
 
     /*
@@ -205,7 +217,11 @@ inline std::unique_ptr<AST::Statement> ParserImpl::extract_assignments(
  * ParserImpl public methods.
  */
 
-ParserImpl::ParserImpl(const std::string &fname): lexer(fname) {}
+ParserImpl::ParserImpl(const std::string &fname)
+    : fname(fname), lexer(fname) {}
+
+ParserImpl::ParserImpl(const std::string &fname, const Lexer::Mark &mark)
+    : fname(fname), lexer(fname, mark) {}
 
 std::unique_ptr<AST::Expression> ParserImpl::parse_expression(void) {
     return parse_binop(0, parse_unary());
@@ -220,8 +236,24 @@ std::unique_ptr<AST::Statement> ParserImpl::parse_statement(void) {
         auto result = parse_return();
         find_and_shift(Tok::Semicolon(), "after return statement");
         return result;
+    } else if (llvm::isa<Tok::Become>(lexer.get_tok())) {
+        auto result = parse_become();
+        find_and_shift(Tok::Semicolon(), "after become statement");
+        return result;
     } else if (llvm::isa<Tok::If>(lexer.get_tok())) {
         return parse_if_statement();
+    } else if (llvm::isa<Tok::While>(lexer.get_tok())) {
+        return parse_while_statement(std::vector<AST::Attribute>());
+    } else if (llvm::isa<Tok::For>(lexer.get_tok())) {
+        return parse_for_statement(std::vector<AST::Attribute>());
+    } else if (llvm::isa<Tok::Hash>(lexer.get_tok())) {
+        auto attributes = parse_attributes();
+        if (llvm::isa<Tok::While>(lexer.get_tok())) {
+            return parse_while_statement(std::move(attributes));
+        } else if (llvm::isa<Tok::For>(lexer.get_tok())) {
+            return parse_for_statement(std::move(attributes));
+        }
+        _throw("expected loop after attributes");
     } else {
         auto result = parse_expression();
         find_and_shift(Tok::Semicolon(), "after top-level expression");
@@ -231,7 +263,49 @@ std::unique_ptr<AST::Statement> ParserImpl::parse_statement(void) {
 
 std::unique_ptr<AST::Toplevel> ParserImpl::parse_toplevel(void) {
     if (llvm::isa<Tok::Fn>(lexer.get_tok())) {
-        return parse_function();
+        return parse_function(false);
+    } else if (llvm::isa<Tok::Pub>(lexer.get_tok())) {
+        return parse_public();
+    } else if (llvm::isa<Tok::Const>(lexer.get_tok())) {
+        auto start = lexer.get_pos();
+
+        // Shift the `const`.
+        lexer.shift();
+
+        if (llvm::isa<Tok::TypeName>(lexer.get_tok())) {
+            return parse_global(true, false, std::vector<AST::Attribute>(),
+                                start);
+        } else if (!llvm::isa<Tok::Fn>(lexer.get_tok())) {
+            _throw("expected function or global after \"const\"");
+        }
+
+        return parse_function(true);
+    } else if (llvm::isa<Tok::TypeName>(lexer.get_tok())) {
+        return parse_global(false, false, std::vector<AST::Attribute>(),
+                            lexer.get_pos());
+    } else if (llvm::isa<Tok::Hash>(lexer.get_tok())
+            || llvm::isa<Tok::ThreadLocal>(lexer.get_tok())) {
+        auto start = lexer.get_pos();
+        auto attributes = parse_attributes();
+
+        if (llvm::isa<Tok::Fn>(lexer.get_tok())) {
+            return parse_function(false, false, std::move(attributes));
+        } else if (llvm::isa<Tok::Pub>(lexer.get_tok())) {
+            return parse_public(std::move(attributes));
+        }
+
+        bool is_thread_local = llvm::isa<Tok::ThreadLocal>(lexer.get_tok());
+        if (is_thread_local) {
+            // Shift the `thread_local`.
+            lexer.shift();
+        }
+
+        if (!llvm::isa<Tok::TypeName>(lexer.get_tok())) {
+            _throw("expected function or global variable");
+        }
+
+        return parse_global(false, is_thread_local, std::move(attributes),
+                            start);
     } else if (llvm::isa<Tok::Struct>(lexer.get_tok())) {
         return parse_struct_declaration();
     } else if (llvm::isa<Tok::Type>(lexer.get_tok())) {
@@ -347,7 +421,7 @@ std::unique_ptr<AST::Expression> ParserImpl::parse_unary(void) {
     auto start = lexer.get_pos();
 
     if (!llvm::isa<Tok::Operator>(lexer.get_tok())) {
-        return parse_primary();
+        return parse_indices(parse_primary());
     }
 
     // Save and shift the operator.
@@ -386,6 +460,28 @@ std::unique_ptr<AST::Expression> ParserImpl::parse_binop(
 
         lexer.shift();
 
+        // Field accesses bind tightest, so take the field name directly
+        // (with any indices into it).
+        if (op.op == "." || op.op == "->") {
+            auto *field = llvm::dyn_cast<Tok::Identifier>(&lexer.get_tok());
+            if (!field) {
+                _throw("expected field name in struct access");
+            }
+
+            if (op.op == "->") {
+                auto pos = lhs->pos();
+                lhs = std::make_unique<AST::Dereference>(
+                        std::move(lhs), pos);
+            }
+
+            lhs = std::make_unique<AST::FieldAccess>(
+                    std::move(lhs), field->name, start);
+            lexer.shift();
+
+            lhs = parse_indices(std::move(lhs));
+            continue;
+        }
+
         auto rhs = parse_unary();
         
         int new_prec = get_token_precedence();
@@ -394,26 +490,28 @@ std::unique_ptr<AST::Expression> ParserImpl::parse_binop(
             rhs = parse_binop(old_prec + 1, std::move(rhs));
         }
 
-        if (op.op == "." || op.op == "->") {
-            if (auto *var = llvm::dyn_cast<AST::Variable>(rhs.get())) {
+        lhs = std::make_unique<AST::Binop>(
+                op.op, std::move(lhs), std::move(rhs), start);
+    }
+}
 
-                if (op.op == "->") {
-                    auto pos = lhs->pos();
-                    lhs = std::make_unique<AST::Dereference>(
-                            std::move(lhs), pos);
-                }
+std::unique_ptr<AST::Expression> ParserImpl::parse_indices(
+        std::unique_ptr<AST::Expression> array) {
+    while (llvm::isa<Tok::OpenBracket>(lexer.get_tok())) {
+        auto start = lexer.get_pos();
 
-                lhs = std::make_unique<AST::FieldAccess>(
-                        std::move(lhs), var->name(), start);
-                continue;
-            }
+        // Shift the opening bracket.
+        lexer.shift();
 
-            _throw("expected field name in struct access");
-        }
+        auto index = parse_expression();
 
-        lhs = std::make_unique<AST::Binop>(
-                op.op, std::move(lhs), std::move(rhs), start);
+        find_and_shift(Tok::CloseBracket(), "after array index");
+
+        array = std::make_unique<AST::Index>(std::move(array),
+                                             std::move(index), start);
     }
+
+    return array;
 }
 
 std::unique_ptr<AST::Cast> ParserImpl::parse_cast(void) {
@@ -494,13 +592,23 @@ std::unique_ptr<AST::Expression> ParserImpl::parse_primary(void) {
             return parse_parens();
         }
 
+        case Tok::Token::TokenKind::OpenBracket: {
+            auto pos = lexer.get_pos();
+            // Shift the open bracket.
+            lexer.shift();
+            auto elements = parse_expr_list();
+            find_and_shift(Tok::CloseBracket(), "after array literal");
+            return std::make_unique<AST::ArrayLiteral>(std::move(elements),
+                                                       pos);
+        }
+
         default:
             _throw("expected expression");
     }
 }
 
 std::unique_ptr<AST::Type> ParserImpl::parse_type(void) {
-    /* TODO: Handle parentheses, array types, etc. */
+    /* TODO: Handle parentheses. */
     auto tname = llvm::cast<Tok::TypeName>(lexer.get_tok()).name;
 
     // Shift off the typename.
@@ -509,7 +617,25 @@ std::unique_ptr<AST::Type> ParserImpl::parse_type(void) {
     std::unique_ptr<AST::Type> result
         = std::make_unique<AST::NamedType>(tname, lexer.get_pos());
 
-    if (at_open_generic()) {
+    // Vectors are the one builtin template, with a length as an argument.
+    if (tname == "Vec" && at_open_generic()) {
+        lexer.shift();
+
+        auto element = parse_type();
+        find_and_shift(Tok::Comma(), "after vector element type");
+
+        auto *length = llvm::dyn_cast<Tok::UIntLiteral>(&lexer.get_tok());
+        if (!length || length->value == 0 || length->value > UINT16_MAX) {
+            _throw("expected vector length");
+        }
+        unsigned n = length->value;
+        lexer.shift();
+
+        find_and_shift(Tok::Operator(":>"), "after vector type");
+
+        result = std::make_unique<AST::Vector>(std::move(element), n,
+                                               lexer.get_pos());
+    } else if (at_open_generic()) {
         lexer.shift();
 
         std::vector<std::unique_ptr<AST::Type>> args;
@@ -523,13 +649,28 @@ std::unique_ptr<AST::Type> ParserImpl::parse_type(void) {
                 tname, std::move(args), lexer.get_pos());
     }
 
-    while (llvm::isa<Tok::Operator>(lexer.get_tok())) {
-        auto op = llvm::cast<Tok::Operator>(lexer.get_tok());
-        if (op.op != "*") break;
+    // Pointer and array suffixes, read left to right: `U8 *[4]` is an array
+    // of four pointers.
+    while (true) {
+        if (auto *op = llvm::dyn_cast<Tok::Operator>(&lexer.get_tok())) {
+            if (op->op != "*") break;
 
-        result = std::make_unique<AST::Pointer>(std::move(result),
-                                                lexer.get_pos());
-        lexer.shift();
+            result = std::make_unique<AST::Pointer>(std::move(result),
+                                                    lexer.get_pos());
+            lexer.shift();
+        } else if (llvm::isa<Tok::OpenBracket>(lexer.get_tok())) {
+            lexer.shift();
+
+            auto length = parse_expression();
+
+            find_and_shift(Tok::CloseBracket(), "after array length");
+
+            result = std::make_unique<AST::Array>(std::move(result),
+                                                  std::move(length),
+                                                  lexer.get_pos());
+        } else {
+            break;
+        }
     }
 
     return result;
@@ -623,6 +764,102 @@ std::unique_ptr<AST::IfStatement> ParserImpl::parse_if_statement(void) {
                                               start);
 }
 
+std::unique_ptr<AST::WhileStatement> ParserImpl::parse_while_statement(
+        std::vector<AST::Attribute> attributes) {
+    auto start = lexer.get_pos();
+    // Shift the "while".
+    lexer.shift();
+
+    auto cond = parse_expression();
+
+    auto body = parse_block();
+
+    return std::make_unique<AST::WhileStatement>(std::move(cond),
+                                                 std::move(body),
+                                                 std::move(attributes),
+                                                 start);
+}
+
+std::unique_ptr<AST::ForStatement> ParserImpl::parse_for_statement(
+        std::vector<AST::Attribute> attributes) {
+    auto start = lexer.get_pos();
+    // Shift the "for".
+    lexer.shift();
+
+    // The initializer is a declaration or an assignment,
+    std::unique_ptr<AST::Statement> init;
+    if (llvm::isa<Tok::TypeName>(lexer.get_tok())) {
+        init = parse_declaration();
+    } else {
+        init = extract_assignments(parse_expression());
+    }
+    find_and_shift(Tok::Semicolon(), "after loop initializer");
+
+    // then the condition,
+    auto cond = parse_expression();
+    find_and_shift(Tok::Semicolon(), "after loop condition");
+
+    // then the step, which is run after every iteration.
+    auto step = extract_assignments(parse_expression());
+
+    auto body = parse_block();
+
+    return std::make_unique<AST::ForStatement>(std::move(init),
+                                               std::move(cond),
+                                               std::move(step),
+                                               std::move(body),
+                                               std::move(attributes),
+                                               start);
+}
+
+std::vector<AST::Attribute> ParserImpl::parse_attributes(void) {
+    std::vector<AST::Attribute> result;
+
+    while (llvm::isa<Tok::Hash>(lexer.get_tok())) {
+        auto start = lexer.get_pos();
+        // Shift the "#".
+        lexer.shift();
+        find_and_shift(Tok::OpenBracket(), "after \"#\"");
+
+        auto *name = llvm::dyn_cast<Tok::Identifier>(&lexer.get_tok());
+        if (!name) {
+            _throw("expected attribute name");
+        }
+
+        AST::Attribute attr { name->name, std::vector<std::string>(), start };
+        lexer.shift();
+
+        if (llvm::isa<Tok::OpenParen>(lexer.get_tok())) {
+            lexer.shift();
+
+            while (!llvm::isa<Tok::CloseParen>(lexer.get_tok())) {
+                const auto &tok = lexer.get_tok();
+                if (llvm::isa<Tok::Identifier>(tok)
+                 || llvm::isa<Tok::UIntLiteral>(tok)) {
+                    attr.args.push_back(tok.repr());
+                } else {
+                    _throw("expected identifier or integer as attribute "
+                           "argument");
+                }
+                lexer.shift();
+
+                if (llvm::isa<Tok::CloseParen>(lexer.get_tok())) break;
+
+                find_and_shift(Tok::Comma(), "in attribute arguments");
+            }
+
+            // Shift the closing paren.
+            lexer.shift();
+        }
+
+        find_and_shift(Tok::CloseBracket(), "after attribute");
+
+        result.push_back(std::move(attr));
+    }
+
+    return result;
+}
+
 std::unique_ptr<AST::Statement> ParserImpl::parse_return(void) {
     auto start = lexer.get_pos();
     // Shift the return.
@@ -637,6 +874,22 @@ std::unique_ptr<AST::Statement> ParserImpl::parse_return(void) {
     return std::make_unique<AST::Return>(std::move(retval), start);
 }
 
+std::unique_ptr<AST::Statement> ParserImpl::parse_become(void) {
+    auto start = lexer.get_pos();
+    // Shift the become.
+    lexer.shift();
+
+    auto call = parse_expression();
+
+    if (!llvm::isa<AST::FunctionCall>(*call)
+     && !llvm::isa<AST::TemplateFunctionCall>(*call)) {
+        throw Error("parser error", "expected function call after become",
+                    start);
+    }
+
+    return std::make_unique<AST::Become>(std::move(call), start);
+}
+
 std::unique_ptr<AST::TypeDeclaration>
         ParserImpl::parse_type_declaration(void) {
     auto start = lexer.get_pos();
@@ -658,6 +911,40 @@ std::unique_ptr<AST::TypeDeclaration>
     return std::make_unique<AST::TypeDeclaration>(tname.name, start);
 }
 
+std::unique_ptr<AST::Toplevel> ParserImpl::parse_global(
+        bool is_const, bool is_thread_local,
+        std::vector<AST::Attribute> attributes, SourcePos start,
+        bool is_public) {
+    auto type = parse_type();
+
+    auto *ident = llvm::dyn_cast<Tok::Identifier>(&lexer.get_tok());
+    if (!ident) {
+        _throw("expected identifier in global declaration");
+    }
+
+    std::string name = ident->name;
+
+    // Shift the name.
+    lexer.shift();
+
+    std::unique_ptr<AST::Expression> init;
+
+    if (lexer.get_tok() == Tok::Operator("=")) {
+        // Shift the equals sign.
+        lexer.shift();
+        init = parse_expression();
+        verify_expression(*init);
+    } else if (is_const) {
+        _throw("expected initializer for constant");
+    }
+
+    find_and_shift(Tok::Semicolon(), "after global declaration");
+
+    return std::make_unique<AST::GlobalDeclaration>(
+            std::move(type), name, std::move(init), is_const,
+            is_thread_local, std::move(attributes), start, is_public);
+}
+
 std::vector<std::unique_ptr<AST::Declaration> >
       ParserImpl::parse_declarations(void) {
     find_and_shift(Tok::OpenBrace(), "in declaration block");
@@ -759,7 +1046,39 @@ std::unique_ptr<AST::Toplevel> ParserImpl::parse_struct_declaration(void) {
             tname.name, std::move(members), start);
 }
 
-std::unique_ptr<AST::Toplevel> ParserImpl::parse_function(void) {
+std::unique_ptr<AST::Toplevel> ParserImpl::parse_public(
+        std::vector<AST::Attribute> attributes) {
+    auto start = lexer.get_pos();
+
+    // Shift the `pub`.
+    lexer.shift();
+
+    bool is_const = llvm::isa<Tok::Const>(lexer.get_tok());
+    if (is_const) {
+        // Shift the `const`.
+        lexer.shift();
+    }
+
+    bool is_thread_local = !is_const
+                        && llvm::isa<Tok::ThreadLocal>(lexer.get_tok());
+    if (is_thread_local) {
+        // Shift the `thread_local`.
+        lexer.shift();
+    }
+
+    if (llvm::isa<Tok::TypeName>(lexer.get_tok())) {
+        return parse_global(is_const, is_thread_local, std::move(attributes),
+                            start, true);
+    } else if (is_thread_local || !llvm::isa<Tok::Fn>(lexer.get_tok())) {
+        _throw("expected function or global after \"pub\"");
+    }
+
+    return parse_function(is_const, true, std::move(attributes));
+}
+
+std::unique_ptr<AST::Toplevel> ParserImpl::parse_function(
+        bool is_const, bool is_public,
+        std::vector<AST::Attribute> attributes) {
     auto start = lexer.get_pos();
 
     bool templ = false;
@@ -826,26 +1145,48 @@ std::unique_ptr<AST::Toplevel> ParserImpl::parse_function(void) {
     }
 
     auto decl = std::make_unique<AST::FunctionDeclaration>(
-            fname, std::move(args), std::move(ret_type), start);
+            fname, std::move(args), std::move(ret_type), start,
+            std::move(attributes), is_public);
+
+    if (is_const && templ) {
+        _throw("template functions may not be const");
+    }
+
+    // Each module instantiates the templates it uses for itself.
+    if (is_public && templ) {
+        _throw("template functions may not be pub");
+    }
 
     // If semicolon, this is just a forward declaration.
     if (llvm::isa<Tok::Semicolon>(lexer.get_tok())) {
+        if (is_const) {
+            _throw("expected body of const function");
+        }
+
         // Shift the semicolon.
         lexer.shift();
         return std::move(decl);
     }
 
-    auto body = parse_block();
-
     if (templ) {
+        // Template bodies are only needed once instantiated, so defer
+        // parsing them until then.
+        auto mark = skip_block();
+        auto fname = this->fname;
+        AST::LazyBlock body = [fname, mark]() {
+            ParserImpl parser(fname, mark);
+            return parser.parse_block();
+        };
+
         return std::make_unique<AST::TemplateFunctionDefinition>(
                 std::move(decl), type_list, std::move(body), start);
-
     }
 
+    auto body = parse_block();
+
     return std::make_unique<AST::FunctionDefinition>(std::move(decl),
                                                      std::move(body),
-                                                     start);
+                                                     start, is_const);
 }
 
 std::vector<std::unique_ptr<AST::Statement>> ParserImpl::parse_block(void) {
@@ -862,6 +1203,29 @@ std::vector<std::unique_ptr<AST::Statement>> ParserImpl::parse_block(void) {
     return result;
 }
 
+Lexer::Mark ParserImpl::skip_block(void) {
+    if (!llvm::isa<Tok::OpenBrace>(lexer.get_tok())) {
+        _throw("expected \"{\" before block");
+    }
+
+    auto mark = lexer.get_mark();
+
+    int depth = 0;
+    do {
+        if (lexer.at_eof()) _throw("unterminated block");
+
+        if (llvm::isa<Tok::OpenBrace>(lexer.get_tok())) {
+            depth++;
+        } else if (llvm::isa<Tok::CloseBrace>(lexer.get_tok())) {
+            depth--;
+        }
+
+        lexer.shift();
+    } while (depth > 0);
+
+    return mark;
+}
+
 int ParserImpl::get_token_precedence(void) const {
     const auto &tok = lexer.get_tok();
 
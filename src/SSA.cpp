@@ -0,0 +1,169 @@
+/**
+ * @file SSA.cpp
+ */
+
+/* Craeft: a new systems programming language.
+ *
+ * Copyright (C) 2017 Ian Kuehne <ikuehne@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iterator>
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+
+#include "SSA.hh"
+
+namespace Craeft {
+
+unsigned SSABuilder::add_variable(llvm::Type *t, const std::string &name) {
+    vars.push_back(std::make_pair(t, name));
+    return vars.size() - 1;
+}
+
+void SSABuilder::write(unsigned var, llvm::BasicBlock *b, llvm::Value *val) {
+    defs[std::make_pair(b, var)] = val;
+}
+
+llvm::Value *SSABuilder::read(unsigned var, llvm::BasicBlock *b) {
+    auto def = defs.find(std::make_pair(b, var));
+
+    if (def != defs.end()) {
+        return def->second;
+    }
+
+    return read_recursive(var, b);
+}
+
+llvm::Value *SSABuilder::read_recursive(unsigned var, llvm::BasicBlock *b) {
+    llvm::Value *val;
+
+    if (!sealed.count(b)) {
+        // More predecessors may be added; fill in the phi once they have.
+        auto *phi = create_phi(var, b);
+        incomplete[b].push_back(std::make_pair(var, phi));
+        val = phi;
+    } else if (auto *pred = b->getSinglePredecessor()) {
+        // No phi is needed.
+        val = read(var, pred);
+    } else if (llvm::pred_begin(b) == llvm::pred_end(b)) {
+        // Read before it was ever written.
+        val = llvm::UndefValue::get(vars[var].first);
+    } else {
+        // Record the phi first, to break cycles through loops.
+        auto *phi = create_phi(var, b);
+        write(var, b, phi);
+        val = add_phi_operands(var, phi);
+    }
+
+    write(var, b, val);
+    return val;
+}
+
+llvm::PHINode *SSABuilder::create_phi(unsigned var, llvm::BasicBlock *b) {
+    auto *t = vars[var].first;
+    const auto &name = vars[var].second;
+
+    // Phis go before any other instruction in the block.
+    if (b->empty()) {
+        return llvm::PHINode::Create(t, 0, name, b);
+    }
+
+    return llvm::PHINode::Create(t, 0, name, &b->front());
+}
+
+llvm::Value *SSABuilder::add_phi_operands(unsigned var, llvm::PHINode *phi) {
+    auto *b = phi->getParent();
+
+    for (auto *pred: llvm::predecessors(b)) {
+        phi->addIncoming(read(var, pred), pred);
+    }
+
+    return try_remove_trivial_phi(phi);
+}
+
+bool SSABuilder::is_complete(llvm::PHINode *phi) {
+    auto *b = phi->getParent();
+
+    if (!sealed.count(b)) return false;
+
+    unsigned n_preds = std::distance(llvm::pred_begin(b), llvm::pred_end(b));
+    return phi->getNumIncomingValues() == n_preds;
+}
+
+llvm::Value *SSABuilder::try_remove_trivial_phi(llvm::PHINode *phi) {
+    llvm::Value *same = nullptr;
+
+    for (auto &op: phi->incoming_values()) {
+        if (op == same || op == phi) continue;
+
+        // The phi merges at least two values.
+        if (same) return phi;
+
+        same = op;
+    }
+
+    // The phi is unreachable or in the entry block.
+    if (!same) {
+        same = llvm::UndefValue::get(phi->getType());
+    }
+
+    // Other phis using this one may become trivial once it is replaced.
+    std::vector<llvm::WeakTrackingVH> users;
+    for (auto *user: phi->users()) {
+        if (user != phi && llvm::isa<llvm::PHINode>(user)) {
+            users.push_back(user);
+        }
+    }
+
+    phi->replaceAllUsesWith(same);
+    phi->eraseFromParent();
+
+    // `same` may itself be one of the users, and be replaced in turn.
+    llvm::WeakTrackingVH result(same);
+
+    for (auto &user: users) {
+        // Phis still being filled in are checked once they are complete.
+        auto *user_phi = llvm::dyn_cast_or_null<llvm::PHINode>(user);
+        if (user_phi && is_complete(user_phi)) {
+            try_remove_trivial_phi(user_phi);
+        }
+    }
+
+    return result;
+}
+
+void SSABuilder::seal(llvm::BasicBlock *b) {
+    auto phis = std::move(incomplete[b]);
+    incomplete.erase(b);
+
+    sealed.insert(b);
+
+    for (auto &pair: phis) {
+        add_phi_operands(pair.first, pair.second);
+    }
+}
+
+void SSABuilder::clear(void) {
+    vars.clear();
+    defs.clear();
+    incomplete.clear();
+    sealed.clear();
+}
+
+}
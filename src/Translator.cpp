@@ -8,6 +8,10 @@ Translator::Translator(std::string module_name, std::string filename,
                        std::string triple)
     : pimpl(new TranslatorImpl(module_name, filename, triple)) {}
 
+void Translator::set_source_file(std::string filename) {
+    pimpl->set_source_file(filename);
+}
+
 Translator::~Translator() {}
 
 Value Translator::cast(Value val, const Type &t, SourcePos pos) {
@@ -106,6 +110,18 @@ Value Translator::field_address(Value ptr, std::string field, SourcePos pos) {
     return pimpl->field_address(ptr, field, pos);
 }
 
+Value Translator::offset_of(const Type &t, std::string field, SourcePos pos) {
+    return pimpl->offset_of(t, field, pos);
+}
+
+Value Translator::index(Value array, Value index, SourcePos pos) {
+    return pimpl->index(array, index, pos);
+}
+
+Value Translator::index_address(Value ptr, Value index, SourcePos pos) {
+    return pimpl->index_address(ptr, index, pos);
+}
+
 Value Translator::call(std::string func, std::vector<Value> &args,
                        SourcePos pos) {
     return pimpl->call(func, args, pos);
@@ -116,10 +132,30 @@ Value Translator::call(std::string func, std::vector<Type> &templ_args,
     return pimpl->call(func, templ_args, v_args, pos);
 }
 
+void Translator::become(std::string func, std::vector<Value> &args,
+                        SourcePos pos) {
+    pimpl->become(func, args, pos);
+}
+
+void Translator::become(std::string func, std::vector<Type> &templ_args,
+                        std::vector<Value> &v_args, SourcePos pos) {
+    pimpl->become(func, templ_args, v_args, pos);
+}
+
 Value Translator::string_literal(const std::string &str) {
     return pimpl->string_literal(str);
 }
 
+Value Translator::array_literal(std::vector<Value> &elements, SourcePos pos) {
+    return pimpl->array_literal(elements, pos);
+}
+
+void Translator::create_global(const std::string &name, const Type &t,
+                               const Value *init, bool is_const,
+                               const GlobalAttributes &attrs, SourcePos pos) {
+    pimpl->create_global(name, t, init, is_const, attrs, pos);
+}
+
 Variable Translator::declare(const std::string &name, const Type &t) {
     return pimpl->declare(name, t);
 }
@@ -143,6 +179,9 @@ Value Translator::get_identifier_addr(std::string ident, SourcePos pos) {
 Value Translator::get_identifier_value(std::string ident, SourcePos pos) {
     return pimpl->get_identifier_value(ident, pos);
 }
+Value Translator::get_constant_value(std::string ident, SourcePos pos) {
+    return pimpl->get_constant_value(ident, pos);
+}
 Type Translator::lookup_type(std::string tname, SourcePos pos) {
     return pimpl->lookup_type(tname, pos);
 }
@@ -165,12 +204,38 @@ Type Translator::specialize_template(std::string template_name,
 void Translator::register_template(std::string name,
                                    std::shared_ptr<AST::FunctionDefinition> d,
                                    std::vector<std::string> args,
-                                   TemplateFunction func) {
-    pimpl->register_template(name, d, args, func);
+                                   TemplateFunction func, bool erased) {
+    pimpl->register_template(name, d, args, func, erased);
 }
 void Translator::register_template(TemplateStruct s, std::string name) {
     pimpl->register_template(s, name);
 }
+void Translator::register_const_function(std::string name,
+                                         const AST::FunctionDefinition *def) {
+    pimpl->register_const_function(name, def);
+}
+const AST::FunctionDefinition *Translator::lookup_const_function(
+        std::string name) {
+    return pimpl->lookup_const_function(name);
+}
+void Translator::mark_not_constant(const AST::FunctionDefinition *def,
+                                   const std::vector<Value> &args) {
+    pimpl->mark_not_constant(def, args);
+}
+bool Translator::known_not_constant(const AST::FunctionDefinition *def,
+                                    const std::vector<Value> &args) {
+    return pimpl->known_not_constant(def, args);
+}
+
+bool Translator::is_template_function(std::string name) {
+    return pimpl->is_template_function(name);
+}
+
+std::string Translator::specialization_name(const TemplateValue &tv,
+                                            const std::vector<Type> &args) {
+    return pimpl->specialization_name(tv, args);
+}
+
 Struct<TemplateType> Translator::respecialize_template(
         std::string template_name, const std::vector<TemplateType> &args,
         SourcePos pos) {
@@ -187,13 +252,43 @@ void Translator::end_ifthenelse(IfThenElse structure) {
     pimpl->end_ifthenelse(std::move(structure));
 }
 
-void Translator::create_function_prototype(Function<> f, std::string name) {
-    pimpl->create_function_prototype(f, name);
+Loop Translator::create_loop(LoopHints hints, SourcePos pos) {
+    return pimpl->create_loop(hints, pos);
+}
+
+void Translator::loop_condition(Loop &structure, Value cond, SourcePos pos) {
+    pimpl->loop_condition(structure, cond, pos);
+}
+
+void Translator::end_loop(Loop structure) {
+    pimpl->end_loop(std::move(structure));
+}
+
+bool Translator::is_terminated(void) {
+    return pimpl->is_terminated();
+}
+
+ShortCircuit Translator::create_short_circuit(Value lhs, bool is_and,
+                                              SourcePos pos) {
+    return pimpl->create_short_circuit(lhs, is_and, pos);
+}
+
+Value Translator::end_short_circuit(ShortCircuit structure, Value rhs,
+                                    SourcePos pos) {
+    return pimpl->end_short_circuit(std::move(structure), rhs, pos);
 }
-void Translator::create_and_start_function(Function<> f,
-                                           std::vector<std::string> args,
-                                           std::string name) {
-    pimpl->create_and_start_function(f, args, name);
+
+void Translator::create_function_prototype(Function<> f, std::string name,
+                                           const FunctionAttributes &attrs,
+                                           SourcePos pos) {
+    pimpl->create_function_prototype(f, name, attrs, pos);
+}
+void Translator::create_and_start_function(
+        Function<> f, std::vector<std::string> args, std::string name,
+        const std::set<std::string> &address_taken,
+        const FunctionAttributes &attrs, SourcePos pos) {
+    pimpl->create_and_start_function(f, args, name, address_taken, attrs,
+                                     pos);
 }
 
 void Translator::create_struct(Struct<> t) {
@@ -208,9 +303,22 @@ Translator::end_function(void) {
 void Translator::validate(std::ostream &out) {
     pimpl->validate(out);
 }
+void Translator::internalize(const std::vector<std::string> &exports) {
+    pimpl->internalize(exports);
+}
+void Translator::instrument_profile(const std::string &out_file) {
+    pimpl->instrument_profile(out_file);
+}
+void Translator::use_profile(const std::string &profile) {
+    pimpl->use_profile(profile);
+}
 void Translator::optimize(int opt_level) {
     pimpl->optimize(opt_level);
 }
+
+void Translator::write_template_report(std::ostream &out) {
+    pimpl->write_template_report(out);
+}
 void Translator::emit_ir(std::ostream &fd) {
     pimpl->emit_ir(fd);
 }
@@ -220,6 +328,9 @@ void Translator::emit_obj(int fd) {
 void Translator::emit_asm(int fd) {
     pimpl->emit_asm(fd);
 }
+void Translator::emit_bc(int fd, bool thin_lto) {
+    pimpl->emit_bc(fd, thin_lto);
+}
 
 llvm::LLVMContext &Translator::get_ctx(void) {
     return pimpl->get_ctx();
@@ -20,19 +20,36 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <functional>
+#include <iomanip>
+#include <set>
+#include <sstream>
 
 #include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/BitcodeWriterPass.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Object/SymbolSize.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Instrumentation.h"
+#include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/FunctionComparator.h"
+#include "llvm/Transforms/Vectorize.h"
 
+#include "AST/Serialize.hh"
 #include "TranslatorImpl.hh"
 
 using namespace std::placeholders;
@@ -56,6 +73,52 @@ IfThenElse::IfThenElse(IfThenElse &&other)
 
 IfThenElse::~IfThenElse(void) {}
 
+struct LoopImpl {
+    Block header;
+    Block body;
+    Block exit;
+
+    /**
+     * @brief The `llvm.loop` metadata for the back edge, or NULL.
+     */
+    llvm::MDNode *hints;
+
+    LoopImpl(Block header, Block body, Block exit, llvm::MDNode *hints)
+        : header(header), body(body), exit(exit), hints(hints) {}
+};
+
+Loop::Loop(std::unique_ptr<LoopImpl> pimpl)
+    : pimpl(std::move(pimpl)) {}
+
+Loop::Loop(Loop &&other)
+    : pimpl(std::move(other.pimpl)) {}
+
+Loop::~Loop(void) {}
+
+struct ShortCircuitImpl {
+    Block rhs_b;
+    Block merge_b;
+
+    /**
+     * @brief The block which branched on the left-hand side.
+     */
+    llvm::BasicBlock *lhs_b;
+
+    bool is_and;
+
+    ShortCircuitImpl(Block rhs_b, Block merge_b, llvm::BasicBlock *lhs_b,
+                     bool is_and)
+        : rhs_b(rhs_b), merge_b(merge_b), lhs_b(lhs_b), is_and(is_and) {}
+};
+
+ShortCircuit::ShortCircuit(std::unique_ptr<ShortCircuitImpl> pimpl)
+    : pimpl(std::move(pimpl)) {}
+
+ShortCircuit::ShortCircuit(ShortCircuit &&other)
+    : pimpl(std::move(other.pimpl)) {}
+
+ShortCircuit::~ShortCircuit(void) {}
+
 TranslatorImpl::TranslatorImpl(std::string module_name, std::string filename,
                                std::string triple)
     : rettype(NULL),
@@ -85,7 +148,9 @@ TranslatorImpl::TranslatorImpl(std::string module_name, std::string filename,
     auto cpu = "generic";
     auto features = "";
     llvm::TargetOptions options;
-    auto reloc_model = llvm::Reloc::Model();
+    /* Position-independent, so that objects can be linked into PIE
+     * executables and shared libraries alike. */
+    auto reloc_model = llvm::Reloc::PIC_;
 
     target = llvm_target->createTargetMachine(triple, cpu, features,
                                               options, reloc_model);
@@ -189,7 +254,32 @@ Value TranslatorImpl::cast(Value val, const Type &dest_ty, SourcePos pos) {
 
     if (source_ty == dest_ty) return val;
 
-    switch (boost::apply_visitor(CastVisitor(), source_ty, dest_ty)) {
+    auto *source_vec = boost::get<Vector<> >(&source_ty);
+    auto *dest_vec = boost::get<Vector<> >(&dest_ty);
+
+    // Scalars are cast to the element type and broadcast to every lane.
+    if (dest_vec && !source_vec) {
+        auto element = cast(val, *dest_vec->get_element(), pos);
+        inst = builder.CreateVectorSplat(dest_vec->get_length(),
+                                         element.to_llvm());
+        return Value(inst, dest_ty);
+    }
+
+    // Vectors are cast element-wise.
+    auto cast_type = LlvmCastType::Illegal;
+    if (source_vec && dest_vec) {
+        if (source_vec->get_length() != dest_vec->get_length()) {
+            throw Error("type error", "cannot cast between vectors of "
+                                      "different lengths", pos);
+        }
+        cast_type = boost::apply_visitor(CastVisitor(),
+                                         *source_vec->get_element(),
+                                         *dest_vec->get_element());
+    } else if (!source_vec) {
+        cast_type = boost::apply_visitor(CastVisitor(), source_ty, dest_ty);
+    }
+
+    switch (cast_type) {
     case SWidth:
         inst = builder.CreateSExtOrTrunc(v, dt);
         break;
@@ -241,18 +331,38 @@ Value TranslatorImpl::add_load(Value pointer, SourcePos pos) {
     }
 
     auto *pointed = pointer_ty->get_pointed();
+
+    if (has_erased_layout(*pointed)) {
+        throw Error("type error", "cannot load value whose size is only "
+                                  "known at run time", pos);
+    }
+
     auto *inst = builder.CreateLoad(pointer.to_llvm());
 
     return Value(inst, *pointed);
 }
 
 void TranslatorImpl::add_store(Value pointer, Value new_val, SourcePos pos) {
+    auto ty = pointer.get_type();
+    auto *pointer_ty = boost::get<Pointer<> >(&ty);
     // Make sure value is actually a pointer.
-    if (!is_type<Pointer<> >(pointer.get_type())) {
+    if (!pointer_ty) {
         throw Error("type error", "cannot dereference non-pointer value",
                     pos);
     }
 
+    if (has_erased_layout(*pointer_ty->get_pointed())) {
+        throw Error("type error", "cannot store value whose size is only "
+                                  "known at run time", pos);
+    }
+
+    // Catch direct assignments to constants, or their fields and elements.
+    auto *base = pointer.to_llvm()->stripInBoundsOffsets();
+    auto *global = llvm::dyn_cast<llvm::GlobalVariable>(base);
+    if (global && global->isConstant()) {
+        throw Error("error", "cannot assign to constant", pos);
+    }
+
     builder.CreateStore(new_val.to_llvm(), pointer.to_llvm());
 }
 
@@ -375,6 +485,14 @@ public:
         return ptr_ptr_op(lhs, rhs);
     }
 
+    virtual Value vec_vec_op(const Value &, const Value &) {
+        type_error("cannot perform \"" + get_op() + "\" between vectors");
+    }
+
+    Value operator()(const Vector<> &, const Vector<> &) {
+        return vec_vec_op(lhs, rhs);
+    }
+
     template<typename L, typename R>
     Value operator()(const L &, const R &) {
         type_error("illegal " + get_op());
@@ -399,11 +517,23 @@ protected:
 
     llvm::Module &module;
 
-private:
     [[noreturn]] void type_error(std::string msg) const {
         throw Error("type error", msg, pos);
     }
 
+    /**
+     * @brief Get the element type of two vectors of the same type.
+     */
+    const Type &get_vector_element(const Value &l, const Value &r) const {
+        if (!(l.get_type() == r.get_type())) {
+            type_error("cannot perform \"" + get_op() + "\" between vectors "
+                       "of different types");
+        }
+
+        return *boost::get<Vector<> >(l.get_type()).get_element();
+    }
+
+private:
     const Value &lhs;
     const Value &rhs;
     const SourcePos pos;
@@ -485,6 +615,17 @@ public:
     virtual Value uint_int_op(const Value &l, const Value &r) override {
         return extend_and_perform(l, r, signed_int_extender);
     }
+
+    virtual Value vec_vec_op(const Value &l, const Value &r) override {
+        const auto &element = get_vector_element(l, r);
+
+        if (is_type<Float>(element)) {
+            type_error("cannot perform \"" + get_op() + "\" between float "
+                       "vectors");
+        }
+
+        return Value(perform(l.to_llvm(), r.to_llvm()), l.get_type());
+    }
 };
 
 #define make_bitwise(method, classname, op)\
@@ -644,12 +785,12 @@ public:
         if (lbits < rbits) {
             auto *l_instr = extender(l.to_llvm(), rty);
             auto *result = performer(l_instr, r.to_llvm());
-            return Value(result, r.get_type());
+            return Value(result, result_type(r.get_type()));
         }
 
         auto *r_instr = extender(r.to_llvm(), lty);
         auto *result = performer(l.to_llvm(), r_instr);
-        return Value(result, l.get_type());
+        return Value(result, result_type(l.get_type()));
     }
 
     Value extend_and_perform_float(const Value &l, const Value &r,
@@ -667,7 +808,7 @@ public:
             result = performer(l_extended, r.to_llvm());
         }
 
-        return Value(result, wider);
+        return Value(result, result_type(wider));
     }
 
     Value sint_int_op(const Value &l, const Value &r) override {
@@ -685,7 +826,32 @@ public:
                                         float_extender, float_performer);
     }
 
+    /**
+     * @brief Vectors of the same type are operated on element-wise.
+     */
+    Value vec_vec_op(const Value &l, const Value &r) override {
+        const auto &element = get_vector_element(l, r);
+
+        llvm::Value *result;
+        if (is_type<SignedInt>(element)) {
+            result = sint_perform(l.to_llvm(), r.to_llvm());
+        } else if (is_type<UnsignedInt>(element)) {
+            result = uint_perform(l.to_llvm(), r.to_llvm());
+        } else {
+            result = float_perform(l.to_llvm(), r.to_llvm());
+        }
+
+        return Value(result, result_type(l.get_type()));
+    }
+
 protected:
+    /**
+     * @brief Get the type of the result given the (common) operand type.
+     */
+    virtual Type result_type(const Type &operand) {
+        return operand;
+    }
+
     virtual llvm::Value *uint_perform(llvm::Value *, llvm::Value *) = 0;
     virtual llvm::Value *sint_perform(llvm::Value *, llvm::Value *) = 0;
     virtual llvm::Value *float_perform(llvm::Value *, llvm::Value *) = 0;
@@ -737,6 +903,7 @@ protected:
 };
 
 Value TranslatorImpl::add(Value lhs, Value rhs, SourcePos pos) {
+    scale_erased_offset(lhs, rhs, pos);
     return AddOperator(lhs, rhs, pos, *module, builder).apply();
 }
 
@@ -793,7 +960,52 @@ protected:
 };
 
 Value TranslatorImpl::sub(Value lhs, Value rhs, SourcePos pos) {
-    return SubOperator(lhs, rhs, pos, *module, builder).apply();
+    scale_erased_offset(lhs, rhs, pos);
+    auto result = SubOperator(lhs, rhs, pos, *module, builder).apply();
+
+    // The difference of two pointers to an erased type is in bytes.
+    auto lhs_t = lhs.get_type();
+    auto *ptr_t = boost::get<Pointer<> >(&lhs_t);
+    if (ptr_t && is_type<Pointer<> >(rhs.get_type())
+              && is_type<Erased>(*ptr_t->get_pointed())) {
+        const auto &erased = boost::get<Erased>(*ptr_t->get_pointed());
+        auto *elements = builder.CreateExactSDiv(result.to_llvm(),
+                                                 erased_layout(erased, 0));
+        return Value(elements, result.get_type());
+    }
+
+    return result;
+}
+
+void TranslatorImpl::scale_erased_offset(Value &lhs, Value &rhs,
+                                         SourcePos pos) {
+    Value *operands[] = { &lhs, &rhs };
+
+    for (unsigned i = 0; i < 2; ++i) {
+        auto ty = operands[i]->get_type();
+        auto *ptr_t = boost::get<Pointer<> >(&ty);
+
+        if (!ptr_t || !has_erased_layout(*ptr_t->get_pointed())) continue;
+
+        auto *erased = boost::get<Erased>(ptr_t->get_pointed());
+        if (!erased) {
+            throw Error("type error", "cannot do arithmetic on pointer to "
+                                      "type whose size is only known at run "
+                                      "time", pos);
+        }
+
+        auto &offset = *operands[1 - i];
+        if (!offset.is_integral()) continue;
+
+        // Pointers to erased types are byte pointers.
+        auto *i64 = builder.getInt64Ty();
+        auto *idx = is_type<SignedInt>(offset.get_type())
+                  ? builder.CreateSExtOrTrunc(offset.to_llvm(), i64)
+                  : builder.CreateZExtOrTrunc(offset.to_llvm(), i64);
+        auto *bytes = builder.CreateMul(idx, erased_layout(*erased, 0));
+
+        offset = Value(bytes, SignedInt(64));
+    }
 }
 
 class MulOperator: public ArithmeticOperator {
@@ -880,10 +1092,21 @@ public:
 
         auto result = get_builder().CreateICmp(unsigned_int_predicate(),
                                                l.to_llvm(), r.to_llvm());
-        return Value(result, l.get_type());
+        return Value(result, result_type(l.get_type()));
     }
 
 protected:
+    /**
+     * @brief Comparisons produce a U1, or a mask of U1s for vectors.
+     */
+    Type result_type(const Type &operand) override {
+        if (auto *vec = boost::get<Vector<> >(&operand)) {
+            return Vector<>(UnsignedInt(1), vec->get_length());
+        }
+
+        return UnsignedInt(1);
+    }
+
     virtual llvm::Value *sint_perform(llvm::Value *l, llvm::Value *r) 
          override {
        return get_builder().CreateICmp(signed_int_predicate(), l, r);
@@ -1140,6 +1363,11 @@ TranslatorImpl::get_field_idx(Type _t, std::string field, SourcePos pos) {
                     pos);
     }
 
+    if (has_erased_layout(_t)) {
+        throw Error("type error", "cannot access field of struct whose "
+                                  "layout is only known at run time", pos);
+    }
+
     auto field_entry = (*t)[field];
 
     auto result_t = field_entry.second;
@@ -1191,18 +1419,115 @@ Value TranslatorImpl::field_address(Value ptr, std::string field,
     return Value(instr, result_ptr);
 }
 
-Value TranslatorImpl::call(std::string func, std::vector<Value> &args,
-                           SourcePos pos) {
-    std::vector<llvm::Value *>llvm_args;
+Value TranslatorImpl::offset_of(const Type &t, std::string field,
+                                SourcePos pos) {
+    auto pair = get_field_idx(t, field, pos);
+
+    auto *str = static_cast<llvm::StructType *>(get_sized_type(t, pos));
+    const auto *layout = module->getDataLayout().getStructLayout(str);
+
+    auto *result = builder.getInt64(layout->getElementOffset(pair.first));
+
+    return Value(result, UnsignedInt(64));
+}
+
+inline llvm::Value *TranslatorImpl::get_array_idx(const Array<> &t,
+                                                  Value index,
+                                                  SourcePos pos) {
+    if (!index.is_integral()) {
+        throw Error("type error", "array index must be an integer", pos);
+    }
+
+    auto *i64 = builder.getInt64Ty();
+    auto *idx = is_type<SignedInt>(index.get_type())
+              ? builder.CreateSExtOrTrunc(index.to_llvm(), i64)
+              : builder.CreateZExtOrTrunc(index.to_llvm(), i64);
+
+    // Constant indices can be checked now.  Negative signed indices wrap
+    // around to huge unsigned ones, so one comparison suffices.
+    if (auto *c = llvm::dyn_cast<llvm::ConstantInt>(idx)) {
+        if (c->getValue().uge(t.get_length())) {
+            throw Error("error", "array index out of bounds", pos);
+        }
+    }
 
-    for (auto &arg: args) {
-        llvm_args.push_back(arg.to_llvm());
+    return idx;
+}
+
+Value TranslatorImpl::index(Value array, Value index, SourcePos pos) {
+    auto _t = array.get_type();
+    auto t = boost::get<Array<> >(&_t);
+
+    if (!t) {
+        throw Error("type error", "cannot index non-array value", pos);
+    }
+
+    auto *idx = get_array_idx(*t, index, pos);
+
+    if (auto *c = llvm::dyn_cast<llvm::ConstantInt>(idx)) {
+        std::vector<unsigned> idxs;
+
+        idxs.push_back(c->getZExtValue());
+
+        auto *instr = builder.CreateExtractValue(array.to_llvm(), idxs);
+
+        return Value(instr, *t->get_element());
+    }
+
+    // A variable index needs the array in memory.
+    auto *tmp = create_temporary(to_llvm_type(_t, *module));
+    builder.CreateStore(array.to_llvm(), tmp);
+
+    Value ptr(tmp, Pointer<>(std::make_shared<Type>(_t)));
+
+    return add_load(index_address(ptr, index, pos), pos);
+}
+
+Value TranslatorImpl::index_address(Value ptr, Value index, SourcePos pos) {
+    auto _ptr_t = ptr.get_type();
+    auto ptr_t = boost::get<Pointer<> >(&_ptr_t);
+    auto arr_t = ptr_t ? boost::get<Array<> >(ptr_t->get_pointed()) : nullptr;
+
+    if (!arr_t) {
+        throw Error("type error", "cannot index non-array value", pos);
+    }
+
+    if (has_erased_layout(*arr_t)) {
+        throw Error("type error", "cannot index array whose layout is only "
+                                  "known at run time", pos);
     }
 
+    llvm::Value *idxs[] = { builder.getInt64(0),
+                            get_array_idx(*arr_t, index, pos) };
+
+    auto *gep_type = to_llvm_type(*ptr_t->get_pointed(), *module);
+
+    auto *instr = builder.CreateInBoundsGEP(gep_type, ptr.to_llvm(), idxs);
+
+    auto result_ptr
+        = Pointer<>(std::make_shared<Type>(*arr_t->get_element()));
+
+    return Value(instr, result_ptr);
+}
+
+Value TranslatorImpl::call(std::string func, std::vector<Value> &args,
+                           SourcePos pos) {
     if (!env.bound(func)) {
+        auto builtin = get_builtins().find(func);
+        if (builtin != get_builtins().end()) {
+            return builtin->second(*this, args, pos);
+        }
+
         throw Error("error", "function \"" + func + "\" not defined", pos);
     }
 
+    auto callee = lookup_callee(func, args, pos);
+    return lowered_call(callee.first, callee.second, args);
+}
+
+std::pair<llvm::Function *, Function<> >
+TranslatorImpl::lookup_callee(std::string func, std::vector<Value> &args,
+                              SourcePos pos) {
     auto fbinding = env.lookup_identifier(func, pos);
     auto ty = fbinding.get_type();
     auto *ftype = boost::get<Function<> >(&ty);
@@ -1211,6 +1536,11 @@ Value TranslatorImpl::call(std::string func, std::vector<Value> &args,
         throw Error("type error", "cannot call non-function value", pos);
     }
 
+    if (args.size() != ftype->get_args().size()) {
+        throw Error("type error", "wrong number of arguments to function",
+                    pos);
+    }
+
     for (unsigned i = 0; i < args.size(); ++i) {
         auto lhs_ty = args[i].get_type();
         auto rhs_ty = *ftype->get_args()[i];
@@ -1220,181 +1550,963 @@ Value TranslatorImpl::call(std::string func, std::vector<Value> &args,
         }
     }
 
-    auto *inst = builder.CreateCall(fbinding.get_val().to_llvm(), llvm_args);
-    return Value(inst, *ftype->get_rettype());
+    auto *callee = llvm::cast<llvm::Function>(fbinding.get_val().to_llvm());
+    return std::make_pair(callee, *ftype);
 }
 
 Value TranslatorImpl::call(std::string func, std::vector<Type> &templ_args,
                            std::vector<Value> &v_args, SourcePos pos) {
 
-    // Use the mangled name to find the function if it has been implemented.
-    auto name = mangle_name(func, templ_args);
+    if (!env.template_func_bound(func)) {
+        auto builtin = get_template_builtins().find(func);
+        if (builtin != get_template_builtins().end()) {
+            return builtin->second(*this, templ_args, v_args, pos);
+        }
+    }
 
-    auto tv = env.lookup_template_func(func, pos);
+    const auto &tv = env.lookup_template_func(func, pos);
+    if (tv.erased) {
+        return erased_call(func, tv, templ_args, v_args, pos);
+    }
 
+    auto callee = lookup_template_callee(func, templ_args, v_args, pos);
+    return lowered_call(callee.first, callee.second, v_args);
+}
 
-    auto specialized_type = tv.ty.specialize(templ_args);
+/**
+ * @brief Get the type of the given function with the given number of
+ *        descriptors passed before its arguments.
+ */
+static Function<> with_descriptors(const Function<> &f, unsigned n) {
+    auto desc = std::make_shared<Type>(
+        Pointer<>(std::make_shared<Type>(UnsignedInt(64))));
 
-    // Try to just find the specialized function.
-    auto *fbinding = module->getFunction(name);
+    std::vector<std::shared_ptr<Type> > args(n, desc);
+    args.insert(args.end(), f.get_args().begin(), f.get_args().end());
 
-    // If it isn't there, make it, and note that we need to fill it out later.
-    if (!fbinding) {
-        auto *ll_ty = to_llvm_type(specialized_type, *module);
+    return Function<>(std::make_shared<Type>(*f.get_rettype()), args);
+}
 
-        auto *f_ty = static_cast<llvm::FunctionType *>(ll_ty);
-        fbinding = llvm::Function::Create(f_ty,
-                                          llvm::Function::ExternalLinkage,
-                                          name,
-                                          module.get());
+Value TranslatorImpl::erased_call(std::string func, const TemplateValue &tv,
+                                  std::vector<Type> &templ_args,
+                                  std::vector<Value> &v_args,
+                                  SourcePos pos) {
+    if (templ_args.size() != tv.arg_names.size()) {
+        throw Error("type error", "wrong number of type arguments to "
+                                  "template", pos);
+    }
 
-        std::pair<std::vector<Type>, const TemplateValue &>specialization
-            (templ_args, tv);
+    std::vector<Type> erased_args;
+    for (const auto &name: tv.arg_names) {
+        erased_args.push_back(Erased(name));
+    }
 
-        specializations.push_back(specialization);
+    auto erased_type = tv.ty.specialize(erased_args);
+    auto concrete_type = tv.ty.specialize(templ_args);
+
+    if (v_args.size() != concrete_type.get_args().size()) {
+        throw Error("type error", "wrong number of arguments to function",
+                    pos);
     }
 
-    std::vector<llvm::Value *>llvm_args;
+    // Values of erased types are passed and returned by pointer, as
+    // pointers to bytes.
+    for (unsigned i = 0; i <= v_args.size(); ++i) {
+        const auto &ty = i < v_args.size() ? *erased_type.get_args()[i]
+                                           : *erased_type.get_rettype();
+        if (mentions_erased(ty) && !is_type<Pointer<> >(ty)) {
+            throw Error("type error", "erased template \"" + func + "\" "
+                                      "may only take and return type "
+                                      "parameters behind pointers", pos);
+        }
+    }
+
+    std::vector<Value> args;
+    for (const auto &t: templ_args) {
+        if (has_erased_layout(t) && !is_type<Erased>(t)) {
+            throw Error("type error", "cannot pass type whose layout is only "
+                                      "known at run time to erased "
+                                      "template", pos);
+        }
 
-    for (const auto &arg: v_args) {
-        llvm_args.push_back(arg.to_llvm());
+        args.push_back(type_descriptor(t, pos));
     }
 
-    auto *inst = builder.CreateCall(fbinding, llvm_args);
-    return Value(inst, *specialized_type.get_rettype());
+    for (unsigned i = 0; i < v_args.size(); ++i) {
+        if (!(v_args[i].get_type() == *concrete_type.get_args()[i])) {
+            throw Error("type error", "argument does not match function type",
+                        pos);
+        }
 
-}
+        const auto &erased_arg = *erased_type.get_args()[i];
+        args.push_back(mentions_erased(erased_arg)
+                     ? cast(v_args[i], erased_arg, pos) : v_args[i]);
+    }
 
-Value TranslatorImpl::string_literal(const std::string &str) {
-    auto *result = builder.CreateGlobalStringPtr(str);
-    return Value(result, Pointer<Type>(UnsignedInt(8)));
-}
+    auto lowered_type = with_descriptors(erased_type, templ_args.size());
+    auto name = specialization_name(tv, erased_args);
 
-Variable TranslatorImpl::declare(const std::string &varname, const Type &t) {
-    auto *alloca = builder.CreateAlloca(to_llvm_type(t, *module),
-                                        nullptr, varname);
-    return env.add_identifier(varname, Value(alloca, Pointer<>(t)));
-}
+    // The template is compiled once, the first time it is called.
+    auto *callee = module->getFunction(name);
+    if (!callee) {
+        FunctionABI f_abi(lowered_type, *module);
 
-void TranslatorImpl::assign(const std::string &varname, Value val,
-                            SourcePos pos) {
-    auto var = env.lookup_identifier(varname, pos);
+        callee = llvm::Function::Create(f_abi.get_type(),
+                                        llvm::Function::ExternalLinkage,
+                                        name, module.get());
+        f_abi.add_attributes(callee);
 
-    if (!(val.get_type() == var.get_type())) {
-        throw Error("type error",
-                    "cannot assign to variable of different type",
-                    pos);
+        specializations.push_back(std::make_pair(erased_args, tv));
     }
 
-    // Get the address of the variable on the stack.
-    auto *load = var.get_val().to_llvm();
+    record_call(name, func, pos);
 
-    // Actually store the new value into that address.
-    builder.CreateStore(val.to_llvm(), load);
-}
+    auto result = lowered_call(callee, lowered_type, args);
 
-void TranslatorImpl::create_function_prototype(Function<> f, std::string name)
-{
-    auto *ll_f = static_cast<llvm::FunctionType *>(to_llvm_type(f, *module));
-    auto *result = llvm::Function::Create(ll_f,
-                                          llvm::Function::ExternalLinkage,
-                                          name, module.get());
+    if (!mentions_erased(*erased_type.get_rettype())) {
+        return result;
+    }
 
-    env.add_identifier(name, Value(result, f));
+    return cast(result, *concrete_type.get_rettype(), pos);
 }
 
-void TranslatorImpl::create_and_start_function(Function<> f,
-                                               std::vector<std::string> args,
-                                               std::string name) {
-    auto *ll_f = static_cast<llvm::FunctionType *>(to_llvm_type(f, *module));
-
-    // Try to find the function already in the module.
-    auto *result = module->getFunction(name);
+Value TranslatorImpl::type_descriptor(const Type &t, SourcePos pos) {
+    Type desc_t = Pointer<>(std::make_shared<Type>(UnsignedInt(64)));
 
-    // If it's not there,
-    if (!result) {
-        // generate it.
-        result = llvm::Function::Create(ll_f,
-                                        llvm::Function::ExternalLinkage,
-                                        name, module.get());
+    if (auto *erased = boost::get<Erased>(&t)) {
+        return Value(erased_descriptors.at(erased->get_name()), desc_t);
     }
 
-    env.add_identifier(name, Value(result, f));
+    auto *i64 = builder.getInt64Ty();
+    auto *desc_ty = llvm::ArrayType::get(i64, 2);
 
-    // Create the first block in the function.
-    point(Block(result, "entry"));
+    auto *ty = get_sized_type(t, pos);
+    auto &layout = module->getDataLayout();
+    uint64_t size = layout.getTypeAllocSize(ty);
+    uint64_t align = layout.getABITypeAlignment(ty);
 
-    // Push a new namespace for the function.
-    env.push();
+    // Like specializations, each module using a descriptor has a copy.
+    // Descriptors are named by their contents, since types of the same
+    // name may have different layouts in different modules.
+    auto name = "TypeDesc." + std::to_string(size) + "."
+              + std::to_string(align);
 
-    unsigned i = 0;
-    
-    for (auto &arg: result->args()) {
-        auto &ty = f.get_args()[i];
-        auto arg_addr = builder.CreateAlloca(to_llvm_type(*ty, *module));
-        builder.CreateStore(&arg, arg_addr);
-        env.add_identifier(args[i++], Value(arg_addr, Pointer<>(ty)));
-    }
+    auto *global = module->getNamedGlobal(name);
+    if (!global) {
+        llvm::Constant *fields[] = {
+            llvm::ConstantInt::get(i64, size),
+            llvm::ConstantInt::get(i64, align)
+        };
 
-    if (rettype) {
-        // TODO: Fix this code.
-        SourcePos pos(0, 0, std::make_shared<std::string>(fname));
-        throw Error("internal error", "cannot start function while inside "
-                                      "function", pos);
+        global = new llvm::GlobalVariable(
+            *module, desc_ty, true, llvm::GlobalValue::LinkOnceODRLinkage,
+            llvm::ConstantArray::get(desc_ty, fields), name);
+        global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+        if (llvm::Triple(module->getTargetTriple()).supportsCOMDAT()) {
+            global->setComdat(module->getOrInsertComdat(name));
+        }
     }
 
-    rettype = f.get_rettype();
+    auto *addr = builder.CreateConstInBoundsGEP2_64(desc_ty, global, 0, 0);
+
+    return Value(addr, desc_t);
 }
 
-void TranslatorImpl::create_struct(Struct<> t) {
-    env.add_type(t.get_name(), t);
+llvm::Value *TranslatorImpl::erased_layout(const Erased &t, unsigned field) {
+    auto *i64 = builder.getInt64Ty();
+    auto *desc = erased_descriptors.at(t.get_name());
+    auto *addr = builder.CreateConstInBoundsGEP1_64(i64, desc, field);
+    auto *load = builder.CreateLoad(i64, addr);
+
+    // Descriptors never change, so loads from them may be hoisted freely.
+    load->setMetadata(llvm::LLVMContext::MD_invariant_load,
+                      llvm::MDNode::get(context, {}));
+
+    return load;
 }
 
-std::vector< std::pair< std::vector<Type>, TemplateValue> >
-TranslatorImpl::end_function(void) {
-    env.pop();
+std::pair<llvm::Function *, Function<> >
+TranslatorImpl::lookup_template_callee(std::string func,
+                                       std::vector<Type> &templ_args,
+                                       std::vector<Value> &v_args,
+                                       SourcePos pos) {
+    auto tv = env.lookup_template_func(func, pos);
 
-    // Add implicit void returns.
-    if (is_type<Void>(*rettype) && !current->is_terminated()) {
-        return_(SourcePos(0, 0, std::make_shared<std::string>(fname)));
+    // Use the mangled name to find the function if it has been implemented.
+    auto name = specialization_name(tv, templ_args);
+
+    // Erased types only exist inside the erased template they belong to.
+    for (const auto &t: templ_args) {
+        if (mentions_erased(t)) {
+            throw Error("type error", "cannot specialize template \"" + func
+                                    + "\" with a parameter of an erased "
+                                      "template", pos);
+        }
     }
 
-    rettype = NULL;
 
-    auto saved_specializations = std::move(specializations);
+    auto specialized_type = tv.ty.specialize(templ_args);
 
-    specializations =
-        std::vector< std::pair< std::vector<Type>, TemplateValue > >();
+    // Try to just find the specialized function.
+    auto *fbinding = module->getFunction(name);
 
-    return saved_specializations;
-}
+    // If it isn't there, make it, and note that we need to fill it out later.
+    if (!fbinding) {
+        FunctionABI f_abi(specialized_type, *module);
 
-void TranslatorImpl::return_(Value val, SourcePos pos) {
-    current->return_(val);
-}
+        // Its linkage is set once it is defined.
+        fbinding = llvm::Function::Create(f_abi.get_type(),
+                                          llvm::Function::ExternalLinkage,
+                                          name,
+                                          module.get());
+        f_abi.add_attributes(fbinding);
 
-void TranslatorImpl::return_(SourcePos pos) {
-    current->return_();
-}
+        std::pair<std::vector<Type>, const TemplateValue &>specialization
+            (templ_args, tv);
 
-Value TranslatorImpl::get_identifier_addr(std::string ident, SourcePos pos) {
-    return env.lookup_identifier(ident, pos).get_val();
-}
+        specializations.push_back(specialization);
+        layout_classes[layout_class(func, templ_args)].push_back(name);
+    }
 
-Value TranslatorImpl::get_identifier_value(std::string ident, SourcePos pos) {
-    Value addr = get_identifier_addr(ident, pos);
+    record_call(name, func, pos);
 
-    assert(is_type<Pointer<> >(addr.get_type()));
+    if (v_args.size() != specialized_type.get_args().size()) {
+        throw Error("type error", "wrong number of arguments to function",
+                    pos);
+    }
 
-    return add_load(addr, pos);
+    return std::make_pair(fbinding, specialized_type);
 }
 
-Type TranslatorImpl::lookup_type(std::string tname, SourcePos pos) {
+void TranslatorImpl::become(std::string func, std::vector<Value> &args,
+                            SourcePos pos) {
+    if (!env.bound(func)) {
+        if (get_builtins().count(func)) {
+            throw Error("error", "cannot become a call to builtin \""
+                               + func + "\"", pos);
+        }
+
+        throw Error("error", "function \"" + func + "\" not defined", pos);
+    }
+
+    auto callee = lookup_callee(func, args, pos);
+    tail_call(callee.first, callee.second, args, pos);
+}
+
+void TranslatorImpl::become(std::string func, std::vector<Type> &templ_args,
+                            std::vector<Value> &v_args, SourcePos pos) {
+    if (!env.template_func_bound(func)
+     && get_template_builtins().count(func)) {
+        throw Error("error", "cannot become a call to builtin \""
+                           + func + "\"", pos);
+    }
+
+    if (env.lookup_template_func(func, pos).erased) {
+        throw Error("error", "cannot become a call to erased template \""
+                           + func + "\"", pos);
+    }
+
+    auto callee = lookup_template_callee(func, templ_args, v_args, pos);
+    tail_call(callee.first, callee.second, v_args, pos);
+}
+
+void TranslatorImpl::lower_args(const FunctionABI &f_abi,
+                                std::vector<Value> &args,
+                                std::vector<llvm::Value *> &llvm_args) {
+    for (unsigned i = 0; i < args.size(); ++i) {
+        auto &arg_abi = f_abi.get_arg(i);
+        auto *arg = args[i].to_llvm();
+
+        switch (arg_abi.kind) {
+            case ArgABI::DIRECT:
+                llvm_args.push_back(arg);
+                break;
+            case ArgABI::COERCE: {
+                auto *tmp = coerce_temporary(arg->getType(),
+                                             arg_abi.coerce_to);
+                builder.CreateStore(arg, tmp);
+                for (auto *part: load_coerced(tmp, arg_abi.coerce_to)) {
+                    llvm_args.push_back(part);
+                }
+                break;
+            }
+            case ArgABI::INDIRECT: {
+                // The callee gets its own copy through `byval`.
+                auto *tmp = create_temporary(arg->getType());
+                builder.CreateStore(arg, tmp);
+                llvm_args.push_back(tmp);
+                break;
+            }
+            case ArgABI::IGNORE:
+                break;
+        }
+    }
+}
+
+Value TranslatorImpl::lowered_call(llvm::Function *callee,
+                                   const Function<> &ty,
+                                   std::vector<Value> &args) {
+    FunctionABI f_abi(ty, *module);
+
+    auto *ret_type = to_llvm_type(*ty.get_rettype(), *module);
+    llvm::Value *ret_addr = nullptr;
+
+    std::vector<llvm::Value *>llvm_args;
+
+    if (f_abi.get_ret().kind == ArgABI::INDIRECT) {
+        ret_addr = create_temporary(ret_type);
+        llvm_args.push_back(ret_addr);
+    }
+
+    lower_args(f_abi, args, llvm_args);
+
+    auto *inst = builder.CreateCall(callee, llvm_args);
+    f_abi.add_attributes(inst);
+
+    llvm::Value *result = inst;
+    auto &ret_abi = f_abi.get_ret();
+
+    switch (ret_abi.kind) {
+        case ArgABI::DIRECT:
+            break;
+        case ArgABI::COERCE: {
+            auto *tmp = coerce_temporary(ret_type, ret_abi.coerce_to);
+            std::vector<llvm::Value *> parts;
+            if (auto *st
+                    = llvm::dyn_cast<llvm::StructType>(ret_abi.coerce_to)) {
+                for (unsigned i = 0; i < st->getNumElements(); ++i) {
+                    parts.push_back(builder.CreateExtractValue(inst, i));
+                }
+            } else {
+                parts.push_back(inst);
+            }
+            store_coerced(tmp, ret_abi.coerce_to, parts);
+            result = builder.CreateLoad(ret_type, tmp);
+            break;
+        }
+        case ArgABI::INDIRECT:
+            result = builder.CreateLoad(ret_type, ret_addr);
+            break;
+        case ArgABI::IGNORE:
+            result = llvm::UndefValue::get(ret_type);
+            break;
+    }
+
+    return Value(result, *ty.get_rettype());
+}
+
+/**
+ * @brief Get whether the given value may be computed from the address of a
+ *        stack slot in the current function.
+ *
+ * Values loaded from memory or returned by calls are not followed, nor are
+ * comparisons, whose results do not carry an address.
+ */
+static bool points_into_frame(llvm::Value *val) {
+    std::set<llvm::Value *> seen;
+    std::vector<llvm::Value *> worklist { val };
+
+    while (!worklist.empty()) {
+        auto *v = worklist.back();
+        worklist.pop_back();
+
+        if (!seen.insert(v).second) {
+            continue;
+        }
+
+        if (llvm::isa<llvm::AllocaInst>(v)) {
+            return true;
+        }
+
+        auto *inst = llvm::dyn_cast<llvm::Instruction>(v);
+        if (!inst || llvm::isa<llvm::LoadInst>(inst)
+                  || llvm::isa<llvm::CallInst>(inst)
+                  || llvm::isa<llvm::CmpInst>(inst)) {
+            continue;
+        }
+
+        for (auto &op: inst->operands()) {
+            worklist.push_back(op.get());
+        }
+    }
+
+    return false;
+}
+
+void TranslatorImpl::tail_call(llvm::Function *callee, const Function<> &ty,
+                               std::vector<Value> &args, SourcePos pos) {
+    FunctionABI f_abi(ty, *module);
+
+    /* `musttail` requires the lowered signatures to match exactly, so that
+     * the callee's arguments fit where the caller's were passed. */
+    bool compatible = f_abi.get_type() == abi->get_type()
+                   && *ty.get_rettype() == *rettype;
+
+    for (unsigned i = 0; compatible && i < args.size(); ++i) {
+        // `byval` copies would live in the frame being released.
+        compatible = f_abi.get_arg(i).kind != ArgABI::INDIRECT;
+    }
+
+    if (!compatible) {
+        throw Error("type error", "cannot become a call to a function whose "
+                                  "arguments are passed differently from "
+                                  "the caller's", pos);
+    }
+
+    for (const auto &arg: args) {
+        if (points_into_frame(arg.to_llvm())) {
+            throw Error("error", "cannot become a call with an argument "
+                                 "which points into the caller's frame",
+                        pos);
+        }
+    }
+
+    std::vector<llvm::Value *>llvm_args;
+
+    // The caller's own return slot is passed on.
+    if (f_abi.get_ret().kind == ArgABI::INDIRECT) {
+        llvm_args.push_back(&*current->get_parent()->arg_begin());
+    }
+
+    lower_args(f_abi, args, llvm_args);
+
+    auto *inst = builder.CreateCall(callee, llvm_args);
+    f_abi.add_attributes(inst);
+    inst->setTailCallKind(llvm::CallInst::TCK_MustTail);
+
+    if (inst->getType()->isVoidTy()) {
+        current->return_();
+    } else {
+        current->return_(inst);
+    }
+}
+
+llvm::AllocaInst *TranslatorImpl::create_temporary(llvm::Type *t,
+                                                   const std::string &name) {
+    auto &entry = current->get_parent()->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+
+    return entry_builder.CreateAlloca(t, nullptr, name);
+}
+
+void TranslatorImpl::pop_locals(void) {
+    const auto &locals = env.get_locals();
+
+    // Code after a return is never reached, so needs no markers.
+    if (!locals.empty() && !current->is_terminated()) {
+        auto &layout = module->getDataLayout();
+
+        for (auto it = locals.rbegin(); it != locals.rend(); ++it) {
+            auto size = layout.getTypeAllocSize((*it)->getAllocatedType());
+            builder.CreateLifetimeEnd(*it, builder.getInt64(size));
+        }
+    }
+
+    env.pop();
+}
+
+llvm::AllocaInst *TranslatorImpl::coerce_temporary(llvm::Type *t,
+                                                   llvm::Type *coerce_to) {
+    auto *tmp = create_temporary(t);
+    auto &layout = module->getDataLayout();
+
+    tmp->setAlignment(std::max(layout.getABITypeAlignment(t),
+                               layout.getABITypeAlignment(coerce_to)));
+
+    return tmp;
+}
+
+std::vector<llvm::Value *>
+TranslatorImpl::load_coerced(llvm::Value *addr, llvm::Type *coerce_to) {
+    auto *cast = builder.CreateBitCast(addr, coerce_to->getPointerTo());
+    std::vector<llvm::Value *> parts;
+
+    // Each part is loaded separately: the coerced struct may have more
+    // padding than the memory it is loaded from.
+    if (auto *st = llvm::dyn_cast<llvm::StructType>(coerce_to)) {
+        for (unsigned i = 0; i < st->getNumElements(); ++i) {
+            auto *gep = builder.CreateStructGEP(st, cast, i);
+            parts.push_back(builder.CreateLoad(st->getElementType(i), gep));
+        }
+    } else {
+        parts.push_back(builder.CreateLoad(coerce_to, cast));
+    }
+
+    return parts;
+}
+
+void TranslatorImpl::store_coerced(llvm::Value *addr, llvm::Type *coerce_to,
+                                   const std::vector<llvm::Value *> &parts) {
+    auto *cast = builder.CreateBitCast(addr, coerce_to->getPointerTo());
+
+    if (auto *st = llvm::dyn_cast<llvm::StructType>(coerce_to)) {
+        for (unsigned i = 0; i < st->getNumElements(); ++i) {
+            builder.CreateStore(parts[i], builder.CreateStructGEP(st, cast, i));
+        }
+    } else {
+        builder.CreateStore(parts[0], cast);
+    }
+}
+
+Value TranslatorImpl::string_literal(const std::string &str) {
+    auto &global = string_pool[str];
+
+    if (!global) {
+        auto *init = llvm::ConstantDataArray::getString(context, str);
+        global = new llvm::GlobalVariable(*module, init->getType(), true,
+                                          llvm::GlobalValue::PrivateLinkage,
+                                          init, ".str");
+        global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    }
+
+    llvm::Constant *idxs[] = { builder.getInt32(0), builder.getInt32(0) };
+    auto *result = llvm::ConstantExpr::getInBoundsGetElementPtr(
+            global->getValueType(), global, idxs);
+
+    return Value(result, Pointer<Type>(UnsignedInt(8)));
+}
+
+Value TranslatorImpl::array_literal(std::vector<Value> &elements,
+                                    SourcePos pos) {
+    assert(!elements.empty());
+
+    const auto &element = elements[0].get_type();
+    if (is_type<Void>(element) || is_type<Function<> >(element)) {
+        throw Error("type error", "invalid array element type", pos);
+    }
+
+    Array<> t(element, elements.size());
+
+    llvm::Value *result = llvm::UndefValue::get(to_llvm_type(t, *module));
+
+    for (unsigned i = 0; i < elements.size(); ++i) {
+        if (!(elements[i].get_type() == element)) {
+            throw Error("type error", "array elements must all have the same "
+                                      "type", pos);
+        }
+
+        result = builder.CreateInsertValue(result, elements[i].to_llvm(), i);
+    }
+
+    return Value(result, t);
+}
+
+/**
+ * @brief Get the LLVM equivalent of a symbol visibility.
+ */
+static llvm::GlobalValue::VisibilityTypes
+to_llvm_visibility(Visibility visibility) {
+    switch (visibility) {
+        case Visibility::HIDDEN:
+            return llvm::GlobalValue::HiddenVisibility;
+        case Visibility::PROTECTED:
+            return llvm::GlobalValue::ProtectedVisibility;
+        case Visibility::DEFAULT:
+            break;
+    }
+
+    return llvm::GlobalValue::DefaultVisibility;
+}
+
+void TranslatorImpl::create_global(const std::string &name, const Type &t,
+                                   const Value *init, bool is_const,
+                                   const GlobalAttributes &attrs,
+                                   SourcePos pos) {
+    auto *ty = get_sized_type(t, pos);
+
+    if (module->getNamedValue(name)) {
+        throw Error("error", "redefinition of \"" + name + "\"", pos);
+    }
+
+    llvm::Constant *value = llvm::Constant::getNullValue(ty);
+
+    if (init) {
+        if (!(init->get_type() == t)) {
+            throw Error("type error", "initializer does not match type of "
+                                      "global", pos);
+        }
+        value = llvm::cast<llvm::Constant>(init->to_llvm());
+    }
+
+    // Constants end up in read-only data, and the rest in data or BSS.  As
+    // with functions, only `pub` globals are visible outside the module.
+    auto linkage = attrs.is_public ? llvm::GlobalValue::ExternalLinkage
+                                   : llvm::GlobalValue::InternalLinkage;
+    auto *global = new llvm::GlobalVariable(*module, ty, is_const, linkage,
+                                            value, name);
+
+    if (attrs.is_public) {
+        global->setVisibility(to_llvm_visibility(attrs.visibility));
+    }
+
+    switch (attrs.tls) {
+        case TLSModel::NONE:
+            break;
+        case TLSModel::GENERAL_DYNAMIC:
+            global->setThreadLocalMode(
+                    llvm::GlobalValue::GeneralDynamicTLSModel);
+            break;
+        case TLSModel::LOCAL_DYNAMIC:
+            global->setThreadLocalMode(
+                    llvm::GlobalValue::LocalDynamicTLSModel);
+            break;
+        case TLSModel::INITIAL_EXEC:
+            global->setThreadLocalMode(
+                    llvm::GlobalValue::InitialExecTLSModel);
+            break;
+        case TLSModel::LOCAL_EXEC:
+            global->setThreadLocalMode(llvm::GlobalValue::LocalExecTLSModel);
+            break;
+    }
+
+    env.add_identifier(name, Value(global, Pointer<>(t)));
+}
+
+bool TranslatorImpl::in_registers(const std::string &name, const Type &t) {
+    return !address_taken.count(name)
+        && !is_type<Struct<> >(t) && !is_type<Array<> >(t);
+}
+
+Variable TranslatorImpl::declare(const std::string &varname, const Type &t) {
+    auto *ty = to_llvm_type(t, *module);
+
+    if (in_registers(varname, t)) {
+        auto id = ssa.add_variable(ty, varname);
+        return env.add_identifier(varname, Variable(t, id));
+    }
+
+    auto *alloca = create_temporary(ty, varname);
+
+    // The slot is only live from here to the end of the scope, so slots of
+    // variables in disjoint scopes may share stack space.
+    auto size = module->getDataLayout().getTypeAllocSize(ty);
+    builder.CreateLifetimeStart(alloca, builder.getInt64(size));
+    env.add_local(alloca);
+
+    return env.add_identifier(varname, Value(alloca, Pointer<>(t)));
+}
+
+void TranslatorImpl::assign(const std::string &varname, Value val,
+                            SourcePos pos) {
+    auto var = env.lookup_identifier(varname, pos);
+
+    if (!var.is_ssa()) {
+        add_store(var.get_val(), val, pos);
+        return;
+    }
+
+    if (val.to_llvm()->getType() != to_llvm_type(var.get_type(), *module)) {
+        throw Error("type error",
+                    "cannot assign to variable of different type",
+                    pos);
+    }
+
+    ssa.write(var.get_ssa_id(), current->to_llvm(), val.to_llvm());
+}
+
+void TranslatorImpl::create_function_prototype(Function<> f, std::string name,
+                                               const FunctionAttributes &attrs,
+                                               SourcePos pos) {
+    FunctionABI f_abi(f, *module);
+    auto *ll_f = f_abi.get_type();
+
+    // Several files compiled together may each declare the same function.
+    auto *result = module->getFunction(name);
+
+    if (!result) {
+        result = llvm::Function::Create(ll_f,
+                                        llvm::Function::ExternalLinkage,
+                                        name, module.get());
+        f_abi.add_attributes(result);
+    } else if (result->getFunctionType() != ll_f) {
+        throw Error("type error", "conflicting declarations of function \""
+                                + name + "\"", pos);
+    }
+
+    // A definition in this module decides the visibility for itself.
+    if (result->isDeclaration()
+     && attrs.visibility != Visibility::DEFAULT) {
+        result->setVisibility(to_llvm_visibility(attrs.visibility));
+    }
+
+    add_function_attributes(result, attrs);
+
+    env.add_identifier(name, Value(result, f));
+}
+
+void TranslatorImpl::add_function_attributes(
+        llvm::Function *f, const FunctionAttributes &attrs) {
+    if (attrs.cold) {
+        f->addFnAttr(llvm::Attribute::Cold);
+    }
+}
+
+void TranslatorImpl::create_and_start_function(
+        Function<> f, std::vector<std::string> args, std::string name,
+        const std::set<std::string> &address_taken,
+        const FunctionAttributes &attrs, SourcePos pos) {
+    // The descriptors of an erased template's type parameters come first.
+    auto n_erased = attrs.erased_parameters.size();
+    if (n_erased) {
+        f = with_descriptors(f, n_erased);
+    }
+
+    abi.reset(new FunctionABI(f, *module));
+    auto *ll_f = abi->get_type();
+
+    // Try to find the function already in the module.
+    auto *result = module->getFunction(name);
+
+    // If it's not there,
+    if (!result) {
+        // generate it.
+        result = llvm::Function::Create(ll_f,
+                                        llvm::Function::ExternalLinkage,
+                                        name, module.get());
+        abi->add_attributes(result);
+    } else if (!result->empty()) {
+        throw Error("error", "redefinition of function \"" + name + "\"",
+                    pos);
+    } else if (result->getFunctionType() != ll_f) {
+        throw Error("type error", "definition of function \"" + name
+                                + "\" does not match its declaration", pos);
+    }
+
+    // Every module using a specialization defines its own copy, of which
+    // the linker keeps one; its name tells apart different templates which
+    // share a name in different modules.  Only `pub` functions are otherwise visible
+    // outside the module; the rest may be inlined, specialized and deleted
+    // freely.
+    if (attrs.is_specialization) {
+        result->setLinkage(llvm::GlobalValue::LinkOnceODRLinkage);
+        result->setVisibility(to_llvm_visibility(attrs.visibility));
+
+        // Copies referenced from other sections are discarded with them.
+        if (llvm::Triple(module->getTargetTriple()).supportsCOMDAT()) {
+            result->setComdat(module->getOrInsertComdat(name));
+        }
+    } else if (attrs.is_public) {
+        result->setLinkage(llvm::GlobalValue::ExternalLinkage);
+        result->setVisibility(to_llvm_visibility(attrs.visibility));
+    } else {
+        result->setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+
+    add_function_attributes(result, attrs);
+
+    env.add_identifier(name, Value(result, f));
+
+    if (attrs.is_specialization) {
+        current_specialization = name;
+        specialization_start = std::chrono::steady_clock::now();
+    }
+
+    // Create the first block in the function.
+    point(Block(result, "entry"));
+    ssa.seal(current->to_llvm());
+    this->address_taken = address_taken;
+
+    // Push a new namespace for the function.
+    env.push();
+
+    for (unsigned i = 0; i < n_erased; ++i) {
+        const auto &name = attrs.erased_parameters[i];
+        auto param = std::next(result->arg_begin(), abi->get_param(i));
+        param->setName("desc." + name);
+        erased_descriptors[name] = &*param;
+    }
+
+    for (unsigned i = 0; i < args.size(); ++i) {
+        auto &ty = f.get_args()[n_erased + i];
+        auto *ll_ty = to_llvm_type(*ty, *module);
+        auto &arg_abi = abi->get_arg(n_erased + i);
+        auto param = std::next(result->arg_begin(),
+                               abi->get_param(n_erased + i));
+        llvm::Value *arg_addr = nullptr;
+
+        switch (arg_abi.kind) {
+            case ArgABI::DIRECT:
+                if (in_registers(args[i], *ty)) {
+                    auto id = ssa.add_variable(ll_ty, args[i]);
+                    param->setName(args[i]);
+                    ssa.write(id, current->to_llvm(), &*param);
+                    env.add_identifier(args[i], Variable(*ty, id));
+                    continue;
+                }
+
+                arg_addr = builder.CreateAlloca(ll_ty);
+                builder.CreateStore(&*param, arg_addr);
+                break;
+            case ArgABI::COERCE: {
+                arg_addr = coerce_temporary(ll_ty, arg_abi.coerce_to);
+                auto *st = llvm::dyn_cast<llvm::StructType>(arg_abi.coerce_to);
+                std::vector<llvm::Value *> parts;
+                for (unsigned j = 0; j < (st ? st->getNumElements() : 1); ++j) {
+                    parts.push_back(&*param++);
+                }
+                store_coerced(arg_addr, arg_abi.coerce_to, parts);
+                break;
+            }
+            case ArgABI::INDIRECT:
+                // The caller has already made a copy for us.
+                arg_addr = &*param;
+                break;
+            case ArgABI::IGNORE:
+                arg_addr = builder.CreateAlloca(ll_ty);
+                break;
+        }
+
+        env.add_identifier(args[i], Value(arg_addr, Pointer<>(ty)));
+    }
+
+    if (rettype) {
+        // TODO: Fix this code.
+        SourcePos pos(0, 0, std::make_shared<std::string>(fname));
+        throw Error("internal error", "cannot start function while inside "
+                                      "function", pos);
+    }
+
+    rettype = f.get_rettype();
+}
+
+void TranslatorImpl::create_struct(Struct<> t) {
+    env.add_type(t.get_name(), t);
+}
+
+void TranslatorImpl::set_source_file(std::string filename) {
+    fname = filename;
+}
+
+std::vector< std::pair< std::vector<Type>, TemplateValue> >
+TranslatorImpl::end_function(void) {
+    env.pop();
+
+    // Add implicit void returns.
+    if (is_type<Void>(*rettype) && !current->is_terminated()) {
+        return_(SourcePos(0, 0, std::make_shared<std::string>(fname)));
+    }
+
+    if (!current_specialization.empty()) {
+        auto &stats = specialization_stats[current_specialization];
+        stats.time += std::chrono::steady_clock::now() - specialization_start;
+        stats.instructions = 0;
+        for (auto &bb: *module->getFunction(current_specialization)) {
+            stats.instructions += bb.size();
+        }
+        current_specialization.clear();
+    }
+
+    rettype = NULL;
+    abi.reset();
+    ssa.clear();
+    address_taken.clear();
+    erased_descriptors.clear();
+
+    auto saved_specializations = std::move(specializations);
+
+    specializations =
+        std::vector< std::pair< std::vector<Type>, TemplateValue > >();
+
+    return saved_specializations;
+}
+
+void TranslatorImpl::return_(Value val, SourcePos pos) {
+    auto &ret_abi = abi->get_ret();
+    auto *ret = val.to_llvm();
+
+    switch (ret_abi.kind) {
+        case ArgABI::DIRECT:
+            current->return_(val);
+            break;
+        case ArgABI::COERCE: {
+            auto *tmp = coerce_temporary(ret->getType(), ret_abi.coerce_to);
+            builder.CreateStore(ret, tmp);
+            auto parts = load_coerced(tmp, ret_abi.coerce_to);
+
+            llvm::Value *coerced = parts[0];
+            if (ret_abi.coerce_to->isStructTy()) {
+                coerced = llvm::UndefValue::get(ret_abi.coerce_to);
+                for (unsigned i = 0; i < parts.size(); ++i) {
+                    coerced = builder.CreateInsertValue(coerced, parts[i], i);
+                }
+            }
+
+            current->return_(coerced);
+            break;
+        }
+        case ArgABI::INDIRECT:
+            builder.CreateStore(ret, &*current->get_parent()->arg_begin());
+            current->return_();
+            break;
+        case ArgABI::IGNORE:
+            current->return_();
+            break;
+    }
+}
+
+void TranslatorImpl::return_(SourcePos pos) {
+    current->return_();
+}
+
+Value TranslatorImpl::get_identifier_addr(std::string ident, SourcePos pos) {
+    auto var = env.lookup_identifier(ident, pos);
+
+    if (var.is_ssa()) {
+        throw Error("internal error", "variable \"" + ident
+                                    + "\" is held in registers", pos);
+    }
+
+    return var.get_val();
+}
+
+Value TranslatorImpl::get_identifier_value(std::string ident, SourcePos pos) {
+    auto var = env.lookup_identifier(ident, pos);
+
+    if (var.is_ssa()) {
+        auto *val = ssa.read(var.get_ssa_id(), current->to_llvm());
+        return Value(val, var.get_type());
+    }
+
+    Value addr = get_identifier_addr(ident, pos);
+
+    assert(is_type<Pointer<> >(addr.get_type()));
+
+    // Scalar constants are used directly rather than loaded.
+    auto *global = llvm::dyn_cast<llvm::GlobalVariable>(addr.to_llvm());
+    if (global && global->isConstant()) {
+        auto *init = global->getInitializer();
+        if (llvm::isa<llvm::ConstantInt>(init)
+         || llvm::isa<llvm::ConstantFP>(init)) {
+            return get_constant_value(ident, pos);
+        }
+    }
+
+    return add_load(addr, pos);
+}
+
+Value TranslatorImpl::get_constant_value(std::string ident, SourcePos pos) {
+    if (env.lookup_identifier(ident, pos).is_ssa()) {
+        throw Error("error", "\"" + ident + "\" is not a constant", pos);
+    }
+
+    Value addr = get_identifier_addr(ident, pos);
+
+    auto *global = llvm::dyn_cast<llvm::GlobalVariable>(addr.to_llvm());
+    if (!global || !global->isConstant()) {
+        throw Error("error", "\"" + ident + "\" is not a constant", pos);
+    }
+
+    const auto &ptr_t = boost::get<Pointer<> >(addr.get_type());
+    return Value(global->getInitializer(), *ptr_t.get_pointed());
+}
+
+Type TranslatorImpl::lookup_type(std::string tname, SourcePos pos) {
     return env.lookup_type(tname, pos);
 }
 
 void TranslatorImpl::push_scope(void) { env.push(); }
-void TranslatorImpl::pop_scope(void) { env.pop(); }
+void TranslatorImpl::pop_scope(void) { pop_locals(); }
 void TranslatorImpl::bind_type(std::string name, Type t) {
     env.add_type(name, t);
 }
@@ -1418,14 +2530,87 @@ void TranslatorImpl::register_template(
                        std::string name,
                        std::shared_ptr<AST::FunctionDefinition> def,
                        std::vector<std::string> args,
-                       TemplateFunction func) {
-    env.add_template_func(name, TemplateValue(def, args, func));
+                       TemplateFunction func, bool erased) {
+    env.add_template_func(name, TemplateValue(def, args, func, erased));
+}
+
+std::string TranslatorImpl::specialization_name(
+        const TemplateValue &tv, const std::vector<Type> &args) {
+    // Hashed on first use, since parsing the body may have been deferred.
+    auto hash = template_hashes.find(tv.fd.get());
+    if (hash == template_hashes.end()) {
+        hash = template_hashes.emplace(
+                tv.fd.get(), AST::hash_template(tv.arg_names, *tv.fd)).first;
+    }
+
+    const auto &fname = tv.fd->signature().name();
+    return tv.erased ? erased_name(fname, hash->second)
+                     : mangle_name(fname, args, hash->second);
 }
 
 void TranslatorImpl::register_template(TemplateStruct str, std::string name) {
     env.add_template_type(name, str);
 }
 
+void TranslatorImpl::register_const_function(
+        std::string name, const AST::FunctionDefinition *def) {
+    env.add_const_func(name, def);
+}
+
+const AST::FunctionDefinition *TranslatorImpl::lookup_const_function(
+        std::string name) {
+    return env.lookup_const_func(name);
+}
+
+/**
+ * @brief Get the LLVM values of the given arguments.
+ */
+static std::vector<llvm::Value *> llvm_values(const std::vector<Value> &args) {
+    std::vector<llvm::Value *> result;
+    for (const auto &arg: args) {
+        result.push_back(arg.to_llvm());
+    }
+    return result;
+}
+
+void TranslatorImpl::mark_not_constant(const AST::FunctionDefinition *def,
+                                       const std::vector<Value> &args) {
+    not_constant_calls.insert(std::make_pair(def, llvm_values(args)));
+}
+
+bool TranslatorImpl::known_not_constant(const AST::FunctionDefinition *def,
+                                        const std::vector<Value> &args) {
+    return not_constant_calls.count(std::make_pair(def, llvm_values(args)));
+}
+
+bool TranslatorImpl::is_template_function(std::string name) {
+    return env.template_func_bound(name);
+}
+
+void TranslatorImpl::cond_jump(Value cond, Block then_b, Block else_b) {
+    auto *c = cond.to_llvm();
+    llvm::MDNode *weights = nullptr;
+
+    auto *expect = llvm::dyn_cast<llvm::IntrinsicInst>(c);
+    if (expect && expect->getIntrinsicID() == llvm::Intrinsic::expect
+               && c->getType()->isIntegerTy(1)) {
+        // The weights LLVM itself gives `llvm.expect`.
+        const uint32_t LIKELY = 2000, UNLIKELY = 1;
+
+        auto *expected = llvm::cast<llvm::ConstantInt>(
+                expect->getArgOperand(1));
+        llvm::MDBuilder md(module->getContext());
+        weights = expected->isOne()
+                ? md.createBranchWeights(LIKELY, UNLIKELY)
+                : md.createBranchWeights(UNLIKELY, LIKELY);
+
+        // Branch on the condition itself; the expectation is left unused.
+        cond = Value(expect->getArgOperand(0), cond.get_type());
+    }
+
+    current->cond_jump(cond, then_b, else_b, weights);
+}
+
 IfThenElse TranslatorImpl::create_ifthenelse(Value cond, SourcePos pos) {
     auto *f = builder.GetInsertBlock()->getParent();
 
@@ -1433,7 +2618,9 @@ IfThenElse TranslatorImpl::create_ifthenelse(Value cond, SourcePos pos) {
                                                    Block(f, "else"),
                                                    Block(f, "merge"));
 
-    current->cond_jump(cond, result->then_b, result->else_b);
+    cond_jump(cond, result->then_b, result->else_b);
+    ssa.seal(result->then_b.to_llvm());
+    ssa.seal(result->else_b.to_llvm());
 
     // Push a new namespace.
     env.push();
@@ -1448,10 +2635,10 @@ void TranslatorImpl::point_to_else(IfThenElse &structure) {
     auto &pimpl = structure.pimpl;
 
     // Pop the "then" namespace.
-    env.pop();
+    pop_locals();
 
     if (!current->is_terminated()) {
-        current->jump_to(pimpl->else_b);
+        current->jump_to(pimpl->merge_b);
     }
 
     // Push a namespace for "else".
@@ -1462,23 +2649,358 @@ void TranslatorImpl::point_to_else(IfThenElse &structure) {
 void TranslatorImpl::end_ifthenelse(IfThenElse structure) {
     auto pimpl = std::move(structure.pimpl);
     // Pop the "else" namespace.
-    env.pop();
+    pop_locals();
 
     if (!current->is_terminated()) {
         current->jump_to(pimpl->merge_b);
     }
 
+    ssa.seal(pimpl->merge_b.to_llvm());
     point(pimpl->merge_b);
 }
 
+Loop TranslatorImpl::create_loop(LoopHints hints, SourcePos pos) {
+    auto *f = builder.GetInsertBlock()->getParent();
+
+    auto result = std::make_unique<LoopImpl>(Block(f, "loop"),
+                                             Block(f, "body"),
+                                             Block(f, "exit"),
+                                             loop_metadata(hints));
+
+    current->jump_to(result->header);
+
+    // Start emitting the condition at the header.
+    point(result->header);
+
+    return Loop(std::move(result));
+}
+
+void TranslatorImpl::loop_condition(Loop &structure, Value cond,
+                                    SourcePos pos) {
+    auto &pimpl = structure.pimpl;
+
+    if (!cond.to_llvm()->getType()->isIntegerTy(1)) {
+        throw Error("type error", "loop condition must be a U1", pos);
+    }
+
+    cond_jump(cond, pimpl->body, pimpl->exit);
+
+    // The header is only sealed once the latch has jumped back to it.
+    ssa.seal(pimpl->body.to_llvm());
+    ssa.seal(pimpl->exit.to_llvm());
+
+    // Push a namespace for the body.
+    env.push();
+    point(pimpl->body);
+}
+
+void TranslatorImpl::end_loop(Loop structure) {
+    auto pimpl = std::move(structure.pimpl);
+    // Pop the body namespace.
+    pop_locals();
+
+    if (!current->is_terminated()) {
+        current->jump_to(pimpl->header);
+
+        // The loop passes find hints on the branch of the latch.
+        if (pimpl->hints) {
+            current->to_llvm()->getTerminator()
+                   ->setMetadata(llvm::LLVMContext::MD_loop, pimpl->hints);
+        }
+    }
+
+    ssa.seal(pimpl->header.to_llvm());
+
+    point(pimpl->exit);
+}
+
+bool TranslatorImpl::is_terminated(void) {
+    return current->is_terminated();
+}
+
+ShortCircuit TranslatorImpl::create_short_circuit(Value lhs, bool is_and,
+                                                  SourcePos pos) {
+    if (!is_u1(lhs)) {
+        throw Error("type error", "logical operations only allowed between "
+                                  "U1s", pos);
+    }
+
+    auto *f = builder.GetInsertBlock()->getParent();
+
+    // Create the blocks in order, so that they are laid out that way.
+    Block rhs_b(f, is_and ? "and.rhs" : "or.rhs");
+    Block merge_b(f, is_and ? "and.end" : "or.end");
+
+    auto result = std::make_unique<ShortCircuitImpl>(
+            rhs_b, merge_b, current->to_llvm(), is_and);
+
+    // Only `true && ...` and `false || ...` need the right-hand side.
+    if (is_and) {
+        cond_jump(lhs, result->rhs_b, result->merge_b);
+    } else {
+        cond_jump(lhs, result->merge_b, result->rhs_b);
+    }
+
+    ssa.seal(result->rhs_b.to_llvm());
+
+    point(result->rhs_b);
+
+    return ShortCircuit(std::move(result));
+}
+
+Value TranslatorImpl::end_short_circuit(ShortCircuit structure, Value rhs,
+                                        SourcePos pos) {
+    auto pimpl = std::move(structure.pimpl);
+
+    if (!is_u1(rhs)) {
+        throw Error("type error", "logical operations only allowed between "
+                                  "U1s", pos);
+    }
+
+    // The right-hand side may itself have branched, so it ends in whichever
+    // block is current now.
+    auto *rhs_end = current->to_llvm();
+    current->jump_to(pimpl->merge_b);
+    ssa.seal(pimpl->merge_b.to_llvm());
+    point(pimpl->merge_b);
+
+    auto *phi = builder.CreatePHI(builder.getInt1Ty(), 2);
+    phi->addIncoming(builder.getInt1(!pimpl->is_and), pimpl->lhs_b);
+    phi->addIncoming(rhs.to_llvm(), rhs_end);
+
+    return Value(phi, rhs.get_type());
+}
+
+llvm::MDNode *TranslatorImpl::loop_metadata(const LoopHints &hints) {
+    std::vector<llvm::Metadata *> ops;
+
+    // A loop ID refers to itself, so that it is distinct from any other
+    // loop's; fill in the first operand once the node exists.
+    auto self = llvm::MDNode::getTemporary(context, llvm::None);
+    ops.push_back(self.get());
+
+    auto hint = [&](const char *name, llvm::Constant *val) {
+        std::vector<llvm::Metadata *> hint_ops;
+        hint_ops.push_back(llvm::MDString::get(context, name));
+        if (val) hint_ops.push_back(llvm::ConstantAsMetadata::get(val));
+        ops.push_back(llvm::MDNode::get(context, hint_ops));
+    };
+
+    if (hints.unroll_count == 1) {
+        hint("llvm.loop.unroll.disable", nullptr);
+    } else if (hints.unroll_count) {
+        hint("llvm.loop.unroll.count", builder.getInt32(hints.unroll_count));
+    } else if (hints.unroll) {
+        hint("llvm.loop.unroll.enable", nullptr);
+    }
+
+    if (hints.vectorize) {
+        hint("llvm.loop.vectorize.enable", builder.getTrue());
+        if (hints.vectorize_width) {
+            hint("llvm.loop.vectorize.width",
+                 builder.getInt32(hints.vectorize_width));
+        }
+    }
+
+    if (ops.size() == 1) return nullptr;
+
+    auto *result = llvm::MDNode::get(context, ops);
+    result->replaceOperandWith(0, result);
+    return result;
+}
+
 void TranslatorImpl::validate(std::ostream &out) {
     llvm::raw_os_ostream ll_out(out);
     llvm::verifyModule(*module, &ll_out);
 }
 
+void TranslatorImpl::internalize(const std::vector<std::string> &exports) {
+    std::set<std::string> keep(exports.begin(), exports.end());
+
+    for (auto &f: module->functions()) {
+        if (!f.isDeclaration() && !keep.count(f.getName().str())) {
+            f.setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
+
+    for (auto &g: module->globals()) {
+        if (!g.hasLocalLinkage() && !keep.count(g.getName().str())) {
+            g.setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
+}
+
+/**
+ * @brief While in scope, point the calls in a function straight at their
+ *        callees rather than through pointer casts.
+ *
+ * A shared specialization is replaced by a cast of the one it shares, and
+ * FunctionComparator tells a call through that cast from a direct call.  The
+ * IR is only well-typed again once the casts are restored.
+ */
+class DirectCalls {
+public:
+    DirectCalls(llvm::Function &f) {
+        for (auto &inst: llvm::instructions(f)) {
+            auto *call = llvm::dyn_cast<llvm::CallInst>(&inst);
+            if (!call) continue;
+
+            auto *callee = call->getCalledValue();
+            auto *stripped = callee->stripPointerCasts();
+            if (stripped == callee) continue;
+
+            // The callee is the last operand.  Setting it directly keeps
+            // the call's type, which setCalledFunction would check.
+            casts.push_back(std::make_pair(call, callee));
+            call->setOperand(call->getNumOperands() - 1, stripped);
+        }
+    }
+
+    ~DirectCalls(void) {
+        for (auto &cast: casts) {
+            auto *call = cast.first;
+            call->setOperand(call->getNumOperands() - 1, cast.second);
+        }
+    }
+
+private:
+    std::vector<std::pair<llvm::CallInst *, llvm::Value *>> casts;
+};
+
+void TranslatorImpl::share_specializations(void) {
+    // Numbering of the globals the specializations refer to.
+    llvm::GlobalNumberState numbers;
+
+    // Two callers only compare equal once their callees have been shared,
+    // so repeat until there is nothing more to share.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (const auto &entry: layout_classes) {
+            std::vector<llvm::Function *> distinct;
+
+            for (const auto &name: entry.second) {
+                auto *f = module->getFunction(name);
+                if (!f || f->isDeclaration()) continue;
+
+                std::vector<llvm::Function *>::iterator same;
+                {
+                    DirectCalls direct(*f);
+                    same = std::find_if(distinct.begin(), distinct.end(),
+                                        [&](llvm::Function *other) {
+                        DirectCalls other_direct(*other);
+                        return llvm::FunctionComparator(other, f, &numbers)
+                                   .compare() == 0;
+                    });
+                }
+
+                if (same == distinct.end()) {
+                    distinct.push_back(f);
+                    continue;
+                }
+
+                specialization_stats[name].shared_with
+                    = (*same)->getName().str();
+
+                // Pointer arguments may differ in type, but not in value.
+                numbers.erase(f);
+                f->replaceAllUsesWith(
+                    llvm::ConstantExpr::getBitCast(*same, f->getType()));
+                f->eraseFromParent();
+                changed = true;
+            }
+        }
+    }
+}
+
+void TranslatorImpl::use_fast_calls(void) {
+    std::set<llvm::Function *> fast;
+
+    for (auto &f: module->functions()) {
+        if (f.isDeclaration() || !f.hasLocalLinkage()) continue;
+
+        // Calls through pointers use the C convention.
+        bool direct = std::all_of(f.use_begin(), f.use_end(),
+                                  [](const llvm::Use &use) {
+            auto *call = llvm::dyn_cast<llvm::CallInst>(use.getUser());
+            // The callee is a call's last operand.
+            return call
+                && use.getOperandNo() == call->getNumOperands() - 1;
+        });
+
+        if (direct) fast.insert(&f);
+    }
+
+    // Dropping a function may break agreement with one it becomes, so
+    // repeat until no more are dropped.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (auto &f: module->functions()) {
+            for (auto &inst: llvm::instructions(f)) {
+                auto *call = llvm::dyn_cast<llvm::CallInst>(&inst);
+                if (!call || !call->isMustTailCall()) continue;
+
+                auto *callee = call->getCalledFunction();
+                if (fast.count(&f) != fast.count(callee)) {
+                    fast.erase(&f);
+                    fast.erase(callee);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (auto *f: fast) {
+        f->setCallingConv(llvm::CallingConv::Fast);
+
+        for (auto *user: f->users()) {
+            llvm::cast<llvm::CallInst>(user)
+                ->setCallingConv(llvm::CallingConv::Fast);
+        }
+    }
+}
+
+void TranslatorImpl::instrument_profile(const std::string &out_file) {
+    llvm::legacy::PassManager pm;
+
+    // Insert counters on a spanning tree of each function's CFG,
+    pm.add(llvm::createPGOInstrumentationGenLegacyPass());
+
+    // and lower them to the profile runtime's data structures.
+    llvm::InstrProfOptions options;
+    options.InstrProfileOutput = out_file;
+    pm.add(llvm::createInstrProfilingLegacyPass(options));
+
+    pm.run(*module);
+}
+
+void TranslatorImpl::use_profile(const std::string &profile) {
+    llvm::legacy::PassManager pm;
+    pm.add(llvm::createPGOInstrumentationUseLegacyPass(profile));
+    pm.run(*module);
+}
+
 void TranslatorImpl::optimize(int opt_level) {
+    // Specializations sharing code are folded, and calls between internal
+    // functions need not follow the C convention, even unoptimized.
+    share_specializations();
+    use_fast_calls();
+
     auto fpm = std::make_unique<llvm::legacy::PassManager>();
+    // Cost models for the vectorizer and unroller.
+    fpm->add(llvm::createTargetTransformInfoWrapperPass(
+                target->getTargetIRAnalysis()));
     if (opt_level >= 1) {
+        // Propagate constant arguments and return values across calls, and
+        // drop arguments no caller uses.  Both only touch functions with
+        // internal linkage, so are most effective on a whole program.
+        fpm->add(llvm::createIPSCCPPass());
+        fpm->add(llvm::createDeadArgEliminationPass());
+        // Inline small and single-use functions.
+        fpm->add(llvm::createFunctionInliningPass(opt_level, 0, false));
         // Iterated dominance frontier to convert most `alloca`s to SSA
         // register accesses.
         fpm->add(llvm::createPromoteMemoryToRegisterPass());
@@ -1491,6 +3013,21 @@ void TranslatorImpl::optimize(int opt_level) {
         fpm->add(llvm::createCFGSimplificationPass());
         // Tail call elimination.
         fpm->add(llvm::createTailCallEliminationPass());
+        // Canonicalize loops and hoist invariant code out of them,
+        fpm->add(llvm::createLoopRotatePass());
+        fpm->add(llvm::createLICMPass());
+        fpm->add(llvm::createIndVarSimplifyPass());
+        // then vectorize and unroll them, as hinted or as the target's cost
+        // model suggests,
+        fpm->add(llvm::createLoopVectorizePass());
+        fpm->add(llvm::createLoopUnrollPass(opt_level));
+        // and clean up after them.
+        fpm->add(llvm::createInstructionCombiningPass());
+        fpm->add(llvm::createCFGSimplificationPass());
+        // Fold functions which optimized to the same code.
+        fpm->add(llvm::createMergeFunctionsPass());
+        // Delete internal functions which are no longer called.
+        fpm->add(llvm::createGlobalDCEPass());
     }
 
     fpm->run(*module);
@@ -1527,6 +3064,160 @@ void TranslatorImpl::emit_obj(int fd) {
     llvm_out.flush();
 }
 
+void TranslatorImpl::emit_bc(int fd, bool thin_lto) {
+    llvm::raw_fd_ostream llvm_out(fd, false);
+    llvm::legacy::PassManager pass;
+
+    if (thin_lto) {
+        // Also computes and writes the module summary ThinLTO links with.
+        pass.add(llvm::createWriteThinLTOBitcodePass(llvm_out));
+    } else {
+        pass.add(llvm::createBitcodeWriterPass(llvm_out));
+    }
+
+    pass.run(*module);
+    llvm_out.flush();
+}
+
+void TranslatorImpl::record_call(const std::string &name,
+                                 const std::string &func, SourcePos pos) {
+    auto &stats = specialization_stats[name];
+    stats.template_name = func;
+    stats.call_sites.push_back(pos);
+}
+
+std::map<std::string, uint64_t> TranslatorImpl::machine_code_sizes(void) {
+    std::map<std::string, uint64_t> result;
+
+    // Code generation changes the IR, so compile a copy.
+    auto copy = llvm::CloneModule(module.get());
+
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream llvm_out(buffer);
+    llvm::legacy::PassManager pass;
+    auto ft = llvm::TargetMachine::CGFT_ObjectFile;
+
+    if (target->addPassesToEmitFile(pass, llvm_out, ft)) {
+        llvm::errs() << "TargetMachine can't emit a file of this type";
+        return result;
+    }
+
+    pass.run(*copy);
+
+    llvm::MemoryBufferRef ref(llvm::StringRef(buffer.data(), buffer.size()),
+                              module->getName());
+    auto obj = llvm::object::ObjectFile::createObjectFile(ref);
+    if (!obj) {
+        llvm::consumeError(obj.takeError());
+        return result;
+    }
+
+    // Symbols may carry a prefix (such as `_` on Mach-O).
+    auto prefix = module->getDataLayout().getGlobalPrefix();
+
+    for (const auto &pair: llvm::object::computeSymbolSizes(**obj)) {
+        auto name = pair.first.getName();
+        if (!name) {
+            llvm::consumeError(name.takeError());
+            continue;
+        }
+
+        auto str = name->str();
+        if (prefix && !str.empty() && str[0] == prefix) {
+            str.erase(0, 1);
+        }
+
+        result[str] += pair.second;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Format a duration in milliseconds.
+ */
+static std::string format_ms(std::chrono::duration<double> time) {
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(3) << time.count() * 1000
+           << " ms";
+    return result.str();
+}
+
+void TranslatorImpl::write_template_report(std::ostream &out) {
+    auto sizes = machine_code_sizes();
+
+    auto bytes_of = [&](const std::string &name) -> uint64_t {
+        auto size = sizes.find(name);
+        return size == sizes.end() ? 0 : size->second;
+    };
+
+    std::map<std::string, std::vector<std::string> > by_template;
+    for (const auto &entry: specialization_stats) {
+        by_template[entry.second.template_name].push_back(entry.first);
+    }
+
+    // The largest templates, and specializations, come first.
+    std::vector<std::pair<uint64_t, std::string> > templates;
+    for (const auto &name: env.template_func_names()) {
+        uint64_t bytes = 0;
+        for (const auto &specialization: by_template[name]) {
+            bytes += bytes_of(specialization);
+        }
+        templates.push_back(std::make_pair(bytes, name));
+    }
+
+    std::stable_sort(templates.begin(), templates.end(),
+                     [](const std::pair<uint64_t, std::string> &l,
+                        const std::pair<uint64_t, std::string> &r) {
+        return l.first > r.first;
+    });
+
+    for (const auto &templ: templates) {
+        auto &names = by_template[templ.second];
+
+        std::stable_sort(names.begin(), names.end(),
+                         [&](const std::string &l, const std::string &r) {
+            return bytes_of(l) > bytes_of(r);
+        });
+
+        unsigned instructions = 0;
+        std::chrono::duration<double> time(0);
+        for (const auto &name: names) {
+            instructions += specialization_stats[name].instructions;
+            time += specialization_stats[name].time;
+        }
+
+        out << templ.second << ": " << names.size() << " specialization"
+            << (names.size() == 1 ? "" : "s") << ", " << instructions
+            << " IR instructions, " << templ.first << " bytes, generated in "
+            << format_ms(time) << "\n";
+
+        for (const auto &name: names) {
+            const auto &stats = specialization_stats[name];
+
+            out << "    " << name << ": " << stats.instructions
+                << " IR instructions, ";
+
+            if (!stats.shared_with.empty()) {
+                out << "shared with " << stats.shared_with;
+            } else if (sizes.count(name)) {
+                out << sizes[name] << " bytes";
+            } else {
+                out << "inlined or removed";
+            }
+
+            out << ", generated in " << format_ms(stats.time) << "\n";
+
+            out << "        called from";
+            for (const auto &pos: stats.call_sites) {
+                out << " " << *pos.fname << ":" << pos.lineno << ":"
+                    << pos.charno;
+            }
+            out << "\n";
+        }
+    }
+}
+
 void TranslatorImpl::point(Block b) {
     current.reset(new Block(b));
 
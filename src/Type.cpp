@@ -20,8 +20,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <iomanip>
+
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/xxhash.h"
 
 #include "Type.hh"
 
@@ -88,6 +91,17 @@ llvm::Type *Void::to_llvm(llvm::LLVMContext &ctx) const {
     return llvm::Type::getVoidTy(ctx);
 }
 
+/*****************************************************************************
+ * Erased type parameters.
+ */
+
+Erased::Erased(std::string name): name(name) {}
+
+llvm::Type *Erased::to_llvm(llvm::LLVMContext &ctx) const {
+    // Only ever pointed to, and addressed in bytes.
+    return llvm::Type::getInt8Ty(ctx);
+}
+
 /*****************************************************************************
  * Conversion to LLVM.
  */
@@ -119,6 +133,16 @@ struct ToLlvmVisitor: public boost::static_visitor<llvm::Type *> {
                                             mod));
     }
 
+    llvm::Type *operator()(const Vector<Type> &vec) const {
+        return llvm::VectorType::get(to_llvm_type(*vec.get_element(), mod),
+                                     vec.get_length());
+    }
+
+    llvm::Type *operator()(const Array<Type> &arr) const {
+        return llvm::ArrayType::get(to_llvm_type(*arr.get_element(), mod),
+                                    arr.get_length());
+    }
+
     llvm::Type *operator()(const Struct<Type> &str) const {
         auto *result = mod.getTypeByName(str.get_name());
         if (result) {
@@ -184,6 +208,16 @@ struct NamingVisitor: public boost::static_visitor<std::string> {
         return std::string("$") + get_name(*ptr.get_pointed()) + "$";
     }
 
+    std::string operator()(const Vector<Type> &vec) const {
+        return "vec" + std::to_string(vec.get_length())
+             + "$" + get_name(*vec.get_element()) + "$";
+    }
+
+    std::string operator()(const Array<Type> &arr) const {
+        return "arr" + std::to_string(arr.get_length())
+             + "$" + get_name(*arr.get_element()) + "$";
+    }
+
     std::string operator()(const Function<Type> &func) const {
         std::stringstream result;
 
@@ -204,12 +238,74 @@ struct NamingVisitor: public boost::static_visitor<std::string> {
     std::string operator()(const Struct<Type> &str) const {
         return str.get_name();
     }
+
+    std::string operator()(const Erased &e) const {
+        return "erased." + e.get_name();
+    }
 };
 
 std::string get_name(Type t) {
     return boost::apply_visitor(NamingVisitor(), t);
 }
 
+/*****************************************************************************
+ * Finding erased type parameters.
+ */
+
+/* Visitor finding erased type parameters, optionally looking behind
+ * pointers. */
+struct ErasedFinder: public boost::static_visitor<bool> {
+    ErasedFinder(bool through_pointers): through_pointers(through_pointers) {}
+
+    template<typename T>
+    bool operator()(const T &) const {
+        return false;
+    }
+
+    bool operator()(const Erased &) const {
+        return true;
+    }
+
+    bool operator()(const Pointer<Type> &ptr) const {
+        return through_pointers
+            && boost::apply_visitor(*this, *ptr.get_pointed());
+    }
+
+    bool operator()(const Vector<Type> &vec) const {
+        return boost::apply_visitor(*this, *vec.get_element());
+    }
+
+    bool operator()(const Array<Type> &arr) const {
+        return boost::apply_visitor(*this, *arr.get_element());
+    }
+
+    bool operator()(const Struct<Type> &str) const {
+        for (const auto &field: str.get_fields()) {
+            if (boost::apply_visitor(*this, *field.second)) return true;
+        }
+        return false;
+    }
+
+    bool operator()(const Function<Type> &func) const {
+        if (boost::apply_visitor(*this, *func.get_rettype())) return true;
+        for (const auto &arg: func.get_args()) {
+            if (boost::apply_visitor(*this, *arg)) return true;
+        }
+        return false;
+    }
+
+private:
+    bool through_pointers;
+};
+
+bool mentions_erased(const Type &t) {
+    return boost::apply_visitor(ErasedFinder(true), t);
+}
+
+bool has_erased_layout(const Type &t) {
+    return boost::apply_visitor(ErasedFinder(false), t);
+}
+
 /*****************************************************************************
  * Specializing template types.
  */
@@ -227,6 +323,16 @@ struct SpecializerTypeVisitor: public boost::static_visitor<Type> {
         return Pointer<Type>(specialize(*ptr.get_pointed(), args));
     }
 
+    Type operator()(const Vector<TemplateType> &vec) const {
+        return Vector<Type>(specialize(*vec.get_element(), args),
+                            vec.get_length());
+    }
+
+    Type operator()(const Array<TemplateType> &arr) const {
+        return Array<Type>(specialize(*arr.get_element(), args),
+                           arr.get_length());
+    }
+
     Struct<Type> operator()(const Struct<TemplateType> &str) const {
         std::vector<std::pair<std::string,
                               std::shared_ptr<Type> > >fields;
@@ -289,6 +395,18 @@ struct RespecializerTypeVisitor: public boost::static_visitor<TemplateType> {
         return Pointer<TemplateType>(std::make_shared<TemplateType>(pointed));
     }
 
+    TemplateType operator()(const Vector<TemplateType> &vec) const {
+        auto element = boost::apply_visitor(*this, *vec.get_element());
+        return Vector<TemplateType>(std::make_shared<TemplateType>(element),
+                                    vec.get_length());
+    }
+
+    TemplateType operator()(const Array<TemplateType> &arr) const {
+        auto element = boost::apply_visitor(*this, *arr.get_element());
+        return Array<TemplateType>(std::make_shared<TemplateType>(element),
+                                   arr.get_length());
+    }
+
     Struct<TemplateType> operator()(const Struct<TemplateType> &str) const {
         std::vector<std::pair<std::string,
                               std::shared_ptr<TemplateType> > >fields;
@@ -331,19 +449,99 @@ Type specialize(const TemplateType &temp, const std::vector<Type> &args) {
     return boost::apply_visitor(SpecializerTypeVisitor(args), temp);
 }
 
+/* Visitor naming a type along with the fields of any structs it mentions,
+ * even behind pointers. */
+struct DefinitionVisitor: public boost::static_visitor<std::string> {
+    template<typename T>
+    std::string operator()(const T &t) const {
+        return get_name(t);
+    }
+
+    std::string operator()(const Pointer<Type> &ptr) const {
+        return "$" + boost::apply_visitor(*this, *ptr.get_pointed()) + "$";
+    }
+
+    std::string operator()(const Vector<Type> &vec) const {
+        return "vec" + std::to_string(vec.get_length())
+             + "$" + boost::apply_visitor(*this, *vec.get_element()) + "$";
+    }
+
+    std::string operator()(const Array<Type> &arr) const {
+        return "arr" + std::to_string(arr.get_length())
+             + "$" + boost::apply_visitor(*this, *arr.get_element()) + "$";
+    }
+
+    std::string operator()(const Struct<Type> &str) const {
+        std::string result = str.get_name() + "{";
+
+        for (const auto &field: str.get_fields()) {
+            result += boost::apply_visitor(*this, *field.second) + ",";
+        }
+
+        return result + "}";
+    }
+};
+
+static std::string to_hex(uint64_t x) {
+    std::stringstream result;
+    result << std::hex << std::setw(16) << std::setfill('0') << x;
+    return result.str();
+}
+
 std::string mangle_name(std::string fname,
-                        const std::vector<Type> &args) {
+                        const std::vector<Type> &args,
+                        uint64_t template_hash) {
     std::stringstream namestream;
+    std::stringstream definitions;
 
     namestream << "FnTmpl." << fname;
+    definitions << template_hash;
 
     for (auto &arg: args) {
         namestream << "." << get_name(arg);
+        definitions << "." << boost::apply_visitor(DefinitionVisitor(), arg);
+    }
+
+    // Private templates and structs of the same names may differ between
+    // modules, and must then not be taken for the same specialization.
+    namestream << "." << to_hex(llvm::xxHash64(definitions.str()));
+
+    return namestream.str();
+}
+
+/* Get a name for the type shared by all types with its layout. */
+static std::string get_layout_name(const Type &t) {
+    if (boost::get<Pointer<> >(&t)) {
+        return "pointer";
+    }
+
+    if (auto *i = boost::get<SignedInt>(&t)) {
+        return "int" + std::to_string(i->get_nbits());
+    }
+
+    if (auto *u = boost::get<UnsignedInt>(&t)) {
+        return "int" + std::to_string(u->get_nbits());
+    }
+
+    return get_name(t);
+}
+
+std::string layout_class(std::string fname, const std::vector<Type> &args) {
+    std::stringstream namestream;
+
+    namestream << fname;
+
+    for (auto &arg: args) {
+        namestream << "." << get_layout_name(arg);
     }
 
     return namestream.str();
 }
 
+std::string erased_name(std::string fname, uint64_t template_hash) {
+    return "FnErased." + fname + "." + to_hex(template_hash);
+}
+
 /*****************************************************************************
  * Converting normal types to template types.
  */
@@ -379,6 +577,20 @@ public:
         return Pointer<TemplateType>(ptr);
     }
 
+    TemplateType operator()(const Vector<Type> &v) const {
+        auto element = boost::apply_visitor(*this, *v.get_element());
+
+        return Vector<TemplateType>(std::make_shared<TemplateType>(element),
+                                    v.get_length());
+    }
+
+    TemplateType operator()(const Array<Type> &a) const {
+        auto element = boost::apply_visitor(*this, *a.get_element());
+
+        return Array<TemplateType>(std::make_shared<TemplateType>(element),
+                                   a.get_length());
+    }
+
     Function<TemplateType> operator()(const Function<Type> &f) const {
         auto rettype = boost::apply_visitor(*this, *f.get_rettype());
         auto ptr = std::make_shared<TemplateType>(rettype);
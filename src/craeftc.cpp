@@ -7,6 +7,7 @@
 #include <boost/program_options.hpp>
 #include <boost/variant.hpp>
 
+#include "AST/Serialize.hh"
 #include "Parser.hh"
 #include "Codegen/Module.hh"
 
@@ -16,13 +17,54 @@ namespace opt = boost::program_options;
 static const int OBJFILE_MODE_BLAZEIT = 420;
 
 /**
- * @brief Pull a single AST out of the parser, and have the code generator
- *        visit it.
+ * @brief Pull every AST out of the parser, stopping at the first error.
  */
-bool handle_input(Craeft::Parser &p, Craeft::Codegen::ModuleGen &c) {
+bool parse_input(Craeft::Parser &p,
+                 std::vector<std::unique_ptr<Craeft::AST::Toplevel>> &asts) {
     try {
-        auto e = p.parse_toplevel();
-        c.codegen(*e);
+        /* Pull ASTs out of the parser until we hit EOF. */
+        while (!p.at_eof()) asts.push_back(p.parse_toplevel());
+        return true;
+    } catch (Craeft::Error e) {
+        e.emit(std::cerr);
+        return false;
+    }
+}
+
+/**
+ * @brief Get every AST in the given file, from its cache if it has a
+ *        current one.
+ *
+ * @param cache_file The file to cache the ASTs in, or empty for none.
+ */
+bool load_input(const std::string &in_file, const std::string &cache_file,
+                std::vector<std::unique_ptr<Craeft::AST::Toplevel>> &asts) {
+    /* Reuse the ASTs from a previous compilation if they are current, */
+    if (!cache_file.empty()
+     && Craeft::AST::read_ast_cache(cache_file, in_file, asts)) {
+        return true;
+    }
+
+    /* and otherwise construct a parser on that file. */
+    Craeft::Parser parser(in_file);
+    std::vector<std::unique_ptr<Craeft::AST::Toplevel>> parsed;
+    if (!parse_input(parser, parsed)) return false;
+
+    if (!cache_file.empty()) {
+        Craeft::AST::write_ast_cache(cache_file, in_file, parsed);
+    }
+
+    for (auto &ast: parsed) asts.push_back(std::move(ast));
+    return true;
+}
+
+/**
+ * @brief Have the code generator visit a single AST.
+ */
+bool handle_input(const Craeft::AST::Toplevel &ast,
+                  Craeft::Codegen::ModuleGen &c) {
+    try {
+        c.codegen(ast);
         return true;
     } catch (Craeft::Error e) {
         e.emit(std::cerr);
@@ -44,9 +86,41 @@ int main(int argc, char **argv) {
             "select output file to emit LLVM IR")
         ("asm,s", opt::value<std::string>(),
             "select output file to emit target-specific assembly")
+        ("emit-bc", opt::value<std::string>(),
+            "select output file to emit LLVM bitcode")
+        ("lto", opt::value<std::string>(),
+            "prepare output for link-time optimization: \"full\" or "
+            "\"thin\" (with a ThinLTO summary); object files are emitted "
+            "as bitcode")
         ("opt,O", opt::value<int>()->default_value(0),
             "select optimization level (default 0)")
-        ("in", opt::value<std::string>(), "select input file");
+        ("profile-generate",
+            opt::value<std::string>()->implicit_value(""),
+            "instrument the program to write an execution profile, "
+            "optionally to the given file (link with the LLVM profile "
+            "runtime)")
+        ("profile-use", opt::value<std::string>(),
+            "optimize using the given indexed execution profile")
+        ("ast-cache", opt::value<std::vector<std::string>>(),
+            "select a file to cache parsed ASTs in across compilations "
+            "(once per input file)")
+        ("whole-program",
+            "treat the input files as the whole program, internalizing "
+            "every function which is not exported")
+        ("export", opt::value<std::vector<std::string>>(),
+            "keep the given function externally visible with "
+            "--whole-program (default main)")
+        ("template-report",
+            opt::value<std::string>()->implicit_value(""),
+            "write a report of the specializations of each template, with "
+            "the calls which made them and their sizes and generation "
+            "times, to the given file (default standard error)")
+        ("visibility", opt::value<std::string>(),
+            "select the visibility of pub functions in a shared library: "
+            "\"default\", \"hidden\" (not exported from it) or "
+            "\"protected\"")
+        ("in", opt::value<std::vector<std::string>>(),
+            "select input files");
     opt::positional_options_description pos;
     pos.add("in", -1);
 
@@ -67,48 +141,144 @@ int main(int argc, char **argv) {
 
     int opt_level = opt_map["opt"].as<int>();
 
+    bool lto = false;
+    bool thin_lto = false;
+    if (opt_map.count("lto")) {
+        auto mode = opt_map["lto"].as<std::string>();
+        if (mode != "full" && mode != "thin") {
+            std::cerr << "--lto must be \"full\" or \"thin\"" << std::endl;
+            return 1;
+        }
+        lto = true;
+        thin_lto = mode == "thin";
+    }
+
+    auto visibility = Craeft::Visibility::DEFAULT;
+    if (opt_map.count("visibility")) {
+        auto name = opt_map["visibility"].as<std::string>();
+        if (name == "hidden") {
+            visibility = Craeft::Visibility::HIDDEN;
+        } else if (name == "protected") {
+            visibility = Craeft::Visibility::PROTECTED;
+        } else if (name != "default") {
+            std::cerr << "--visibility must be \"default\", \"hidden\" or "
+                         "\"protected\"" << std::endl;
+            return 1;
+        }
+    }
+
     /* If the user did good, */
     if (!opt_map.count("help")
-      && (opt_map.count("obj") || opt_map.count("ll") || opt_map.count("asm"))
+      && (opt_map.count("obj") || opt_map.count("ll") || opt_map.count("asm")
+       || opt_map.count("emit-bc"))
       && opt_map.count("in")) {
-        auto in_file = opt_map["in"].as<std::string>();
-        /* Get a code generator. */
-        Craeft::Codegen::ModuleGen codegen("Craeft module", in_file);
-        /* Construct a parser on that file. */
-        Craeft::Parser parser(in_file);
+        auto in_files = opt_map["in"].as<std::vector<std::string>>();
+        std::vector<std::string> cache_files;
+        if (opt_map.count("ast-cache")) {
+            cache_files = opt_map["ast-cache"].as<std::vector<std::string>>();
+            if (cache_files.size() != in_files.size()) {
+                std::cerr << "--ast-cache must be given once per input file"
+                          << std::endl;
+                return 1;
+            }
+        }
+
+        /* Get a code generator.  All of the input files are compiled
+         * into the one module. */
+        Craeft::Codegen::ModuleGen codegen("Craeft module", in_files[0]);
+        codegen.set_default_visibility(visibility);
+        std::vector<std::vector<std::unique_ptr<Craeft::AST::Toplevel>>>
+            asts(in_files.size());
+        for (unsigned i = 0; i < in_files.size(); ++i) {
+            auto cache_file = cache_files.empty()? "": cache_files[i];
+            if (!load_input(in_files[i], cache_file, asts[i])) return 2;
+        }
+
         bool successful = true;
-        /* Pull ASTs out of the parser */
-        while (successful) {
-            /* until we hit EOF. */
-            if (parser.at_eof()) break;
-            if (!handle_input(parser, codegen)) successful = false;
+        for (unsigned i = 0; i < in_files.size() && successful; ++i) {
+            codegen.set_source_file(in_files[i]);
+            for (const auto &ast: asts[i]) {
+                if (!handle_input(*ast, codegen)) {
+                    successful = false;
+                    break;
+                }
+            }
         }
 
         if (!successful) return 2;
 
         /* Validate the module. */
         codegen.validate(std::cerr);
+        if (opt_map.count("whole-program")) {
+            std::vector<std::string> exports { "main" };
+            if (opt_map.count("export")) {
+                exports = opt_map["export"].as<std::vector<std::string>>();
+            }
+            codegen.internalize(exports);
+        }
+        /* Instrument or annotate with profiles before optimizing. */
+        if (opt_map.count("profile-generate")) {
+            codegen.instrument_profile(
+                    opt_map["profile-generate"].as<std::string>());
+        }
+        if (opt_map.count("profile-use")) {
+            auto profile = opt_map["profile-use"].as<std::string>();
+            if (!std::ifstream(profile)) {
+                std::cerr << "cannot read profile \"" << profile << "\""
+                          << std::endl;
+                return 1;
+            }
+            codegen.use_profile(profile);
+        }
         /* Optimize the module to the chosen level. */
         codegen.optimize(opt_level);
 
+        /* Report on the specializations as they will be emitted. */
+        if (opt_map.count("template-report")) {
+            auto report = opt_map["template-report"].as<std::string>();
+            if (report.empty()) {
+                codegen.write_template_report(std::cerr);
+            } else {
+                std::ofstream out(report);
+                if (!out) {
+                    std::cerr << "cannot write template report \"" << report
+                              << "\"" << std::endl;
+                    return 1;
+                }
+                codegen.write_template_report(out);
+            }
+        }
+
         if (opt_map.count("obj")) {
             /* Open the output file (LLVM's stream formats are weird, so we
              * can't use regular STL stream classes). */
             int fd = open(opt_map["obj"].as<std::string>().c_str(),
-                          O_RDWR | O_CREAT,
+                          O_RDWR | O_CREAT | O_TRUNC,
                           OBJFILE_MODE_BLAZEIT);
-            /* Emit the object code. */
-            codegen.emit_obj(fd);
+            /* Emit the object code, which for LTO is just bitcode for the
+             * linker to optimize and compile. */
+            if (lto) {
+                codegen.emit_bc(fd, thin_lto);
+            } else {
+                codegen.emit_obj(fd);
+            }
             close(fd);
         }
         if (opt_map.count("asm")) {
             int fd = open(opt_map["asm"].as<std::string>().c_str(),
-                          O_RDWR | O_CREAT,
+                          O_RDWR | O_CREAT | O_TRUNC,
                           OBJFILE_MODE_BLAZEIT);
             /* Emit the assembly code. */
             codegen.emit_asm(fd);
             close(fd);
         }
+        if (opt_map.count("emit-bc")) {
+            int fd = open(opt_map["emit-bc"].as<std::string>().c_str(),
+                          O_RDWR | O_CREAT | O_TRUNC,
+                          OBJFILE_MODE_BLAZEIT);
+            codegen.emit_bc(fd, thin_lto);
+            close(fd);
+        }
         if (opt_map.count("ll")) {
             std::ofstream file(opt_map["ll"].as<std::string>());
             codegen.emit_ir(file);
@@ -2,9 +2,35 @@
 
 A craeftc integration test consists of three parts: a YAML configuration file, a
 file containing Craeft code, a C harness, and a file containing expected output.
+
+The configuration may also list further Craeft files to compile together with
+the first (`extra_code`), Craeft files to compile into objects of their own
+and link in (`separate_code`), and extra arguments to pass to craeftc
+(`flags`).
+
+A test of the AST cache may give `stale_code`, an earlier version of `code`
+of the same size.  It is compiled first with `--ast-cache`; `code` is then
+copied over it, keeping its modification time, and compiled with the same
+cache, so the test only passes if the edit is noticed.
+
+A test may also set `lto` to "full" or "thin" to compile its Craeft code to
+bitcode objects with that `--lto` mode.  These are then optimized together
+and compiled to native objects by `llvm-lto`, keeping only the symbols listed
+in `lto_exports` visible to the harness.
+
+`profile_text` names a text-format execution profile.  It is converted with
+`llvm-profdata` and the Craeft code compiled with `--profile-use`.
+
+`template_report` is a regular expression which the whole of the report
+written by `--template-report` must match.
+
+`ll_check` lists regular expressions which must each match somewhere in the
+LLVM IR written by `--ll` for the Craeft code.  The IR is emitted without the
+test's flags, so it is checked as generated, before any optimization.
 """
 
 import os
+import shutil
 import subprocess
 import tempfile
 import traceback
@@ -16,6 +42,8 @@ DIR = os.path.dirname(__file__)
 CRAEFT_PATH = os.path.join(DIR, '../../build/craeftc')
 CC = "cc"
 CFLAGS = ["-x", "c"]
+LLVM_LTO = "llvm-lto"
+LLVM_PROFDATA = "llvm-profdata"
 
 def temporary_filename():
     (obj, result) = tempfile.mkstemp()
@@ -58,6 +86,34 @@ class IntegrationTest(object):
         try_file("code")
         try_file("harness")
 
+        self.extra_code = [abs_of_conf_path(f)
+                           for f in parsed.get("extra_code", [])]
+        self.separate_code = [abs_of_conf_path(f)
+                              for f in parsed.get("separate_code", [])]
+        self.flags = [str(f) for f in parsed.get("flags", [])]
+        self.lto = parsed.get("lto")
+        if self.lto is not None:
+            self.flags.append("--lto=" + self.lto)
+        self.lto_exports = parsed.get("lto_exports", [])
+        self.profdata = None
+        if "profile_text" in parsed:
+            self.profdata = temporary_filename()
+            args = [LLVM_PROFDATA, "merge",
+                    abs_of_conf_path(parsed["profile_text"]),
+                    "-o", self.profdata]
+            assert_succeeded(args, "llvm-profdata invocation failed")
+            self.flags.append("--profile-use=" + self.profdata)
+        self.template_report = parsed.get("template_report")
+        self.report = temporary_filename()
+        if self.template_report is not None:
+            self.flags.append("--template-report=" + self.report)
+        self.ll_check = parsed.get("ll_check", [])
+        self.ll = temporary_filename()
+        try:
+            self.stale_code = abs_of_conf_path(parsed["stale_code"])
+        except KeyError:
+            self.stale_code = None
+
         try:
             with open(abs_of_conf_path(parsed["output"]), "r") as f:
                 self.expected = bytes(f.read(), 'utf-8')
@@ -65,16 +121,30 @@ class IntegrationTest(object):
             self.expected = bytes(parsed["output_text"], 'utf-8')
 
         self.code_obj = temporary_filename()
+        self.separate_objs = [temporary_filename() for f in self.separate_code]
         self.harness_obj = temporary_filename()
         self.exc = temporary_filename()
+        self.code_copy = temporary_filename()
+        self.ast_cache = temporary_filename()
+        self.lto_objs = []
 
     def __enter__(self):
         return self
 
     def __exit__(self, exc_type, exc_value, traceback):
         try_rm(self.code_obj)
+        for obj in self.separate_objs:
+            try_rm(obj)
         try_rm(self.harness_obj)
         try_rm(self.exc)
+        try_rm(self.code_copy)
+        try_rm(self.ast_cache)
+        for obj in self.lto_objs:
+            try_rm(obj)
+        if self.profdata is not None:
+            try_rm(self.profdata)
+        try_rm(self.report)
+        try_rm(self.ll)
 
         if self.del_code:
             try_rm(self.code)
@@ -82,17 +152,81 @@ class IntegrationTest(object):
         if self.del_harness:
             try_rm(self.harness)
 
+    def compile_stale(self):
+        """Fill the AST cache from `stale_code`, then edit it into `code`."""
+        shutil.copyfile(self.stale_code, self.code_copy)
+        args = [CRAEFT_PATH, self.code_copy, "--obj", self.code_obj]
+        args += ["--ast-cache", self.ast_cache] + self.flags
+        assert_succeeded(args, "craeftc invocation failed")
+
+        st = os.stat(self.code_copy)
+        shutil.copyfile(self.code, self.code_copy)
+        os.utime(self.code_copy, ns=(st.st_atime_ns, st.st_mtime_ns))
+
     def compile_craeft(self):
-        assert_succeeded([CRAEFT_PATH, self.code, "--obj", self.code_obj],
-                         "craeftc invocation failed")
+        code = self.code
+        flags = self.flags
+        if self.stale_code is not None:
+            self.compile_stale()
+            code = self.code_copy
+            flags = flags + ["--ast-cache", self.ast_cache]
+
+        args = [CRAEFT_PATH, code] + self.extra_code
+        args += ["--obj", self.code_obj] + flags
+        assert_succeeded(args, "craeftc invocation failed")
+
+        if self.template_report is not None:
+            self.check_template_report()
+
+        for (code, obj) in zip(self.separate_code, self.separate_objs):
+            args = [CRAEFT_PATH, code, "--obj", obj] + self.flags
+            assert_succeeded(args, "craeftc invocation failed")
+
+        if self.ll_check:
+            self.check_ll()
+
+    def check_ll(self):
+        args = [CRAEFT_PATH, self.code] + self.extra_code + ["--ll", self.ll]
+        assert_succeeded(args, "craeftc invocation failed")
+
+        with open(self.ll, "r") as f:
+            found = f.read()
+        msg = "LLVM IR incorrect: expected a match for {}; found {}"
+        for pattern in self.ll_check:
+            assert re.search(pattern, found), msg.format(pattern, found)
+
+    def check_template_report(self):
+        with open(self.report, "r") as f:
+            found = f.read()
+        msg = "template report incorrect: expected a match for {}; found {}"
+        assert re.fullmatch(self.template_report, found), \
+               msg.format(self.template_report, found)
 
     def compile_harness(self):
         args = [CC] + CFLAGS
         args += [self.harness, "-c", "-o", self.harness_obj]
         assert_succeeded(args, "compiler invocation failed")
 
+    def link_time_optimize(self):
+        """Compile the bitcode objects to native objects with `llvm-lto`."""
+        bitcode = [self.code_obj] + self.separate_objs
+        args = [LLVM_LTO] + bitcode
+        args += ["-exported-symbol=" + sym for sym in self.lto_exports]
+        if self.lto == "thin":
+            args.append("-thinlto-action=run")
+            self.lto_objs = [obj + ".thinlto.o" for obj in bitcode]
+        else:
+            self.lto_objs = [temporary_filename()]
+            args += ["-o", self.lto_objs[0]]
+        assert_succeeded(args, "llvm-lto invocation failed")
+
     def link(self):
-        assert_succeeded([CC, self.code_obj, self.harness_obj, "-o", self.exc],
+        objs = [self.code_obj] + self.separate_objs
+        if self.lto is not None:
+            self.link_time_optimize()
+            objs = self.lto_objs
+        objs = objs + [self.harness_obj]
+        assert_succeeded([CC] + objs + ["-o", self.exc],
                          "compiler linking invocation failed")
 
     def run_exc(self):
@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t histogram(uint8_t *data, uint64_t n, uint64_t *out);
+int32_t trace(void);
+int64_t sum_array(int64_t (*a)[4]);
+int64_t square(uint64_t i);
+char *pick(char *a, char *b, char *c);
+
+int main(void) {
+    uint8_t data[256];
+    uint64_t counts[8];
+    int64_t a[4] = {1, 20, 300, 4000};
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        data[i] = i * 7;
+    }
+
+    printf("%llu\n", (unsigned long long)histogram(data, 200, counts));
+    for (i = 0; i < 8; i++) {
+        printf("%llu ", (unsigned long long)counts[i]);
+    }
+    printf("\n");
+    printf("%d\n", trace());
+    printf("%lld\n", (long long)sum_array(&a));
+    printf("%lld\n", (long long)square(2));
+    printf("%s\n", pick("one", "three", "two"));
+}
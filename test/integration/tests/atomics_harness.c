@@ -0,0 +1,58 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+
+struct node {
+    uint64_t value;
+    struct node *next;
+};
+
+void hit(uint64_t n);
+uint64_t get_hits(void);
+void locked_add(uint32_t *l, uint64_t *total, uint64_t n);
+void push(struct node **head, struct node *node);
+uint64_t sum_stack(struct node **head);
+void extremes(int32_t *lo, int32_t *hi, int32_t x);
+
+#define THREADS 4
+#define N 100000
+
+static uint32_t the_lock;
+static uint64_t total;
+static struct node *head;
+static struct node nodes[THREADS][1000];
+
+static void *work(void *arg) {
+    struct node *mine = arg;
+
+    hit(N);
+    locked_add(&the_lock, &total, N);
+    for (int i = 0; i < 1000; ++i) {
+        mine[i].value = i;
+        push(&head, &mine[i]);
+    }
+
+    return NULL;
+}
+
+int main(void) {
+    pthread_t threads[THREADS];
+    int32_t lo = 0, hi = 0;
+    int32_t xs[4] = { 5, -7, 3, 12 };
+
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_create(&threads[i], NULL, work, nodes[i]);
+    }
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        extremes(&lo, &hi, xs[i]);
+    }
+
+    printf("%llu %llu\n", (unsigned long long)get_hits(),
+           (unsigned long long)total);
+    printf("%llu\n", (unsigned long long)sum_stack(&head));
+    printf("%d %d\n", lo, hi);
+}
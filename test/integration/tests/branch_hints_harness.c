@@ -0,0 +1,18 @@
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t checked_div(uint64_t a, uint64_t b);
+uint64_t collatz(uint64_t x);
+_Bool in_range(uint64_t x, uint64_t lo, uint64_t hi);
+
+uint64_t fail(uint64_t code) {
+    return code + 1000;
+}
+
+int main(void) {
+    printf("%llu %llu\n", (unsigned long long)checked_div(42, 5),
+           (unsigned long long)checked_div(42, 0));
+    printf("%llu\n", (unsigned long long)collatz(27));
+    printf("%d %d %d\n", in_range(5, 1, 10), in_range(0, 1, 10),
+           in_range(10, 1, 10));
+}
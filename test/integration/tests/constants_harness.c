@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t fact_ten(void);
+uint64_t fib_fifty(void);
+uint64_t fact_runtime(uint64_t n);
+extern const uint64_t shadowed_five;
+uint64_t twice_three(void);
+uint64_t count_far(void);
+double quarter(void);
+uint64_t table_bytes(void);
+int32_t triangle(void);
+
+int main(void) {
+    printf("%llu\n", (unsigned long long)fact_ten());
+    printf("%llu\n", (unsigned long long)fib_fifty());
+    printf("%llu\n", (unsigned long long)fact_runtime(12));
+    printf("%llu %llu\n", (unsigned long long)shadowed_five,
+                           (unsigned long long)twice_three());
+    printf("%llu\n", (unsigned long long)count_far());
+    printf("%.2f\n", quarter());
+    printf("%llu\n", (unsigned long long)table_bytes());
+    printf("%d\n", triangle());
+}
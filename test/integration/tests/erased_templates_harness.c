@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdint.h>
+
+struct point {
+    int32_t x, y, z;
+};
+
+void reverse_i64s(int64_t *xs, uint64_t n);
+void reverse_bytes(char *xs, uint64_t n);
+void reverse_points(struct point *ps, uint64_t n);
+int64_t copy_points(struct point *dst, struct point *src, uint64_t n);
+uint64_t point_align(void);
+
+int main(void) {
+    int64_t xs[] = { 1, 2, 3, 4, 5 };
+    char bytes[] = "abc";
+    struct point ps[] = { { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } };
+    struct point copy[3];
+    int i;
+
+    reverse_i64s(xs, 5);
+    for (i = 0; i < 5; ++i) {
+        printf(i ? " %lld" : "%lld", (long long)xs[i]);
+    }
+    printf("\n");
+
+    reverse_i64s(xs, 5);
+    printf("%lld %lld\n", (long long)xs[0], (long long)xs[4]);
+
+    reverse_bytes(bytes, 3);
+    printf("%s\n", bytes);
+
+    reverse_points(ps, 3);
+    for (i = 0; i < 3; ++i) {
+        printf(i ? " / %d %d %d" : "%d %d %d", ps[i].x, ps[i].y, ps[i].z);
+    }
+    printf("\n");
+
+    printf("%lld", (long long)copy_points(copy, ps, 3));
+    printf(" %d %d %d\n", copy[0].x, copy[0].y, copy[0].z);
+
+    printf("%llu\n", (unsigned long long)point_align() / 4);
+    return 0;
+}
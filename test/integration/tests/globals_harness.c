@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdint.h>
+
+extern const uint8_t squares[8];
+extern char *greeting;
+extern char *greeting_again;
+extern uint64_t counter;
+extern uint32_t buckets[8];
+extern const float eighth;
+
+/* Not the `scale` of globals.cr, which is not pub. */
+double scale = 2.0;
+
+uint8_t lookup(uint64_t i);
+int32_t grid_sum(void);
+double scaled(double x);
+uint64_t bump(uint64_t by);
+
+int main(void) {
+    uint64_t total;
+    int i;
+
+    printf("%d %d %d\n", lookup(3), lookup(7), squares[5]);
+    printf("%d\n", grid_sum());
+    printf("%.2f %g %g\n", scaled(3.0), eighth, scale);
+    printf("%s %s\n", greeting, greeting == greeting_again ? "pooled" : "");
+
+    bump(3);
+    bump(11);
+    total = bump(5);
+    printf("%llu %llu\n", (unsigned long long)counter,
+           (unsigned long long)total);
+    for (i = 0; i < 8; i++) {
+        printf("%u ", buckets[i]);
+    }
+    printf("\n");
+}
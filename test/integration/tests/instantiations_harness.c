@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <stdint.h>
+
+int64_t max3(int64_t a, int64_t b, int64_t c);
+double max_double(double a, double b);
+int64_t max_array(int64_t *xs, uint64_t n);
+
+/* Each object has its own `larger`, `unbox` and `Box`; not all agree. */
+int64_t smaller_i64(int64_t a, int64_t b);
+int64_t unbox_plain(int64_t value);
+int64_t unbox_padded(int32_t pad, int64_t value);
+
+int main(void) {
+    int64_t xs[] = { 4, -2, 19, 7 };
+
+    printf("%lld %g\n", (long long)max3(3, 11, -5), max_double(2.5, 1.5));
+    printf("%lld %lld\n", (long long)max_array(xs, 4),
+                          (long long)smaller_i64(-1, -8));
+    printf("%lld %lld\n", (long long)unbox_plain(5),
+                          (long long)unbox_padded(1, 7));
+    return 0;
+}
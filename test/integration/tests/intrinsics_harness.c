@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t bits(uint64_t x);
+uint32_t swapped(uint32_t x);
+uint32_t rotations(uint32_t x);
+double norm(double x, double y);
+void copy_rev(char *dst, const char *src, uint64_t n);
+void fill_flags(unsigned char *flags, _Bool value, uint64_t n);
+uint64_t count_set(uint64_t *words, uint64_t n);
+
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+uint32_t lane_bits(v4u32 v);
+
+int main(void) {
+    char buf[16];
+    unsigned char flags[3] = { 7, 7, 7 };
+    uint64_t words[4] = { 0, 0xff, 0, 0x8000000000000001ull };
+    v4u32 v = { 1, 3, 7, 0xffffffff };
+
+    printf("%llu %llu\n", (unsigned long long)bits(0xf0),
+           (unsigned long long)bits(0));
+    printf("%08x %08x\n", swapped(0x12345678), rotations(0x12345678));
+    printf("%u\n", lane_bits(v));
+    printf("%.1f\n", norm(3.0, 4.0));
+    copy_rev(buf, "abcde", 5);
+    printf("%s\n", buf);
+    fill_flags(flags, 1, 2);
+    printf("%d %d %d\n", flags[0], flags[1], flags[2]);
+    printf("%llu\n", (unsigned long long)count_set(words, 4));
+}
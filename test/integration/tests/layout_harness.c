@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct packet {
+    uint8_t tag;
+    uint64_t length;
+    uint16_t ports[3];
+    double weight;
+};
+
+uint64_t packet_size(void);
+uint64_t packet_align(void);
+uint64_t ports_offset(void);
+uint64_t weight_offset(void);
+uint64_t packet_array_bytes(uint64_t n);
+uint64_t small_sizes(void);
+
+static void check(const char *name, uint64_t found, uint64_t expected) {
+    printf("%s %s\n", name, found == expected ? "ok" : "wrong");
+}
+
+int main(void) {
+    check("sizeof", packet_size(), sizeof(struct packet));
+    check("alignof", packet_align(), _Alignof(struct packet));
+    check("offsetof", ports_offset(), offsetof(struct packet, ports));
+    check("offsetof", weight_offset(), offsetof(struct packet, weight));
+    check("array", packet_array_bytes(10), 10 * sizeof(struct packet));
+    printf("%llu\n", (unsigned long long)small_sizes());
+}
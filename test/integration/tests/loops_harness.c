@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t sum_to(uint64_t n);
+uint64_t collatz_steps(uint64_t n);
+double dot(double *a, double *b, uint64_t n);
+void scale(double *a, double k, uint64_t n);
+double first_or_zero(double *a, uint64_t n);
+
+int main(void) {
+    double a[100], b[100];
+    int i;
+
+    for (i = 0; i < 100; i++) {
+        a[i] = i;
+        b[i] = 2;
+    }
+
+    printf("%llu\n", sum_to(100));
+    printf("%llu\n", collatz_steps(27));
+    printf("%g\n", dot(a, b, 100));
+    scale(a, 0.5, 99);
+    printf("%g %g\n", a[98], a[99]);
+    printf("%g %g\n", first_or_zero(b, 100), first_or_zero(b, 0));
+}
@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t collatz_steps(uint64_t n);
+
+/* Instrumented code refers to this to pull in the LLVM profile runtime,
+ * which would write the counters out at exit.  Without it the counters are
+ * still kept, and can be read straight from their section. */
+int __llvm_profile_runtime;
+
+extern uint64_t __start___llvm_prf_cnts[];
+extern uint64_t __stop___llvm_prf_cnts[];
+
+static uint64_t total_count(void) {
+    uint64_t total = 0;
+    for (uint64_t *c = __start___llvm_prf_cnts;
+         c < __stop___llvm_prf_cnts; ++c) {
+        total += *c;
+    }
+    return total;
+}
+
+int main(void) {
+    printf("before: %llu\n", (unsigned long long)total_count());
+    printf("steps: %llu\n", (unsigned long long)collatz_steps(27));
+    printf("counted: %d\n", total_count() > 0);
+}
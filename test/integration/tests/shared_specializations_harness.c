@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <stdint.h>
+
+struct foo { int64_t a; };
+struct bar { double b; };
+
+void push_foo(struct foo **stack, uint64_t *len, struct foo *f);
+void push_bar(struct bar **stack, uint64_t *len, struct bar *b);
+void append_foo(struct foo **stack, uint64_t *len, struct foo *f);
+void append_bar(struct bar **stack, uint64_t *len, struct bar *b);
+void push_i64(int64_t *stack, uint64_t *len, int64_t x);
+void push_u64(uint64_t *stack, uint64_t *len, uint64_t x);
+int64_t larger_i64(int64_t a, int64_t b);
+uint64_t larger_u64(uint64_t a, uint64_t b);
+
+int main(void) {
+    struct foo f = { 2 };
+    struct bar b = { 1.5 };
+    struct foo *foos[2];
+    struct bar *bars[2];
+    int64_t ints[1];
+    uint64_t uints[1];
+    uint64_t n_foos = 0, n_bars = 0, n_ints = 0, n_uints = 0;
+
+    push_foo(foos, &n_foos, &f);
+    push_bar(bars, &n_bars, &b);
+    append_foo(foos, &n_foos, &f);
+    append_bar(bars, &n_bars, &b);
+    push_i64(ints, &n_ints, -4);
+    push_u64(uints, &n_uints, 4);
+    printf("%lld %g %lld %llu\n", (long long)foos[1]->a, bars[1]->b,
+           (long long)ints[0], (unsigned long long)uints[0]);
+
+    printf("%lld %llu\n", (long long)larger_i64(-1, -2),
+           (unsigned long long)larger_u64(-1, 2));
+
+    return 0;
+}
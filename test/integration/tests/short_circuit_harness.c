@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <stdint.h>
+
+extern uint64_t calls;
+
+uint8_t and_test(_Bool a, _Bool b);
+uint8_t or_test(_Bool a, _Bool b);
+uint8_t nested(_Bool a, _Bool b, _Bool c);
+uint8_t positive(int64_t *p);
+uint64_t count_positive(int64_t *xs, uint64_t n);
+
+static void report(const char *name, uint8_t result) {
+    printf("%s %d %llu\n", name, result, (unsigned long long)calls);
+    calls = 0;
+}
+
+int main(void) {
+    int64_t x = 5;
+    int64_t xs[] = {3, 1, 4, -1, 5};
+
+    report("and", and_test(0, 1));
+    report("and", and_test(1, 1));
+    report("or", or_test(1, 0));
+    report("or", or_test(0, 0));
+    report("nested", nested(1, 0, 0));
+    report("nested", nested(0, 1, 0));
+    report("nested", nested(0, 0, 1));
+    printf("%d %d\n", positive(NULL), positive(&x));
+    printf("%llu\n", (unsigned long long)count_positive(xs, 5));
+    printf("%llu\n", (unsigned long long)count_positive(xs, 2));
+}
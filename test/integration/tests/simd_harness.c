@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+int32_t sum_i32(int32_t *xs, uint64_t n);
+void clamp_negatives(int32_t *xs, uint64_t n);
+void reverse4(int32_t *xs);
+float dot3(float *a, float *b);
+int32_t max_and_min(int32_t *xs);
+int32_t lanes(int32_t *xs);
+bool all_positive(int32_t *xs);
+
+int main(void) {
+    int32_t xs[16] __attribute__((aligned(16)));
+    float a[4] __attribute__((aligned(16))) = { 1, 2, 3, 100 };
+    float b[4] __attribute__((aligned(16))) = { 4, 5, 6, 100 };
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        xs[i] = i % 2 ? i : -i;
+    }
+
+    printf("%d\n", sum_i32(xs, 16));
+    printf("%d\n", max_and_min(xs));
+    printf("%d\n", all_positive(xs));
+    clamp_negatives(xs, 16);
+    printf("%d %d %d %d\n", xs[0], xs[1], xs[2], xs[3]);
+    printf("%d\n", all_positive(xs + 4));
+    reverse4(xs);
+    printf("%d %d %d %d\n", xs[0], xs[1], xs[2], xs[3]);
+    printf("%d\n", lanes(xs));
+    printf("%g\n", dot3(a, b));
+}
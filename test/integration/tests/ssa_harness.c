@@ -0,0 +1,21 @@
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t gcd(uint64_t a, uint64_t b);
+uint64_t count_pairs(uint64_t n);
+uint64_t addressed(uint64_t n);
+uint64_t shadowed(uint64_t n);
+uint64_t first_above(double *values, uint64_t n, double limit);
+
+int main(void) {
+    double values[5] = { 1.0, 2.5, 3.0, 7.5, 2.0 };
+
+    printf("%llu %llu\n", (unsigned long long)gcd(1071, 462),
+           (unsigned long long)gcd(17, 5));
+    printf("%llu\n", (unsigned long long)count_pairs(10));
+    printf("%llu\n", (unsigned long long)addressed(42));
+    printf("%llu %llu\n", (unsigned long long)shadowed(10),
+           (unsigned long long)shadowed(3));
+    printf("%llu %llu\n", (unsigned long long)first_above(values, 5, 3.0),
+           (unsigned long long)first_above(values, 5, 10.0));
+}
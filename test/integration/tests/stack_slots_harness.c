@@ -0,0 +1,11 @@
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t churn(uint64_t n);
+uint64_t branches(uint64_t n);
+
+int main(void) {
+    printf("%llu\n", (unsigned long long)churn(200000));
+    printf("%llu %llu\n", (unsigned long long)branches(20),
+           (unsigned long long)branches(5));
+}
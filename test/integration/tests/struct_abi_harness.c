@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdint.h>
+
+typedef struct { double x; int32_t n; } Mixed;
+typedef struct { float a; float b; int32_t c; } Floats;
+typedef struct { int64_t a; int64_t b; int64_t c; } Big;
+typedef struct { int64_t lo; int64_t hi; } Wide;
+
+Mixed make_mixed(double x, int32_t n);
+Floats scale_floats(Floats f, float k);
+Big make_big(int64_t a);
+int64_t big_sum(Big b);
+int64_t wide_sum(Wide a, Wide b, Wide c, Wide d);
+double round_trip(double x);
+int64_t big_round_trip(int64_t a);
+
+Mixed c_mixed(Mixed m) {
+    m.x *= 2;
+    m.n += 1;
+    return m;
+}
+
+Big c_big(Big b, int32_t k) {
+    b.a *= k;
+    b.c += k;
+    return b;
+}
+
+int main(void) {
+    Mixed m = make_mixed(2.5, 7);
+    Floats f = { 1.5f, -2.0f, 21 };
+    Big b = make_big(5);
+    Big c = { 1, 2, 3 };
+    Wide w[4] = { { 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 8 } };
+
+    printf("%.2f %d\n", m.x, m.n);
+    f = scale_floats(f, 3.0f);
+    printf("%.2f %.2f %d\n", f.a, f.b, f.c);
+    printf("%lld %lld %lld\n", (long long)b.a, (long long)b.b,
+           (long long)b.c);
+    printf("%lld\n", (long long)big_sum(c));
+    printf("%lld\n", (long long)wide_sum(w[0], w[1], w[2], w[3]));
+    printf("%.2f\n", round_trip(1.25));
+    printf("%lld\n", (long long)big_round_trip(2));
+}
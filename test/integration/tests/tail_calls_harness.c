@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Bool is_even(uint64_t n);
+uint64_t in_space(const char *s, uint64_t words);
+int32_t fib(uint64_t n);
+void count_down(uint64_t *counter, uint64_t n);
+
+int main(void) {
+    uint64_t n = 10000000;
+    uint64_t counter = 0;
+    char *text = malloc(n + 1);
+
+    for (uint64_t i = 0; i < n; ++i) {
+        text[i] = i % 4 == 3 ? ' ' : 'a';
+    }
+    text[n] = 0;
+
+    printf("%d %d\n", is_even(n), is_even(n + 1));
+    printf("%llu\n", (unsigned long long)in_space(text, 0));
+    printf("%d\n", fib(40));
+    count_down(&counter, n);
+    printf("%llu\n", (unsigned long long)counter);
+
+    free(text);
+}
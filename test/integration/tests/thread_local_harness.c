@@ -0,0 +1,44 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t record(int32_t x);
+uint64_t get_total(void);
+int32_t latest(void);
+
+struct result {
+    int32_t base;
+    uint64_t calls;
+    uint64_t total;
+    int32_t latest;
+};
+
+static void *work(void *arg) {
+    struct result *r = arg;
+
+    for (int32_t i = 1; i <= r->base; ++i) {
+        r->calls = record(r->base * i);
+    }
+    r->total = get_total();
+    r->latest = latest();
+
+    return NULL;
+}
+
+int main(void) {
+    pthread_t threads[3];
+    struct result results[3] = { { 5 }, { 10 }, { 20 } };
+
+    for (int i = 0; i < 3; ++i) {
+        pthread_create(&threads[i], NULL, work, &results[i]);
+    }
+    for (int i = 0; i < 3; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        printf("%llu %llu %d\n", (unsigned long long)results[i].calls,
+               (unsigned long long)results[i].total, results[i].latest);
+    }
+    printf("%llu\n", (unsigned long long)get_total());
+}
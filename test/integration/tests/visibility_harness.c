@@ -0,0 +1,19 @@
+#include <stdio.h>
+#include <stdint.h>
+
+int64_t sum_cubes(int64_t n);
+int64_t largest_square(int64_t a, int64_t b);
+uint64_t count_steps(uint64_t n, uint64_t steps);
+
+/* Internal Craeft functions do not clash with C functions of the same name. */
+int64_t square(int64_t x) {
+    return -x;
+}
+
+int main(void) {
+    printf("%lld %lld\n", (long long)sum_cubes(10),
+                          (long long)largest_square(-7, 5));
+    printf("%llu %lld\n", (unsigned long long)count_steps(1000000, 0),
+                          (long long)square(3));
+    return 0;
+}